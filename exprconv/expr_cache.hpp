@@ -0,0 +1,124 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <exprtk.hpp>
+#include "libmodmqttconv/convexception.hpp"
+#include "libmodmqttconv/converter.hpp"
+
+/**
+ * Compiled expression shared by all converters
+ * with the same expression text and precision
+ * */
+struct ExprtkCompiledExpression {
+    exprtk::expression<double> mExpression;
+    int mPrecision = -1;
+};
+
+/**
+ * Plugin-level cache of compiled expressions.
+ *
+ * All expressions are compiled with a single parser and
+ * a single symbol table. Register variables R0..R19 are bound
+ * to the cache value slots, which are set before each
+ * evaluation. Converters are called from the main thread only,
+ * so slots are not guarded.
+ * */
+class ExprtkExpressionCache {
+    public:
+        static const int MAX_REGISTERS = 20;
+
+        ExprtkExpressionCache() : mValues(MAX_REGISTERS, 0) {
+            mSymbolTable.add_function("int32",    int32);
+            mSymbolTable.add_function("int32be",  int32be);
+            mSymbolTable.add_function("uint32",   uint32);
+            mSymbolTable.add_function("uint32be", uint32be);
+            mSymbolTable.add_function("flt32",    flt32);
+            mSymbolTable.add_function("flt32be",  flt32be);
+            mSymbolTable.add_function("int16",    int16);
+            mSymbolTable.add_constants();
+
+            char buf[16];
+            for(uint16_t i = 0; i < mValues.size(); i++) {
+                sprintf(buf, "R%d", i);
+                mSymbolTable.add_variable(buf, mValues[i], false);
+            }
+        }
+
+        std::shared_ptr<const ExprtkCompiledExpression> get(const std::string& pExpression, int pPrecision) {
+            std::pair<std::string, int> key(pExpression, pPrecision);
+            std::map<std::pair<std::string, int>, std::shared_ptr<ExprtkCompiledExpression>>::const_iterator it = mExpressions.find(key);
+            if (it != mExpressions.end())
+                return it->second;
+
+            std::shared_ptr<ExprtkCompiledExpression> ret(new ExprtkCompiledExpression());
+            ret->mPrecision = pPrecision;
+            ret->mExpression.register_symbol_table(mSymbolTable);
+            if (!mParser.compile(pExpression, ret->mExpression)) {
+                throw ConvException(std::string("Exprtk ") + mParser.error());
+            }
+            mExpressions[key] = ret;
+            return ret;
+        }
+
+        MqttValue evaluate(const ExprtkCompiledExpression& pExpression, const ModbusRegisters& pData) {
+            if (pData.getCount() > MAX_REGISTERS)
+                throw ConvException("Maximum " +std::to_string(MAX_REGISTERS) + " registers allowed");
+
+            for(int i = 0; i < pData.getCount(); i++) {
+                mValues[i] = pData.getValue(i);
+            }
+            // clear values left by previous call with more registers
+            for(int i = pData.getCount(); i < mBoundCount; i++) {
+                mValues[i] = 0;
+            }
+            mBoundCount = pData.getCount();
+
+            double ret = pExpression.mExpression.value();
+
+            if (pExpression.mPrecision == 0)
+                return MqttValue::fromInt(ret);
+
+            return MqttValue::fromDouble(ret, pExpression.mPrecision);
+        }
+    private:
+        exprtk::symbol_table<double> mSymbolTable;
+        exprtk::parser<double> mParser;
+        std::vector<double> mValues;
+        // number of mValues set by last evaluate() call
+        int mBoundCount = 0;
+        std::map<std::pair<std::string, int>, std::shared_ptr<ExprtkCompiledExpression>> mExpressions;
+
+        static double int32(const double highRegister, const double lowRegister) {
+            return ConverterTools::toNumber<int32_t>(highRegister, lowRegister, true);
+        }
+
+        static double int32be(const double highRegister, const double lowRegister) {
+            return ConverterTools::toNumber<int32_t>(highRegister, lowRegister);
+        }
+
+        static double uint32(const double highRegister, const double lowRegister) {
+            return ConverterTools::toNumber<uint32_t>(highRegister, lowRegister, true);
+        }
+
+        static double uint32be(const double highRegister, const double lowRegister) {
+            return ConverterTools::toNumber<uint32_t>(highRegister, lowRegister);
+        }
+
+        static double flt32(const double highRegister, const double lowRegister) {
+            return ConverterTools::toNumber<float>(highRegister, lowRegister, true);
+        }
+
+        static double flt32be(const double highRegister, const double lowRegister) {
+            return ConverterTools::toNumber<float>(highRegister, lowRegister);
+        }
+
+        static double int16(const double regValue) {
+            uint16_t tmp = uint16_t(regValue);
+            return (int16_t)tmp;
+        }
+};
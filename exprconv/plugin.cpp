@@ -4,7 +4,9 @@
 DataConverter*
 StdConvPlugin::getConverter(const std::string& name) {
     if(name == "evaluate") {
-        return new ExprtkConverter();
+        if (mCache == nullptr)
+            mCache.reset(new ExprtkExpressionCache());
+        return new ExprtkConverter(mCache);
     }
     return nullptr;
 }
@@ -1,15 +1,25 @@
 #pragma once
 
+#include <memory>
+
 #include <boost/config.hpp> // for BOOST_SYMBOL_EXPORT
 
 #include "libmodmqttconv/converterplugin.hpp"
 
+class ExprtkExpressionCache;
+
 class StdConvPlugin : ConverterPlugin {
     public:
         virtual std::string getName() const { return "expr"; }
         virtual DataConverter* getConverter(const std::string& name);
         virtual ~StdConvPlugin() {}
+    private:
+        // shared by all converters, created on first request
+        std::shared_ptr<ExprtkExpressionCache> mCache;
 };
 
 extern "C" BOOST_SYMBOL_EXPORT StdConvPlugin converter_plugin;
 StdConvPlugin converter_plugin;
+
+extern "C" BOOST_SYMBOL_EXPORT const int converter_api_version;
+const int converter_api_version = MODMQTT_CONVERTER_API_VERSION;
@@ -3,6 +3,7 @@
 #include <cmath>
 #include <cstdint>
 #include <netinet/in.h>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -159,6 +160,15 @@ class ConverterTools {
 
 class DataConverter {
     public:
+        /**
+         * Registers of a single value converted by toMqttBatch()
+         * */
+        struct BatchSlot {
+            // index of the first register in registers span
+            uint16_t mOffset;
+            uint16_t mCount;
+        };
+
         virtual void setArgs(const std::vector<std::string>& args) {};
         virtual MqttValue toMqtt(const ModbusRegisters& data) const {
             throw std::logic_error("Conversion to mqtt value is not implemented");
@@ -166,4 +176,26 @@ class DataConverter {
         virtual ModbusRegisters toModbus(const MqttValue&, int registerCount) const {
             throw std::logic_error("Conversion to modbus register values is not implemented");
         };
+
+        /**
+         * Converts values of all slots read from a single poll group
+         * and stores them in out[i] for slots[i].
+         *
+         * Default implementation calls toMqtt() for every slot.
+         * */
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const {
+            for(std::size_t i = 0; i < slots.size(); i++) {
+                const uint16_t* first = registers.data() + slots[i].mOffset;
+                ModbusRegisters data(std::vector<uint16_t>(first, first + slots[i].mCount));
+                out[i] = toMqtt(data);
+            }
+        }
+
+        /**
+         * Returns true if toMqttBatch() is implemented by converter.
+         * Such converter must not keep any state between calls, because
+         * a single instance is shared by all values with the same converter
+         * arguments.
+         * */
+        virtual bool hasBatchConversion() const { return false; }
 };
@@ -3,6 +3,15 @@
 #include "converter.hpp"
 #include <string>
 
+/**
+ * Version of DataConverter, ConverterPlugin and MqttValue binary layout.
+ * Must be exported by every plugin as "converter_api_version" C symbol.
+ * Plugins built with version 2 or without this symbol are loaded
+ * through interface from converterplugin_v2.hpp, other versions
+ * are refused.
+ * */
+#define MODMQTT_CONVERTER_API_VERSION 3
+
 class ConverterPlugin {
     public:
         virtual std::string getName() const = 0;
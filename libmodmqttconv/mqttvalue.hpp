@@ -1,11 +1,18 @@
 #pragma once
 
+#include <charconv>
+#include <cmath>
 #include <cstring>
 #include <memory>
 #include <sstream>
 #include <iostream>
 #include "convexception.hpp"
 
+/**
+ * Strings and binary data up to MAX_INLINE_SIZE bytes are stored
+ * inside MqttValue. Bigger data is stored in immutable buffer
+ * shared by all copies.
+ * */
 class MqttValue {
     public:
         /**
@@ -19,6 +26,7 @@ class MqttValue {
         } SourceType;
 
         static constexpr int NO_PRECISION = -1;
+        static constexpr size_t MAX_INLINE_SIZE = 22;
 
         static MqttValue fromInt(int32_t val) {
             return MqttValue(val);
@@ -61,50 +69,54 @@ class MqttValue {
         }
 
         MqttValue(const void* ptr, size_t size){
-            mBinaryValue = std::shared_ptr<void>(malloc(size), free);
-            memcpy(mBinaryValue.get(), ptr, size);
-            mType = SourceType::BINARY;
-            mBinarySize = size;
+            setBinary(ptr, size);
         }
 
         void setString(const char* val) {
-            size_t len = strlen(val);
-            mBinaryValue = std::shared_ptr<void>(malloc(len), free);
-            memcpy(mBinaryValue.get(), val, len);
-            mBinarySize = len;
-            mType = SourceType::BINARY;
+            setBinary(val, strlen(val));
         }
 
         void setDouble(double val, int precision) {
+            mSharedValue.reset();
             mValue.v_double = val;
             mType = SourceType::DOUBLE;
             mDoublePrecision = precision;
         }
 
         void setInt(int32_t val) {
+            mSharedValue.reset();
             mValue.v_int = val;
             mType = SourceType::INT;
         }
 
         void setInt64(int64_t val) {
+            mSharedValue.reset();
             mValue.v_int64 = val;
             mType = SourceType::INT64;
         }
 
         void setBinary(const void* ptr, size_t size) {
-            mBinaryValue = std::shared_ptr<void>(malloc(size), free);
-            memcpy(mBinaryValue.get(), ptr, size);
+            if (size <= MAX_INLINE_SIZE) {
+                mSharedValue.reset();
+                if (size > 0)
+                    memcpy(mValue.v_inline, ptr, size);
+            } else {
+                std::shared_ptr<char[]> buf(new char[size]);
+                memcpy(buf.get(), ptr, size);
+                mSharedValue = buf;
+            }
             mType = SourceType::BINARY;
+            mBinarySize = size;
         }
 
         std::string getString() const {
             switch(mType) {
                 case SourceType::BINARY:
-                    return std::string(static_cast<const char*>(mBinaryValue.get()), mBinarySize);
+                    return std::string(getBinaryData(), mBinarySize);
                 case SourceType::INT:
-                    return std::to_string(mValue.v_int);
+                    return format(mValue.v_int);
                 case SourceType::INT64:
-                    return std::to_string(mValue.v_int64);
+                    return format(mValue.v_int64);
                 case SourceType::DOUBLE:
                     return format(mValue.v_double);
             }
@@ -181,10 +193,11 @@ class MqttValue {
             return 0;
         }
 
+        // for inline data pointer is valid as long as this MqttValue
         void* getBinaryPtr() const {
             switch(mType) {
                 case SourceType::BINARY:
-                    return mBinaryValue.get();
+                    return (void*)getBinaryData();
                 default:
                     return (void*)&mValue;
             }
@@ -216,29 +229,47 @@ class MqttValue {
             int64_t v_int64;
             int32_t v_int;
             double v_double;
+            // BINARY data up to MAX_INLINE_SIZE
+            char v_inline[MAX_INLINE_SIZE];
         } Variant;
 
         Variant mValue;
-        std::shared_ptr<void> mBinaryValue;
-        size_t mBinarySize;
+        // BINARY data bigger than MAX_INLINE_SIZE
+        std::shared_ptr<const char[]> mSharedValue;
+        size_t mBinarySize = 0;
         int mDoublePrecision = MqttValue::NO_PRECISION;
         SourceType mType;
 
-        // https://stackoverflow.com/questions/33125779/format-double-value-in-c
+        const char* getBinaryData() const {
+            return mBinarySize > MAX_INLINE_SIZE ? mSharedValue.get() : mValue.v_inline;
+        }
+
+        template <typename T>
+        static std::string format(T value) {
+            char buf[24];
+            std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), value);
+            return std::string(buf, res.ptr);
+        }
+
         std::string format(double value) const {
 
             double intpart;
             modf(value, &intpart);
 
             if (intpart == value && mDoublePrecision == NO_PRECISION)
-                return std::to_string(int64_t(intpart));
+                return format(int64_t(intpart));
+
+            // the same output as std::fixed stream
+            // with default precision of 6 digits
+            int precision = mDoublePrecision == NO_PRECISION ? 6 : mDoublePrecision;
+            char buf[512];
+            std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, precision);
+            if (res.ec == std::errc())
+                return std::string(buf, res.ptr);
 
             std::stringstream sstream;
             sstream.setf(std::ios::fixed);
-
-            if (mDoublePrecision != NO_PRECISION)
-                sstream.precision(mDoublePrecision);
-
+            sstream.precision(precision);
             sstream << value;
             return sstream.str();
         }
@@ -22,7 +22,9 @@ namespace modmqttd {
 
 typedef enum {
     ON_CHANGE=1,
-    EVERY_POLL=2
+    EVERY_POLL=2,
+    // publish min, max, average of values polled in aggregation window
+    AGGREGATE=3
 } PublishMode;
 
 }
@@ -11,6 +11,7 @@ boost::log::sources::severity_logger<Log::severity> ModbusNetworkConfig::log;
 
 #if __cplusplus < 201703L
 constexpr std::chrono::milliseconds ModbusNetworkConfig::MAX_RESPONSE_TIMEOUT;
+constexpr int ModbusNetworkConfig::MAX_PIPELINE_DEPTH;
 #endif
 
 ConfigurationException::ConfigurationException(const YAML::Mark& mark, const char* what) {
@@ -58,6 +59,21 @@ ModbusNetworkConfig::ModbusNetworkConfig(const YAML::Node& source) {
     ConfigTools::readOptionalValue<unsigned short>(mMaxWriteRetryCount, source, "write_retries");
     ConfigTools::readOptionalValue<unsigned short>(mMaxReadRetryCount, source, "read_retries");
 
+    YAML::Node gapNode(ConfigTools::setOptionalValueFromNode<int>(mMaxGap, source, "max_gap"));
+    if (gapNode.IsDefined() && mMaxGap < 0)
+        throw ConfigurationException(gapNode.Mark(), "max_gap must be greater or equal to 0");
+
+    ConfigTools::readOptionalValue<std::string>(mRegisterLayoutFile, source, "register_layout_file");
+    ConfigTools::readOptionalValue<bool>(mCoalesceWrites, source, "coalesce_writes");
+
+    YAML::Node maxWritesNode(ConfigTools::setOptionalValueFromNode<int>(mMaxQueuedWrites, source, "max_queued_writes"));
+    if (maxWritesNode.IsDefined() && mMaxQueuedWrites < 0)
+        throw ConfigurationException(maxWritesNode.Mark(), "max_queued_writes must be greater or equal to 0");
+    ConfigTools::readOptionalValue<WriteOverflowPolicy>(mWriteOverflowPolicy, source, "write_overflow_policy");
+
+    YAML::Node maxUpdatesNode(ConfigTools::setOptionalValueFromNode<int>(mMaxQueuedUpdates, source, "max_queued_updates"));
+    if (maxUpdatesNode.IsDefined() && mMaxQueuedUpdates < 0)
+        throw ConfigurationException(maxUpdatesNode.Mark(), "max_queued_updates must be greater or equal to 0");
 
     if (source["device"]) {
         mType = Type::RTU;
@@ -75,6 +91,9 @@ ModbusNetworkConfig::ModbusNetworkConfig(const YAML::Node& source) {
         mType = Type::TCPIP;
         mAddress = ConfigTools::readRequiredString(source, "address");
         mPort = ConfigTools::readRequiredValue<int>(source, "port");
+        YAML::Node depthNode(ConfigTools::setOptionalValueFromNode<int>(mPipelineDepth, source, "pipeline_depth"));
+        if (depthNode.IsDefined() && (mPipelineDepth < 1 || mPipelineDepth > MAX_PIPELINE_DEPTH))
+            throw ConfigurationException(depthNode.Mark(), "pipeline_depth value must be in range 1-" + std::to_string(MAX_PIPELINE_DEPTH));
     } else {
         throw ConfigurationException(source.Mark(), "Cannot determine modbus network type: missing 'device' or 'address'");
     }
@@ -101,6 +120,12 @@ MqttBrokerConfig::MqttBrokerConfig(const YAML::Node& source) {
     ConfigTools::readOptionalValue<int>(mKeepalive, source, "keepalive");
     ConfigTools::readOptionalValue<std::string>(mUsername, source, "username");
     ConfigTools::readOptionalValue<std::string>(mPassword, source, "password");
+    YAML::Node maxInFlightNode(ConfigTools::setOptionalValueFromNode<int>(mMaxInFlight, source, "max_inflight"));
+    if (maxInFlightNode.IsDefined() && mMaxInFlight < 0)
+        throw ConfigurationException(maxInFlightNode.Mark(), "max_inflight must be greater or equal to 0");
+    YAML::Node republishRateNode(ConfigTools::setOptionalValueFromNode<int>(mRepublishRate, source, "republish_rate"));
+    if (republishRateNode.IsDefined() && mRepublishRate < 0)
+        throw ConfigurationException(republishRateNode.Mark(), "republish_rate must be greater or equal to 0");
 }
 
 
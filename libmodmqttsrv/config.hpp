@@ -80,6 +80,7 @@ class ModbusWatchdogConfig {
 
 class ModbusNetworkConfig {
     static constexpr std::chrono::milliseconds MAX_RESPONSE_TIMEOUT = std::chrono::milliseconds(999);
+    static constexpr int MAX_PIPELINE_DEPTH = 64;
 
     static boost::log::sources::severity_logger<Log::severity> log;
 
@@ -101,6 +102,11 @@ class ModbusNetworkConfig {
             RS485
         } RtuSerialMode;
 
+        typedef enum {
+            DROP_OLDEST,
+            DROP_NEWEST
+        } WriteOverflowPolicy;
+
         ModbusNetworkConfig() {}
         ModbusNetworkConfig(const YAML::Node& source);
 
@@ -121,6 +127,26 @@ class ModbusNetworkConfig {
         unsigned short mMaxWriteRetryCount = 2;
         unsigned short mMaxReadRetryCount = 1;
 
+        // max number of unused registers between poll groups
+        // read with single modbus command
+        int mMaxGap = 0;
+
+        // file to store poll group layout learned after
+        // illegal data address exceptions, empty if not used
+        std::string mRegisterLayoutFile = "";
+
+        // merge queued writes to the same or consecutive registers
+        bool mCoalesceWrites = false;
+
+        // max number of write commands waiting for execution,
+        // 0 for no limit
+        int mMaxQueuedWrites = 0;
+        WriteOverflowPolicy mWriteOverflowPolicy = WriteOverflowPolicy::DROP_OLDEST;
+
+        // max number of messages waiting for main thread, 0 for no limit.
+        // If reached then polled values are held in modbus thread
+        // and only the latest value of every register is kept
+        int mMaxQueuedUpdates = 0;
 
         //RTU only
         std::string mDevice = "";
@@ -135,6 +161,8 @@ class ModbusNetworkConfig {
         //TCP only
         std::string mAddress = "";
         int mPort = 0;
+        // max number of read requests sent without waiting for response
+        int mPipelineDepth = 1;
 
         ModbusWatchdogConfig mWatchdogConfig;
     private:
@@ -152,6 +180,8 @@ class MqttBrokerConfig {
                     mKeepalive == other.mKeepalive &&
                     mUsername == other.mUsername &&
                     mPassword == other.mPassword &&
+                    mMaxInFlight == other.mMaxInFlight &&
+                    mRepublishRate == other.mRepublishRate &&
                     mTLS == other.mTLS &&
                     mCafile == other.mCafile;
         }
@@ -162,6 +192,10 @@ class MqttBrokerConfig {
         int mKeepalive = 60;
         std::string mUsername;
         std::string mPassword;
+        // 0 means no limit
+        int mMaxInFlight = 0;
+        // objects republished per second after reconnect, 0 means no limit
+        int mRepublishRate = 0;
 
         std::string mClientId;
 
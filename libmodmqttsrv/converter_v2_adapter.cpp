@@ -0,0 +1,84 @@
+#include "converter_v2_adapter.hpp"
+
+namespace modmqttd {
+
+void
+DataConverterV2Adapter::setArgs(const std::vector<std::string>& args) {
+    mConverter->setArgs(args);
+}
+
+MqttValue
+DataConverterV2Adapter::toMqtt(const ModbusRegisters& data) const {
+    return fromV2(mConverter->toMqtt(data));
+}
+
+ModbusRegisters
+DataConverterV2Adapter::toModbus(const MqttValue& value, int registerCount) const {
+    return mConverter->toModbus(toV2(value), registerCount);
+}
+
+void
+DataConverterV2Adapter::toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const {
+    if (!hasBatchConversion()) {
+        DataConverter::toMqttBatch(registers, slots, out);
+        return;
+    }
+
+    // BatchSlot layout is the same in both versions
+    std::vector<DataConverterV2::BatchSlot> slotsV2(slots.size());
+    for(std::size_t i = 0; i < slots.size(); i++)
+        slotsV2[i] = DataConverterV2::BatchSlot{slots[i].mOffset, slots[i].mCount};
+
+    std::vector<MqttValueV2> outV2(slots.size());
+    mConverter->toMqttBatch(registers, slotsV2, outV2);
+    for(std::size_t i = 0; i < outV2.size(); i++)
+        out[i] = fromV2(outV2[i]);
+}
+
+bool
+DataConverterV2Adapter::hasBatchConversion() const {
+    // version 1 vtable ends at toModbus()
+    if (mApiVersion < MODMQTT_CONVERTER_API_VERSION_V2)
+        return false;
+    return mConverter->hasBatchConversion();
+}
+
+MqttValue
+DataConverterV2Adapter::fromV2(const MqttValueV2& value) {
+    switch(value.getSourceType()) {
+        case MqttValueV2::SourceType::INT:
+            return MqttValue::fromInt(value.getInt());
+        case MqttValueV2::SourceType::INT64:
+            return MqttValue::fromInt64(value.getInt64());
+        case MqttValueV2::SourceType::DOUBLE:
+            return MqttValue::fromDouble(value.getDouble(), value.getDoublePrecision());
+        case MqttValueV2::SourceType::BINARY:
+            return MqttValue::fromBinary(value.getBinaryPtr(), value.getBinarySize());
+    }
+    return MqttValue();
+}
+
+MqttValueV2
+DataConverterV2Adapter::toV2(const MqttValue& value) {
+    switch(value.getSourceType()) {
+        case MqttValue::SourceType::INT:
+            return MqttValueV2::fromInt(value.getInt());
+        case MqttValue::SourceType::INT64:
+            return MqttValueV2::fromInt64(value.getInt64());
+        case MqttValue::SourceType::DOUBLE:
+            return MqttValueV2::fromDouble(value.getDouble(), value.getDoublePrecision());
+        case MqttValue::SourceType::BINARY:
+            return MqttValueV2::fromBinary(value.getBinaryPtr(), value.getBinarySize());
+    }
+    return MqttValueV2();
+}
+
+DataConverter*
+ConverterPluginV2Adapter::getConverter(const std::string& name) {
+    DataConverterV2* conv = mPlugin->getConverter(name);
+    if (conv == nullptr)
+        return nullptr;
+    return new DataConverterV2Adapter(conv, mApiVersion);
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+
+#include "libmodmqttconv/converterplugin.hpp"
+#include "libmodmqttconv/converterplugin_v2.hpp"
+
+namespace modmqttd {
+
+/**
+ * Current DataConverter interface for converters
+ * from plugins built with converter API version 1 or 2
+ * */
+class DataConverterV2Adapter : public DataConverter {
+    public:
+        DataConverterV2Adapter(DataConverterV2* pConverter, int pApiVersion)
+            : mConverter(pConverter), mApiVersion(pApiVersion) {}
+
+        virtual void setArgs(const std::vector<std::string>& args);
+        virtual MqttValue toMqtt(const ModbusRegisters& data) const;
+        virtual ModbusRegisters toModbus(const MqttValue& value, int registerCount) const;
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const;
+        virtual bool hasBatchConversion() const;
+
+        static MqttValue fromV2(const MqttValueV2& value);
+        static MqttValueV2 toV2(const MqttValue& value);
+    private:
+        std::unique_ptr<DataConverterV2> mConverter;
+        int mApiVersion;
+};
+
+/**
+ * Current ConverterPlugin interface for plugins
+ * built with converter API version 1 or 2
+ * */
+class ConverterPluginV2Adapter : public ConverterPlugin {
+    public:
+        ConverterPluginV2Adapter(const std::shared_ptr<ConverterPluginV2>& pPlugin, int pApiVersion)
+            : mPlugin(pPlugin), mApiVersion(pApiVersion) {}
+
+        virtual std::string getName() const { return mPlugin->getName(); }
+        virtual DataConverter* getConverter(const std::string& name);
+    private:
+        std::shared_ptr<ConverterPluginV2> mPlugin;
+        int mApiVersion;
+};
+
+}
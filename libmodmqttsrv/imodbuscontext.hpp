@@ -1,7 +1,9 @@
 #pragma once
 
 #include <inttypes.h>
+#include <exception>
 #include <memory>
+#include <vector>
 
 #include "config.hpp"
 
@@ -11,6 +13,15 @@ class RegisterPoll;
 class RegisterWrite;
 class MsgRegisterValues;
 
+/**
+    Result of a single read from pipelined read list.
+    mError is set if read failed.
+*/
+struct ModbusReadResult {
+    std::vector<uint16_t> mValues;
+    std::exception_ptr mError;
+};
+
 /**
     Abstract base class for modbus communication library implementation
 */
@@ -21,7 +32,32 @@ class IModbusContext {
         virtual bool isConnected() const = 0;
         virtual void disconnect() = 0;
         virtual std::vector<uint16_t> readModbusRegisters(int slaveId, const RegisterPoll& regData) = 0;
+        /**
+            Read registers into pValues. pValues is resized to register count,
+            implementation should reuse its capacity to avoid allocation on every poll.
+        */
+        virtual void readModbusRegistersInto(int slaveId, const RegisterPoll& regData, std::vector<uint16_t>& pValues) {
+            pValues = readModbusRegisters(slaveId, regData);
+        }
         virtual void writeModbusRegisters(int slaveId, const RegisterWrite& msg) = 0;
+        /**
+            Read a list of register ranges from a single slave. Implementation can
+            send all requests before waiting for responses.
+            Results are returned in pRegisters order.
+        */
+        virtual std::vector<ModbusReadResult> readModbusRegisterList(int slaveId, const std::vector<std::shared_ptr<RegisterPoll>>& pRegisters) {
+            std::vector<ModbusReadResult> ret(pRegisters.size());
+            for(std::size_t i = 0; i < pRegisters.size(); i++) {
+                try {
+                    ret[i].mValues = readModbusRegisters(slaveId, *pRegisters[i]);
+                } catch (...) {
+                    ret[i].mError = std::current_exception();
+                }
+            }
+            return ret;
+        }
+        // max number of requests passed to readModbusRegisterList
+        virtual int getMaxPipelinedRequests() const { return 1; }
         virtual ModbusNetworkConfig::Type getNetworkType() const = 0;
         virtual ~IModbusContext() {};
 };
@@ -29,6 +65,9 @@ class IModbusContext {
 class IModbusFactory {
     public:
         virtual std::shared_ptr<IModbusContext> getContext(const std::string& networkName) = 0;
+        virtual std::shared_ptr<IModbusContext> getNetworkContext(const ModbusNetworkConfig& config) {
+            return getContext(config.mName);
+        }
         virtual ~IModbusFactory() {};
 };
 
@@ -18,7 +18,9 @@ class IMqttImpl {
         virtual void stop() = 0;
 
         virtual void subscribe(const char* topic) = 0;
-        virtual void publish(const char* topic, int len, const void* data, bool retain) = 0;
+        // returns true if message was queued for sending and
+        // MqttClient::onPublish() will be called when it is sent
+        virtual bool publish(const char* topic, int len, const void* data, bool retain) = 0;
 
         virtual void on_disconnect(int rc) = 0;
         virtual void on_connect(int rc)= 0;
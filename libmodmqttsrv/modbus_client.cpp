@@ -5,20 +5,42 @@
 
 namespace modmqttd {
 
+void
+ModbusClient::init(const ModbusNetworkConfig& config, const std::shared_ptr<ModbusEventLoop>& eventLoop) {
+    mNetworkName = config.mName;
+    if (eventLoop != nullptr)
+        mLoopNetwork = eventLoop->addNetwork(mToModbusQueue, mFromModbusQueue, mFromModbusSignal);
+    else
+        mModbusThread.reset(new std::thread(threadLoop, std::ref(mToModbusQueue), std::ref(mFromModbusQueue), std::ref(mFromModbusSignal)));
+    sendToModbus(QueueItem::create(config));
+}
+
+void
+ModbusClient::sendToModbus(const QueueItem& item) {
+    mToModbusQueue.enqueue(item);
+    if (mLoopNetwork != nullptr)
+        mLoopNetwork->notify();
+}
+
 void ModbusClient::stop() {
     if (mModbusThread != nullptr) {
         mToModbusQueue.enqueue(QueueItem::create(EndWorkMessage()));
         mModbusThread->join();
         mModbusThread.reset();
+    } else if (mLoopNetwork != nullptr) {
+        sendToModbus(QueueItem::create(EndWorkMessage()));
+        mLoopNetwork->waitFinished();
+        mLoopNetwork.reset();
     }
 };
 
 void
 ModbusClient::threadLoop(
     moodycamel::BlockingReaderWriterQueue<QueueItem>& toModbusQueue,
-    moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue)
+    moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue,
+    QueueSignal& fromModbusSignal)
 {
-    ModbusThread thread(toModbusQueue, fromModbusQueue);
+    ModbusThread thread(toModbusQueue, fromModbusQueue, fromModbusSignal);
     thread.run();
 };
 
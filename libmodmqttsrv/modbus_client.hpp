@@ -2,27 +2,31 @@
 
 #include <thread>
 #include "queue_item.hpp"
+#include "queue_signal.hpp"
 #include "mqttobject.hpp"
 #include "mqttcommand.hpp"
 #include "modbus_messages.hpp"
+#include "modbus_event_loop.hpp"
 #include "../readerwriterqueue/readerwriterqueue.h"
 
 namespace modmqttd {
 /**
  * This class contains code executed in main thread context
- * Rest is in ModbusThread class.
+ * Rest is in ModbusThread class, executed in its own thread
+ * or by ModbusEventLoop worker.
  * */
 class ModbusClient {
     public:
         ModbusClient() {};
         moodycamel::BlockingReaderWriterQueue<QueueItem> mFromModbusQueue;
         moodycamel::BlockingReaderWriterQueue<QueueItem> mToModbusQueue;
+        // signalled by modbus thread after putting message into mFromModbusQueue
+        QueueSignal mFromModbusSignal;
 
-        void init(const ModbusNetworkConfig& config) {
-            mNetworkName = config.mName;
-            mModbusThread.reset(new std::thread(threadLoop, std::ref(mToModbusQueue), std::ref(mFromModbusQueue)));
-            mToModbusQueue.enqueue(QueueItem::create(config));
-        };
+        void init(const ModbusNetworkConfig& config, const std::shared_ptr<ModbusEventLoop>& eventLoop = std::shared_ptr<ModbusEventLoop>());
+
+        // put message into mToModbusQueue and wake up modbus thread
+        void sendToModbus(const QueueItem& item);
 
         void sendCommand(const MqttObjectCommand& cmd, const ModbusRegisters& reg_values) {
             MsgRegisterValues val(
@@ -35,13 +39,13 @@ class ModbusClient {
             // TODO add max queue size
             // here or at mqtt level - add configurable global limit for all queues
             // to i.e. 15Mb and cut the largest one after reaching this limit
-            mToModbusQueue.enqueue(QueueItem::create(val));
+            sendToModbus(QueueItem::create(val));
         }
 
         void sendMqttNetworkIsUp(bool up) {
             // TODO send all control messages at the front of queue, add time period
             // after receiving shutdown request to empty write queues
-            mToModbusQueue.enqueue(QueueItem::create(MsgMqttNetworkState(up)));
+            sendToModbus(QueueItem::create(MsgMqttNetworkState(up)));
         }
 
         std::string mNetworkName;
@@ -49,10 +53,11 @@ class ModbusClient {
         void stop();
         ~ModbusClient() { stop(); }
     private:
-        static void threadLoop(moodycamel::BlockingReaderWriterQueue<QueueItem>& in, moodycamel::BlockingReaderWriterQueue<QueueItem>& out);
+        static void threadLoop(moodycamel::BlockingReaderWriterQueue<QueueItem>& in, moodycamel::BlockingReaderWriterQueue<QueueItem>& out, QueueSignal& outSignal);
 
         ModbusClient(const ModbusClient&);
         std::shared_ptr<std::thread> mModbusThread;
+        std::shared_ptr<ModbusEventLoop::Network> mLoopNetwork;
 };
 
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 
 #include "modbus_context.hpp"
 #include "register_poll.hpp"
@@ -131,55 +133,45 @@ ModbusContext::disconnect() {
 
 std::vector<uint16_t>
 ModbusContext::readModbusRegisters(int slaveId, const RegisterPoll& regData) {
+    std::vector<uint16_t> ret;
+    readModbusRegistersInto(slaveId, regData, ret);
+    return ret;
+}
+
+void
+ModbusContext::readModbusRegistersInto(int slaveId, const RegisterPoll& regData, std::vector<uint16_t>& pValues) {
     // TODO not used, make slave optional for tcp in ModMqtt::initObjects and pass -1 in this case
     if (slaveId != -1)
         modbus_set_slave(mCtx, slaveId);
     else
         modbus_set_slave(mCtx, MODBUS_TCP_SLAVE);
 
-    uint8_t bits;
-    std::vector<uint16_t> ret(regData.getCount(), 0);
-    int arraySize = 0;
+    int arraySize = regData.getCount();
+    pValues.resize(arraySize);
     int retCode;
     switch(regData.mRegisterType) {
         //for COIL and BIT store bits in uint16_t array
         case RegisterType::COIL: {
-            arraySize = regData.getCount();
-            std::shared_ptr<uint8_t> values((uint8_t*)malloc(arraySize), free);
-            std::memset(values.get(), 0x0, arraySize);
-            retCode = modbus_read_bits(mCtx, regData.mRegister, regData.getCount(), (uint8_t*)values.get());
-            for(int i = 0; i < arraySize; i++)
-                ret[i] = values.get()[i];
+            mBitBuffer.assign(arraySize, 0);
+            retCode = modbus_read_bits(mCtx, regData.mRegister, arraySize, mBitBuffer.data());
+            std::copy(mBitBuffer.begin(), mBitBuffer.end(), pValues.begin());
         } break;
         case RegisterType::BIT: {
-            arraySize = regData.getCount();
-            std::shared_ptr<uint8_t> values((uint8_t*)malloc(arraySize), free);
-            std::memset(values.get(), 0x0, arraySize);
-            retCode = modbus_read_input_bits(mCtx, regData.mRegister, regData.getCount(), (uint8_t*)values.get());
-            for(int i = 0; i < arraySize; i++)
-                ret[i] = values.get()[i];
-        } break;
-        case RegisterType::HOLDING: {
-            arraySize = regData.getCount();
-            std::shared_ptr<uint16_t> values((uint16_t*)malloc(sizeof(uint16_t) * arraySize), free);
-            retCode = modbus_read_registers(mCtx, regData.mRegister, regData.getCount(), values.get());
-            for(int i = 0; i < arraySize; i++)
-                ret[i] = values.get()[i];
-        } break;
-        case RegisterType::INPUT: {
-            arraySize = regData.getCount();
-            std::shared_ptr<uint16_t> values((uint16_t*)malloc(sizeof(uint16_t) * arraySize), free);
-            retCode = modbus_read_input_registers(mCtx, regData.mRegister, regData.getCount(), values.get());
-            for(int i = 0; i < arraySize; i++)
-                ret[i] = values.get()[i];
+            mBitBuffer.assign(arraySize, 0);
+            retCode = modbus_read_input_bits(mCtx, regData.mRegister, arraySize, mBitBuffer.data());
+            std::copy(mBitBuffer.begin(), mBitBuffer.end(), pValues.begin());
         } break;
+        case RegisterType::HOLDING:
+            retCode = modbus_read_registers(mCtx, regData.mRegister, arraySize, pValues.data());
+        break;
+        case RegisterType::INPUT:
+            retCode = modbus_read_input_registers(mCtx, regData.mRegister, arraySize, pValues.data());
+        break;
         default:
             throw ModbusContextException(std::string("Cannot read, unknown register type ") + std::to_string(regData.mRegisterType));
     }
     if (retCode == -1)
         throw ModbusReadException(std::string("read fn ") + std::to_string(regData.mRegister) + std::string(" failed with return code ") + std::to_string(retCode));
-
-    return ret;
 }
 
 void
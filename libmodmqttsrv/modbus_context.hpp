@@ -5,6 +5,7 @@
 #include "modbus_messages.hpp"
 #include "logging.hpp"
 #include "imodbuscontext.hpp"
+#include "modbus_pipeline_context.hpp"
 
 namespace modmqttd {
 
@@ -18,6 +19,7 @@ class ModbusContext : public IModbusContext {
         virtual bool isConnected() const { return mIsConnected; }
         virtual void disconnect();
         virtual std::vector<uint16_t> readModbusRegisters(int slaveId, const RegisterPoll& regData);
+        virtual void readModbusRegistersInto(int slaveId, const RegisterPoll& regData, std::vector<uint16_t>& pValues);
         virtual void writeModbusRegisters(int slaveId, const RegisterWrite& msg);
         virtual ModbusNetworkConfig::Type getNetworkType() const { return mNetworkType; }
         virtual ~ModbusContext() {
@@ -30,6 +32,8 @@ class ModbusContext : public IModbusContext {
         ModbusNetworkConfig::Type mNetworkType;
         std::string mNetworkAddress;
         modbus_t* mCtx = NULL;
+        // scratch buffer for modbus_read_bits and modbus_read_input_bits
+        std::vector<uint8_t> mBitBuffer;
 };
 
 class ModbusFactory : public IModbusFactory {
@@ -37,18 +41,28 @@ class ModbusFactory : public IModbusFactory {
         virtual std::shared_ptr<IModbusContext> getContext(const std::string& networkName) {
             return std::shared_ptr<IModbusContext>(new ModbusContext());
         }
+        virtual std::shared_ptr<IModbusContext> getNetworkContext(const ModbusNetworkConfig& config) {
+            if (config.mType == ModbusNetworkConfig::TCPIP && config.mPipelineDepth > 1)
+                return std::shared_ptr<IModbusContext>(new ModbusPipelineContext());
+            return getContext(config.mName);
+        }
 };
 
 class ModbusContextException : public ModMqttException {
     public:
-        ModbusContextException(const std::string& what) {
-            mWhat = std::string("libmodbus: ") + what + ": " + modbus_strerror(errno);
+        ModbusContextException(const std::string& what) : mErrno(errno) {
+            mWhat = std::string("libmodbus: ") + what + ": " + modbus_strerror(mErrno);
         }
+        int getErrno() const { return mErrno; }
+    protected:
+        int mErrno;
 };
 
 class ModbusReadException : public ModbusContextException {
     public:
         ModbusReadException(const std::string& what) : ModbusContextException(what) {}
+        // slave responded with ILLEGAL DATA ADDRESS exception
+        bool isIllegalDataAddress() const { return mErrno == EMBXILADD; }
 };
 
 class ModbusWriteException : public ModbusContextException {
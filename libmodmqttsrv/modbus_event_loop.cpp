@@ -0,0 +1,200 @@
+#include <cstring>
+#include <set>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "modbus_event_loop.hpp"
+#include "modbus_thread.hpp"
+#include "exceptions.hpp"
+
+namespace modmqttd {
+
+boost::log::sources::severity_logger<Log::severity> ModbusEventLoop::log;
+
+static void
+checkDescriptor(int fd, const char* name) {
+    if (fd == -1)
+        throw ModMqttException(std::string("Cannot create ") + name + ": " + strerror(errno));
+}
+
+static void
+clearDescriptor(int fd) {
+    uint64_t value;
+    while (read(fd, &value, sizeof(value)) > 0)
+        ;
+}
+
+static void
+watchDescriptor(int epollFd, int fd, void* data) {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = data;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == -1)
+        throw ModMqttException(std::string("Cannot add descriptor to epoll: ") + strerror(errno));
+}
+
+void
+ModbusEventLoop::Network::notify() {
+    uint64_t value = 1;
+    if (write(mEventFd, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+        BOOST_LOG_SEV(log, Log::error) << "Cannot notify modbus network: " << strerror(errno);
+    }
+}
+
+void
+ModbusEventLoop::Network::waitFinished() {
+    mFinishedPromise.get_future().wait();
+}
+
+ModbusEventLoop::Network::~Network() {
+    if (mEventFd != -1)
+        close(mEventFd);
+    if (mTimerFd != -1)
+        close(mTimerFd);
+}
+
+ModbusEventLoop::ModbusEventLoop(int pWorkerCount) {
+    for(int i = 0; i < pWorkerCount; i++) {
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        checkDescriptor(worker->mEpollFd, "epoll instance");
+        worker->mStopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        checkDescriptor(worker->mStopFd, "eventfd");
+        watchDescriptor(worker->mEpollFd, worker->mStopFd, nullptr);
+        worker->mThread = std::thread(workerLoop, std::ref(*worker));
+        mWorkers.push_back(std::move(worker));
+    }
+    BOOST_LOG_SEV(log, Log::info) << "Started " << pWorkerCount << " modbus worker thread(s)";
+}
+
+ModbusEventLoop::~ModbusEventLoop() {
+    for(auto& worker: mWorkers) {
+        uint64_t value = 1;
+        if (write(worker->mStopFd, &value, sizeof(value)) == -1) {
+            BOOST_LOG_SEV(log, Log::error) << "Cannot stop modbus worker: " << strerror(errno);
+        }
+        worker->mThread.join();
+        close(worker->mStopFd);
+        close(worker->mEpollFd);
+    }
+}
+
+std::shared_ptr<ModbusEventLoop::Network>
+ModbusEventLoop::addNetwork(
+    moodycamel::BlockingReaderWriterQueue<QueueItem>& toModbusQueue,
+    moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue,
+    QueueSignal& fromModbusSignal)
+{
+    std::shared_ptr<Network> network(new Network());
+    network->mThread.reset(new ModbusThread(toModbusQueue, fromModbusQueue, fromModbusSignal));
+    network->mEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    checkDescriptor(network->mEventFd, "eventfd");
+    network->mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    checkDescriptor(network->mTimerFd, "timerfd");
+
+    Worker& worker = *mWorkers[mNextWorker];
+    mNextWorker = (mNextWorker + 1) % mWorkers.size();
+    {
+        std::unique_lock<std::mutex> lock(worker.mMutex);
+        worker.mNetworks[network.get()] = network;
+    }
+    watchDescriptor(worker.mEpollFd, network->mEventFd, network.get());
+    watchDescriptor(worker.mEpollFd, network->mTimerFd, network.get());
+
+    // first step() is done when initial messages are queued
+    // and notify() is called
+    return network;
+}
+
+void
+ModbusEventLoop::armTimer(Network& network, const std::chrono::steady_clock::duration& pWait) {
+    struct itimerspec spec = {};
+    if (pWait <= std::chrono::steady_clock::duration::zero()) {
+        // let other networks assigned to this worker run
+        // before the next step
+        network.notify();
+    } else if (pWait != std::chrono::steady_clock::duration::max()) {
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(pWait);
+        spec.it_value.tv_sec = secs.count();
+        spec.it_value.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(pWait - secs).count();
+    }
+    // zeroed spec disarms timer, we wait for messages only
+    if (timerfd_settime(network.mTimerFd, 0, &spec, nullptr) == -1) {
+        BOOST_LOG_SEV(log, Log::error) << "Cannot arm timer for modbus network: " << strerror(errno);
+    }
+}
+
+void
+ModbusEventLoop::runNetwork(Network& network) {
+    clearDescriptor(network.mEventFd);
+    clearDescriptor(network.mTimerFd);
+
+    ModbusThread& thread(*network.mThread);
+    try {
+        thread.dispatchQueuedMessages();
+        if (thread.isRunning()) {
+            armTimer(network, thread.step());
+            return;
+        }
+        thread.finish();
+    } catch (const std::exception& ex) {
+        BOOST_LOG_SEV(log, Log::critical) << "Error in modbus network " << thread.getNetworkName() << ": " << ex.what();
+    } catch (...) {
+        BOOST_LOG_SEV(log, Log::critical) << "Unknown error in modbus network " << thread.getNetworkName();
+    }
+    network.mFinished = true;
+}
+
+void
+ModbusEventLoop::removeNetwork(Worker& worker, Network* network) {
+    epoll_ctl(worker.mEpollFd, EPOLL_CTL_DEL, network->mEventFd, nullptr);
+    epoll_ctl(worker.mEpollFd, EPOLL_CTL_DEL, network->mTimerFd, nullptr);
+
+    std::shared_ptr<Network> ptr;
+    {
+        std::unique_lock<std::mutex> lock(worker.mMutex);
+        auto it = worker.mNetworks.find(network);
+        ptr = it->second;
+        worker.mNetworks.erase(it);
+    }
+    ptr->mFinishedPromise.set_value();
+}
+
+void
+ModbusEventLoop::workerLoop(Worker& worker) {
+    const int maxEvents = 64;
+    struct epoll_event events[maxEvents];
+    bool shouldRun = true;
+
+    BOOST_LOG_SEV(log, Log::debug) << "Modbus worker thread started";
+    while(shouldRun) {
+        int count = epoll_wait(worker.mEpollFd, events, maxEvents, -1);
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            BOOST_LOG_SEV(log, Log::critical) << "Modbus worker epoll_wait failed: " << strerror(errno);
+            break;
+        }
+
+        // eventfd and timerfd of the same network can be ready
+        // at once, step() it only once
+        std::set<Network*> ready;
+        for(int i = 0; i < count; i++) {
+            if (events[i].data.ptr == nullptr)
+                shouldRun = false;
+            else
+                ready.insert(static_cast<Network*>(events[i].data.ptr));
+        }
+
+        for(Network* network: ready) {
+            runNetwork(*network);
+            if (network->mFinished)
+                removeNetwork(worker, network);
+        }
+    }
+    BOOST_LOG_SEV(log, Log::debug) << "Modbus worker thread ended";
+}
+
+}
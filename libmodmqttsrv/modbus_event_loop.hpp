@@ -0,0 +1,75 @@
+#pragma once
+
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "../readerwriterqueue/readerwriterqueue.h"
+
+#include "logging.hpp"
+#include "queue_item.hpp"
+#include "queue_signal.hpp"
+
+namespace modmqttd {
+
+class ModbusThread;
+
+/**
+ * Runs ModbusThread state machines of multiple modbus networks
+ * on a fixed number of worker threads.
+ *
+ * Every network has an eventfd signalled when a message is put
+ * into its queue and a timerfd armed with the wait time
+ * returned by ModbusThread::step(). Both are watched by epoll
+ * instance of the worker the network is assigned to.
+ *
+ * Used when modmqttd.modbus_worker_threads is set
+ * */
+class ModbusEventLoop {
+    public:
+        class Network {
+            public:
+                // wake up network after a message was put into its queue
+                void notify();
+                // blocks until network processes EndWorkMessage
+                void waitFinished();
+                ~Network();
+            private:
+                friend class ModbusEventLoop;
+
+                std::unique_ptr<ModbusThread> mThread;
+                int mEventFd = -1;
+                int mTimerFd = -1;
+                bool mFinished = false;
+                std::promise<void> mFinishedPromise;
+        };
+
+        ModbusEventLoop(int pWorkerCount);
+        std::shared_ptr<Network> addNetwork(
+            moodycamel::BlockingReaderWriterQueue<QueueItem>& toModbusQueue,
+            moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue,
+            QueueSignal& fromModbusSignal);
+        int getWorkerCount() const { return mWorkers.size(); }
+        ~ModbusEventLoop();
+    private:
+        struct Worker {
+            int mEpollFd = -1;
+            int mStopFd = -1;
+            std::thread mThread;
+            std::mutex mMutex;
+            std::map<Network*, std::shared_ptr<Network>> mNetworks;
+        };
+
+        static boost::log::sources::severity_logger<Log::severity> log;
+
+        std::vector<std::unique_ptr<Worker>> mWorkers;
+        std::size_t mNextWorker = 0;
+
+        static void workerLoop(Worker& worker);
+        static void runNetwork(Network& network);
+        static void armTimer(Network& network, const std::chrono::steady_clock::duration& pWait);
+        static void removeNetwork(Worker& worker, Network* network);
+};
+
+}
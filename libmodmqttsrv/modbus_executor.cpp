@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iomanip>
 #include <cassert>
 
@@ -31,7 +32,98 @@ ModbusExecutor::ModbusExecutor(
 
 void
 ModbusExecutor::sendMessage(const QueueItem& item) {
-    ModbusThread::sendMessageFromModbus(mFromModbusQueue, item);
+    // keep order of messages
+    flushRegisterValues();
+    if (!mValuesBatch.mValues.empty() || !mHeldMessages.empty()) {
+        // write confirmation cannot overtake held older values
+        holdMessage(item);
+        return;
+    }
+    ModbusThread::sendMessageFromModbus(mFromModbusQueue, mFromModbusSignal, item);
+}
+
+bool
+ModbusExecutor::isUpdatesQueueFull() const {
+    return mMaxQueuedUpdates > 0 && mFromModbusQueue.size_approx() >= std::size_t(mMaxQueuedUpdates);
+}
+
+void
+ModbusExecutor::sendRegisterValues(const MsgRegisterValues& pValues) {
+    if (isUpdatesQueueFull()) {
+        holdRegisterValues(pValues);
+        return;
+    }
+
+    if (mMaxBatchDelay == std::chrono::milliseconds::zero()) {
+        sendMessage(QueueItem::create(pValues));
+        return;
+    }
+
+    if (mValuesBatch.mValues.empty())
+        mBatchStartTime = std::chrono::steady_clock::now();
+    mValuesBatch.mValues.push_back(pValues);
+}
+
+void
+ModbusExecutor::holdMessage(const QueueItem& pItem) {
+    // values held so far are sent before pItem,
+    // later values are collected in a new batch
+    if (!mValuesBatch.mValues.empty()) {
+        mHeldMessages.push_back(QueueItem::create(mValuesBatch));
+        mValuesBatch.mValues.clear();
+        mHeldValuesIndex.clear();
+    }
+    mHeldMessages.push_back(pItem);
+}
+
+void
+ModbusExecutor::holdRegisterValues(const MsgRegisterValues& pValues) {
+    if (mValuesBatch.mValues.empty() && mHeldMessages.empty()) {
+        mBatchStartTime = std::chrono::steady_clock::now();
+        BOOST_LOG_SEV(log, Log::warn) << "Queue to main thread is full, holding register values";
+    }
+
+    if (mHeldValuesIndex.empty()) {
+        for(std::size_t i = 0; i < mValuesBatch.mValues.size(); i++) {
+            const MsgRegisterValues& val(mValuesBatch.mValues[i]);
+            mHeldValuesIndex[std::make_tuple(val.mSlaveId, val.mRegisterType, val.mRegister)] = i;
+        }
+    }
+
+    auto res = mHeldValuesIndex.emplace(
+        std::make_tuple(pValues.mSlaveId, pValues.mRegisterType, pValues.mRegister),
+        mValuesBatch.mValues.size()
+    );
+    if (res.second) {
+        mValuesBatch.mValues.push_back(pValues);
+    } else {
+        // only the latest value is published
+        mValuesBatch.mValues[res.first->second] = pValues;
+        mCollapsedValueCount++;
+    }
+}
+
+void
+ModbusExecutor::flushRegisterValues() {
+    // held values are sent when main thread catches up
+    if ((mValuesBatch.mValues.empty() && mHeldMessages.empty()) || isUpdatesQueueFull())
+        return;
+
+    bool held = !mHeldMessages.empty() || !mHeldValuesIndex.empty();
+    for(const QueueItem& item: mHeldMessages)
+        ModbusThread::sendMessageFromModbus(mFromModbusQueue, mFromModbusSignal, item);
+    mHeldMessages.clear();
+
+    if (!mValuesBatch.mValues.empty()) {
+        BOOST_LOG_SEV(log, Log::trace) << "Sending batch of " << mValuesBatch.mValues.size() << " register values";
+        ModbusThread::sendMessageFromModbus(mFromModbusQueue, mFromModbusSignal, QueueItem::create(mValuesBatch));
+        mValuesBatch.mValues.clear();
+    }
+    if (held) {
+        BOOST_LOG_SEV(log, Log::info) << "Sent held register values, "
+            << mCollapsedValueCount << " outdated value(s) skipped so far";
+        mHeldValuesIndex.clear();
+    }
 }
 
 void
@@ -132,7 +224,15 @@ ModbusExecutor::addWriteCommand(const std::shared_ptr<RegisterWrite>& pCommand)
         resetCommandsCounter();
     } else {
         ModbusRequestsQueues& queue = mSlaveQueues[pCommand->mSlaveId];
-        queue.addWriteCommand(pCommand);
+        if (mMaxQueuedWrites > 0 && mWriteCommandsQueued >= mMaxQueuedWrites) {
+            if (!handleWriteOverflow(pCommand, queue))
+                return;
+        }
+        if (!queue.addWriteCommand(pCommand, mCoalesceWrites)) {
+            BOOST_LOG_SEV(log, Log::debug) << "Write to " << pCommand->mSlaveId << "." << pCommand->mRegister
+                << " (" << pCommand->getCount() << ") merged with queued write";
+            return;
+        }
         if (mCurrentSlaveQueue == mSlaveQueues.end()) {
             mCurrentSlaveQueue = mSlaveQueues.find(pCommand->mSlaveId);
             resetCommandsCounter();
@@ -141,37 +241,59 @@ ModbusExecutor::addWriteCommand(const std::shared_ptr<RegisterWrite>& pCommand)
     mWriteCommandsQueued++;
 }
 
+bool
+ModbusExecutor::handleWriteOverflow(const std::shared_ptr<RegisterWrite>& pCommand, ModbusRequestsQueues& pQueue) {
+    if (pQueue.replaceWriteCommand(pCommand)) {
+        mReplacedWriteCount++;
+        reportWriteOverflow("replacing queued write with", *pCommand);
+        return false;
+    }
+
+    if (mWriteOverflowPolicy == ModbusNetworkConfig::WriteOverflowPolicy::DROP_OLDEST) {
+        std::shared_ptr<RegisterWrite> dropped(pQueue.dropOldestWrite());
+        for(auto it = mSlaveQueues.begin(); dropped == nullptr && it != mSlaveQueues.end(); it++)
+            dropped = it->second.dropOldestWrite();
+
+        // all writes can be in progress, then drop the new one
+        if (dropped != nullptr) {
+            mWriteCommandsQueued--;
+            mDroppedWriteCount++;
+            reportWriteOverflow("dropping oldest write to", *dropped);
+            return true;
+        }
+    }
+
+    mDroppedWriteCount++;
+    reportWriteOverflow("dropping", *pCommand);
+    return false;
+}
+
+void
+ModbusExecutor::reportWriteOverflow(const char* pAction, const RegisterWrite& pCommand) {
+    Log::severity level = Log::debug;
+    if (!mWriteOverflowReported) {
+        level = Log::warn;
+        mWriteOverflowReported = true;
+    }
+    BOOST_LOG_SEV(log, level) << "Write queue is full (" << mMaxQueuedWrites << "), " << pAction << " "
+        << pCommand.mSlaveId << "." << pCommand.mRegister << " (" << pCommand.getCount() << ")"
+        << ", dropped: " << mDroppedWriteCount << ", replaced: " << mReplacedWriteCount;
+}
 
 void
 ModbusExecutor::pollRegisters(RegisterPoll& reg, bool forceSend) {
     try {
         std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-        std::vector<uint16_t> newValues(mModbus->readModbusRegisters(reg.mSlaveId, reg));
-        reg.mLastReadOk = true;
+        mModbus->readModbusRegistersInto(reg.mSlaveId, reg, mReadBuffer);
 
         std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
         BOOST_LOG_SEV(log, Log::trace) << "Register " << reg.mSlaveId << "." << reg.mRegister << " (0x" << std::hex << reg.mSlaveId << ".0x" << std::hex << reg.mRegister << ")"
                         << " polled in "  << std::dec << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms";
 
-        if (reg.mPublishMode == PublishMode::EVERY_POLL)
-            forceSend = true;
-
-        if ((reg.getValues() != newValues) || forceSend || (reg.mReadErrors != 0)) {
-            MsgRegisterValues val(reg.mSlaveId, reg.mRegisterType, reg.mRegister, newValues);
-            sendMessage(QueueItem::create(val));
-            reg.update(newValues);
-            if (reg.mReadErrors != 0) {
-                BOOST_LOG_SEV(log, Log::debug) << "Register "
-                    << reg.mSlaveId << "." << reg.mRegister
-                    << " read ok after " << reg.mReadErrors << " error(s)";
-            }
-            reg.mReadErrors = 0;
-            BOOST_LOG_SEV(log, Log::trace) << "Register " << reg.mSlaveId << "." << reg.mRegister
-                << " values sent, data=" << DebugTools::registersToStr(reg.getValues());
-        };
+        handleRegisterValues(reg, mReadBuffer, forceSend);
     } catch (const ModbusReadException& ex) {
-        handleRegisterReadError(reg, ex.what());
+        handleRegisterReadException(reg, ex);
     }
     // set mLastRead regardless if modbus command was successful or not
     // ModbusScheduler should not reschedule again after failed read
@@ -180,6 +302,106 @@ ModbusExecutor::pollRegisters(RegisterPoll& reg, bool forceSend) {
     mLastCommandTime = reg.mLastRead = std::chrono::steady_clock::now();
 };
 
+void
+ModbusExecutor::pollRegisterList(const std::vector<std::shared_ptr<RegisterPoll>>& pRegisters, bool forceSend) {
+    const RegisterPoll& first(*pRegisters.front());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<ModbusReadResult> results(mModbus->readModbusRegisterList(first.mSlaveId, pRegisters));
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    BOOST_LOG_SEV(log, Log::trace) << pRegisters.size() << " registers from " << first.mSlaveId << "." << first.mRegister
+                    << " polled in "  << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms";
+
+    for(std::size_t i = 0; i < pRegisters.size(); i++) {
+        RegisterPoll& reg(*pRegisters[i]);
+        try {
+            if (results[i].mError)
+                std::rethrow_exception(results[i].mError);
+            handleRegisterValues(reg, results[i].mValues, forceSend);
+        } catch (const ModbusReadException& ex) {
+            handleRegisterReadException(reg, ex);
+        }
+        reg.mLastRead = end;
+    }
+    mLastCommandTime = end;
+}
+
+void
+ModbusExecutor::handleRegisterValues(RegisterPoll& reg, const std::vector<uint16_t>& newValues, bool forceSend) {
+    reg.mLastReadOk = true;
+
+    // aggregated values are sampled on every poll
+    if (reg.mPublishMode == PublishMode::EVERY_POLL || reg.mPublishMode == PublishMode::AGGREGATE)
+        forceSend = true;
+
+    if (reg.mReadErrors != 0 || reg.mFirstPoll)
+        forceSend = true;
+
+    if (reg.mDeliveryRanges.empty()) {
+        bool changed = reg.getValues() != newValues;
+        if (changed && !forceSend && reg.isInsideDeadband(newValues, 0, newValues.size())) {
+            changed = false;
+            mSuppressedUpdateCount++;
+        }
+        if (changed || forceSend) {
+            MsgRegisterValues val(reg.mSlaveId, reg.mRegisterType, reg.mRegister, newValues);
+            sendRegisterValues(val);
+            reg.update(newValues);
+            BOOST_LOG_SEV(log, Log::trace) << "Register " << reg.mSlaveId << "." << reg.mRegister
+                << " values sent, data=" << DebugTools::registersToStr(reg.getValues());
+        }
+    } else {
+        // coalesced read, send only registers that are used by mqtt objects
+        const std::vector<uint16_t>& oldValues(reg.getValues());
+        for(const ModbusAddressRange& range: reg.mDeliveryRanges) {
+            int offset = range.mRegister - reg.mRegister;
+            auto first = newValues.begin() + offset;
+            auto last = first + range.mCount;
+            auto old_first = oldValues.begin() + offset;
+            bool changed = !std::equal(first, last, old_first);
+            if (changed && !forceSend && reg.isInsideDeadband(newValues, offset, range.mCount)) {
+                changed = false;
+                mSuppressedUpdateCount++;
+            }
+            if (changed || forceSend) {
+                MsgRegisterValues val(reg.mSlaveId, reg.mRegisterType, range.mRegister, std::vector<uint16_t>(first, last));
+                sendRegisterValues(val);
+                BOOST_LOG_SEV(log, Log::trace) << "Register " << reg.mSlaveId << "." << range.mRegister
+                    << " values sent, data=" << DebugTools::registersToStr(val.mRegisters.values());
+                // keep last sent values of suppressed ranges
+                // as a reference for deadband
+                if (reg.hasDeadbands())
+                    reg.updateRange(newValues, offset, range.mCount);
+            }
+        }
+        if (!reg.hasDeadbands())
+            reg.update(newValues);
+    }
+
+    if (reg.mReadErrors != 0) {
+        BOOST_LOG_SEV(log, Log::debug) << "Register "
+            << reg.mSlaveId << "." << reg.mRegister
+            << " read ok after " << reg.mReadErrors << " error(s)";
+    }
+    reg.mReadErrors = 0;
+    reg.mFirstPoll = false;
+}
+
+void
+ModbusExecutor::handleRegisterReadException(RegisterPoll& reg, const ModbusReadException& ex) {
+    if (ex.isIllegalDataAddress() && reg.canBisect()) {
+        // slave does not support some register in gap between
+        // delivery ranges, do not count this as read error
+        BOOST_LOG_SEV(log, Log::info) << "Register " << reg.mSlaveId << "." << reg.mRegister
+            << " (" << reg.getCount() << ") read rejected with illegal data address, splitting read";
+        reg.mLastReadOk = false;
+        reg.mSplitRequired = true;
+    } else {
+        handleRegisterReadError(reg, ex.what());
+    }
+}
+
 void
 ModbusExecutor::handleRegisterReadError(RegisterPoll& regPoll, const char* errorMessage) {
     // avoid flooding logs with register read error messages - log last error every 5 minutes
@@ -196,8 +418,15 @@ ModbusExecutor::handleRegisterReadError(RegisterPoll& regPoll, const char* error
 
     // start sending MsgRegisterReadFailed if we cannot read register DefaultReadErrorCount times
     if (regPoll.mReadErrors > RegisterPoll::DefaultReadErrorCount) {
-        MsgRegisterReadFailed msg(regPoll.mSlaveId, regPoll.mRegisterType, regPoll.mRegister, regPoll.getCount());
-        sendMessage(QueueItem::create(msg));
+        if (regPoll.mDeliveryRanges.empty()) {
+            MsgRegisterReadFailed msg(regPoll.mSlaveId, regPoll.mRegisterType, regPoll.mRegister, regPoll.getCount());
+            sendMessage(QueueItem::create(msg));
+        } else {
+            for(const ModbusAddressRange& range: regPoll.mDeliveryRanges) {
+                MsgRegisterReadFailed msg(regPoll.mSlaveId, range.mRegisterType, range.mRegister, range.mCount);
+                sendMessage(QueueItem::create(msg));
+            }
+        }
     }
 }
 
@@ -213,9 +442,11 @@ ModbusExecutor::writeRegisters(RegisterWrite& cmd) {
                         << " written in "  << std::dec << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms"
                         << ", processing time "  << std::dec << std::chrono::duration_cast<std::chrono::milliseconds>(start - cmd.mCreationTime).count() << "ms";
 
-        if (cmd.mReturnMessage != nullptr) {
-            cmd.mReturnMessage->mRegisters = ModbusRegisters(cmd.getValues());
-            sendMessage(QueueItem::create(*cmd.mReturnMessage));
+        for(const std::shared_ptr<MsgRegisterValues>& msg: cmd.mReturnMessages) {
+            // merged write could overwrite values of this command
+            auto first = cmd.getValues().begin() + (msg->mRegister - cmd.mRegister);
+            msg->mRegisters = ModbusRegisters(std::vector<uint16_t>(first, first + msg->mCount));
+            sendMessage(QueueItem::create(*msg));
         }
     } catch (const ModbusWriteException& ex) {
         BOOST_LOG_SEV(log, Log::error) << "error writing register "
@@ -230,6 +461,20 @@ ModbusExecutor::writeRegisters(RegisterWrite& cmd) {
 
 std::chrono::steady_clock::duration
 ModbusExecutor::executeNext() {
+    std::chrono::steady_clock::duration ret = executeNextCommand();
+    if (!mValuesBatch.mValues.empty() || !mHeldMessages.empty()) {
+        if (ret != std::chrono::steady_clock::duration::zero()
+            || allDone()
+            || std::chrono::steady_clock::now() - mBatchStartTime >= mMaxBatchDelay
+        ) {
+            flushRegisterValues();
+        }
+    }
+    return ret;
+}
+
+std::chrono::steady_clock::duration
+ModbusExecutor::executeNextCommand() {
     //assert(!allDone());
     if (mWaitingCommand == nullptr) {
         // find next non empty queue and start sending requests from it
@@ -309,8 +554,19 @@ ModbusExecutor::sendCommand() {
 
     if (typeid(*mWaitingCommand) == typeid(RegisterPoll)) {
         RegisterPoll& pollcmd(static_cast<RegisterPoll&>(*mWaitingCommand));
-        pollRegisters(pollcmd, mInitialPoll);
-        if (!pollcmd.mLastReadOk) {
+        if (mWaitingCommand != mLastCommand)
+            mReadRetryCount = std::max(0, mReadRetryCount - pollcmd.mPipelinedRetryCount);
+        std::vector<std::shared_ptr<RegisterPoll>> pipelined(popPipelinedPolls());
+        if (pipelined.size() > 1) {
+            pollRegisterList(pipelined, mInitialPoll);
+            requeuePipelinedPolls(pipelined);
+        } else {
+            pollRegisters(pollcmd, mInitialPoll);
+        }
+
+        if (pollcmd.mSplitRequired) {
+            mRegistersToSplit.push_back(std::static_pointer_cast<RegisterPoll>(mWaitingCommand));
+        } else if (!pollcmd.mLastReadOk) {
             if (mReadRetryCount != 0) {
                 retry = true;
                 mReadRetryCount--;
@@ -318,18 +574,24 @@ ModbusExecutor::sendCommand() {
         } else {
             mReadRetryCount = mMaxReadRetryCount;
         }
+        if (!retry)
+            pollcmd.mPipelinedRetryCount = 0;
     } else {
         RegisterWrite& writecmd(static_cast<RegisterWrite&>(*mWaitingCommand));
         writeRegisters(writecmd);
-        if (!writecmd.mLastWriteOk) {
-            if (mWriteRetryCount != 0) {
-                retry = true;
-                mWriteRetryCount--;
-            }
+        if (!writecmd.mLastWriteOk && mWriteRetryCount != 0) {
+            retry = true;
+            mWriteRetryCount--;
         } else {
+            // write is finished, successfully or not
             mWriteRetryCount = mMaxWriteRetryCount;
             mWriteCommandsQueued--;
             assert(mWriteCommandsQueued >= 0);
+            if (mWriteOverflowReported && mWriteCommandsQueued < mMaxQueuedWrites) {
+                BOOST_LOG_SEV(log, Log::info) << "Write queue is below limit (" << mMaxQueuedWrites
+                    << "), dropped writes: " << mDroppedWriteCount << ", replaced writes: " << mReplacedWriteCount;
+                mWriteOverflowReported = false;
+            }
         }
     }
     mLastCommand = mWaitingCommand;
@@ -344,6 +606,54 @@ ModbusExecutor::sendCommand() {
 }
 
 
+std::vector<std::shared_ptr<RegisterPoll>>
+ModbusExecutor::popPipelinedPolls() {
+    std::vector<std::shared_ptr<RegisterPoll>> ret;
+    int maxRequests = mModbus->getMaxPipelinedRequests();
+    if (maxRequests < 2 || mWaitingCommand->hasDelay() || mCurrentSlaveQueue == mSlaveQueues.end())
+        return ret;
+
+    ret.push_back(std::static_pointer_cast<RegisterPoll>(mWaitingCommand));
+
+    // requests with delay need silence on the bus, they are
+    // sent one by one later
+    std::deque<std::shared_ptr<RegisterPoll>>& queue(mCurrentSlaveQueue->second.mPollQueue);
+    while (!queue.empty() && ret.size() < std::size_t(maxRequests) && !queue.front()->hasDelay()) {
+        ret.push_back(queue.front());
+        queue.pop_front();
+    }
+    return ret;
+}
+
+void
+ModbusExecutor::requeuePipelinedPolls(const std::vector<std::shared_ptr<RegisterPoll>>& pRegisters) {
+    // the first register is mWaitingCommand, retried by sendCommand
+    for(std::size_t i = pRegisters.size() - 1; i > 0; i--) {
+        const std::shared_ptr<RegisterPoll>& reg(pRegisters[i]);
+        if (mCommandsLeft > 0)
+            mCommandsLeft--;
+
+        if (reg->mSplitRequired) {
+            mRegistersToSplit.push_back(reg);
+        } else if (!reg->mLastReadOk && reg->mPipelinedRetryCount < reg->mMaxReadRetryCount) {
+            reg->mPipelinedRetryCount++;
+            mCurrentSlaveQueue->second.readdCommand(reg);
+        } else {
+            // read error is already reported by handleRegisterReadError(),
+            // register is read again in next poll
+            reg->mPipelinedRetryCount = 0;
+        }
+    }
+}
+
+std::vector<std::shared_ptr<RegisterPoll>>
+ModbusExecutor::takeRegistersToSplit() {
+    std::vector<std::shared_ptr<RegisterPoll>> ret;
+    ret.swap(mRegistersToSplit);
+    return ret;
+}
+
+
 bool
 ModbusExecutor::allDone() const {
     if (mWaitingCommand != nullptr)
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <map>
+#include <tuple>
+
 #include "../readerwriterqueue/readerwriterqueue.h"
 
 #include "common.hpp"
@@ -7,6 +10,7 @@
 #include "modbus_request_queues.hpp"
 #include "modbus_context.hpp"
 #include "queue_item.hpp"
+#include "queue_signal.hpp"
 
 namespace modmqttd {
 
@@ -19,6 +23,42 @@ class ModbusExecutor {
             moodycamel::BlockingReaderWriterQueue<QueueItem>& toModbusQueue
         );
         void init(const std::shared_ptr<IModbusContext>& modbus) { mModbus = modbus; }
+        // merge queued writes to the same or consecutive registers
+        void setCoalesceWrites(bool pCoalesce) { mCoalesceWrites = pCoalesce; }
+        // wake up main thread after message is sent, if set
+        void setFromModbusSignal(QueueSignal& pSignal) { mFromModbusSignal = &pSignal; }
+        /**
+         * Collect polled values and send them as MsgRegisterValuesBatch.
+         * Batch is sent when there is nothing to execute immediately or
+         * when the first value waits longer than pDelay. Zero disables batching.
+         * */
+        void setMaxBatchDelay(const std::chrono::milliseconds& pDelay) { mMaxBatchDelay = pDelay; }
+        // send collected register values immediately
+        // unless queue to main thread is full
+        void flushRegisterValues();
+        /**
+         * Limit number of queued write commands. If limit is reached
+         * then a queued write to the same registers is replaced with
+         * the new one, otherwise a write is dropped according to pPolicy.
+         * Zero disables limit.
+         * */
+        void setMaxQueuedWrites(int pMax, ModbusNetworkConfig::WriteOverflowPolicy pPolicy) {
+            mMaxQueuedWrites = pMax;
+            mWriteOverflowPolicy = pPolicy;
+        }
+        /**
+         * Limit number of messages in queue to main thread. If limit is reached
+         * then polled values are held and only the latest value of every
+         * register is sent when main thread catches up. Zero disables limit.
+         * */
+        void setMaxQueuedUpdates(int pMax) { mMaxQueuedUpdates = pMax; }
+
+        // overflow counters
+        unsigned long getDroppedWriteCount() const { return mDroppedWriteCount; }
+        unsigned long getReplacedWriteCount() const { return mReplacedWriteCount; }
+        unsigned long getCollapsedValueCount() const { return mCollapsedValueCount; }
+        // register changes not sent because they were inside register deadband
+        unsigned long getSuppressedUpdateCount() const { return mSuppressedUpdateCount; }
         void setupInitialPoll(const std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>& pRegisters);
         bool allDone() const;
         bool pollDone() const;
@@ -48,12 +88,20 @@ class ModbusExecutor {
         */
         const std::shared_ptr<RegisterCommand>& getLastCommand() const { return mLastCommand; }
 
+        /*
+            Returns coalesced reads rejected by slave with illegal data address
+            exception since the last call. They should be replaced
+            in poll specification with RegisterPoll::bisect() result.
+        */
+        std::vector<std::shared_ptr<RegisterPoll>> takeRegistersToSplit();
+
     private:
         static  boost::log::sources::severity_logger<Log::severity> log;
 
         std::shared_ptr<IModbusContext> mModbus;
         moodycamel::BlockingReaderWriterQueue<QueueItem>& mFromModbusQueue;
         moodycamel::BlockingReaderWriterQueue<QueueItem>& mToModbusQueue;
+        QueueSignal* mFromModbusSignal = nullptr;
 
         std::map<int, ModbusRequestsQueues> mSlaveQueues;
         std::map<int, ModbusRequestsQueues>::iterator mCurrentSlaveQueue;
@@ -77,11 +125,52 @@ class ModbusExecutor {
         std::shared_ptr<RegisterCommand> mWaitingCommand;
         std::shared_ptr<RegisterCommand> mLastCommand;
 
+        std::vector<std::shared_ptr<RegisterPoll>> mRegistersToSplit;
+
+        // values of the last read, reused to avoid allocation on every poll
+        std::vector<uint16_t> mReadBuffer;
+
         bool mInitialPoll;
+        bool mCoalesceWrites = false;
+
+        std::chrono::milliseconds mMaxBatchDelay = std::chrono::milliseconds::zero();
+        MsgRegisterValuesBatch mValuesBatch;
+        std::chrono::steady_clock::time_point mBatchStartTime;
+
+        int mMaxQueuedWrites = 0;
+        ModbusNetworkConfig::WriteOverflowPolicy mWriteOverflowPolicy = ModbusNetworkConfig::WriteOverflowPolicy::DROP_OLDEST;
+        bool mWriteOverflowReported = false;
+        unsigned long mDroppedWriteCount = 0;
+        unsigned long mReplacedWriteCount = 0;
+
+        int mMaxQueuedUpdates = 0;
+        // (slave id, register type, register) -> position in mValuesBatch,
+        // filled only when values are held due to full queue
+        std::map<std::tuple<int, RegisterType, int>, std::size_t> mHeldValuesIndex;
+        // messages sent when values were held, in order with held values
+        std::vector<QueueItem> mHeldMessages;
+        unsigned long mCollapsedValueCount = 0;
+        unsigned long mSuppressedUpdateCount = 0;
         std::chrono::time_point<std::chrono::steady_clock> mInitialPollStart;
 
         void sendCommand();
+        std::chrono::steady_clock::duration executeNextCommand();
+        void sendRegisterValues(const MsgRegisterValues& pValues);
+        void holdRegisterValues(const MsgRegisterValues& pValues);
+        void holdMessage(const QueueItem& pItem);
+        bool isUpdatesQueueFull() const;
+        // returns false if pCommand should be dropped
+        bool handleWriteOverflow(const std::shared_ptr<RegisterWrite>& pCommand, ModbusRequestsQueues& pQueue);
+        void reportWriteOverflow(const char* pAction, const RegisterWrite& pCommand);
         void pollRegisters(RegisterPoll& reg_ptr, bool forceSend);
+        void pollRegisterList(const std::vector<std::shared_ptr<RegisterPoll>>& pRegisters, bool forceSend);
+        void handleRegisterValues(RegisterPoll& reg, const std::vector<uint16_t>& newValues, bool forceSend);
+        void handleRegisterReadException(RegisterPoll& reg, const ModbusReadException& ex);
+        // returns mWaitingCommand and next RegisterPolls from current slave queue
+        // to send without waiting for response, or empty list if pipelining is not possible
+        std::vector<std::shared_ptr<RegisterPoll>> popPipelinedPolls();
+        // queue failed pipelined polls again for retry
+        void requeuePipelinedPolls(const std::vector<std::shared_ptr<RegisterPoll>>& pRegisters);
         void writeRegisters(RegisterWrite& cmd);
         void sendMessage(const QueueItem& item);
         void handleRegisterReadError(RegisterPoll& reg, const char* errorMessage);
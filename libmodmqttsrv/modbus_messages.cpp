@@ -1,6 +1,8 @@
 #include "modbus_messages.hpp"
 
+#include <algorithm>
 #include <deque>
+#include <tuple>
 
 namespace modmqttd {
 
@@ -8,6 +10,8 @@ boost::log::sources::severity_logger<Log::severity> MsgRegisterPollSpecification
 
 #if __cplusplus < 201703L
 constexpr std::chrono::milliseconds MsgRegisterPoll::INVALID_REFRESH;
+constexpr int MsgRegisterPollSpecification::MAX_READ_REGISTERS;
+constexpr int MsgRegisterPollSpecification::MAX_READ_BITS;
 #endif
 
 void
@@ -21,6 +25,11 @@ MsgRegisterPoll::merge(const MsgRegisterPoll& other) {
         mRefreshMsec = other.mRefreshMsec;
         BOOST_LOG_SEV(log, Log::debug) << "Setting refresh " << mRefreshMsec.count() << "ms on existing register " << mRegister;
     }
+
+    // every_poll and aggregate objects need values sent after
+    // every poll, PublishMode values are ordered by this priority
+    if (other.mPublishMode > mPublishMode)
+        mPublishMode = other.mPublishMode;
 }
 
 bool
@@ -113,4 +122,149 @@ MsgRegisterPollSpecification::merge(const MsgRegisterPoll& poll) {
     }
 }
 
+void
+MsgRegisterPollSpecification::addDeadband(int pSlaveId, RegisterType pType, int pRegister, int pCount, const RegisterDeadband& pDeadband) {
+    for(int regNum = pRegister; regNum < pRegister + pCount; regNum++) {
+        std::tuple<int, int, int> key(pSlaveId, pType, regNum);
+        auto it = mDeadbands.find(key);
+        if (it == mDeadbands.end()) {
+            mDeadbands.insert(std::make_pair(key, pDeadband));
+        } else if (it->second.mType != pDeadband.mType || it->second.mSigned != pDeadband.mSigned) {
+            BOOST_LOG_SEV(log, Log::debug) << "Different deadband types for register " << pSlaveId << "." << regNum
+                << " on network " << mNetworkName << ", all changes will be sent";
+            it->second = RegisterDeadband();
+        } else if (pDeadband.mValue < it->second.mValue) {
+            it->second = pDeadband;
+        }
+    }
+}
+
+const RegisterDeadband*
+MsgRegisterPollSpecification::findDeadband(int pSlaveId, RegisterType pType, int pRegister) const {
+    auto it = mDeadbands.find(std::tuple<int, int, int>(pSlaveId, pType, pRegister));
+    if (it == mDeadbands.end() || it->second.isZero())
+        return nullptr;
+    return &(it->second);
+}
+
+int
+MsgRegisterPollSpecification::getMaxGap(int pSlaveId) const {
+    std::map<int, int>::const_iterator it = mSlaveMaxGap.find(pSlaveId);
+    if (it != mSlaveMaxGap.end())
+        return it->second;
+    return mMaxGap;
+}
+
+
+int
+MsgRegisterPollSpecification::getMaxReadCount(int pSlaveId, RegisterType pType) const {
+    int ret = (pType == RegisterType::COIL || pType == RegisterType::BIT) ? MAX_READ_BITS : MAX_READ_REGISTERS;
+    std::map<int, int>::const_iterator it = mSlaveMaxReadRegisters.find(pSlaveId);
+    if (it != mSlaveMaxReadRegisters.end() && it->second < ret)
+        ret = it->second;
+    return ret;
+}
+
+
+void
+MsgRegisterPollSpecification::split() {
+    std::vector<MsgRegisterPoll> result;
+    for(const auto& reg: mRegisters) {
+        int maxCount = getMaxReadCount(reg.mSlaveId, reg.mRegisterType);
+        if (reg.mCount <= maxCount) {
+            result.push_back(reg);
+            continue;
+        }
+
+        BOOST_LOG_SEV(log, Log::debug) << "Splitting register " << reg.mSlaveId << "." << reg.mRegister
+            << " (" << reg.mCount << ")" << " type=" << reg.mRegisterType << " into reads of " << maxCount << " registers";
+
+        int first = reg.firstRegister();
+        while(first <= reg.lastRegister()) {
+            int last = std::min(first + maxCount - 1, reg.lastRegister());
+            // move the cut before a value that does not fit in this part
+            const ModbusSlaveAddressRange* value;
+            while((value = findValueRangeCut(reg.mSlaveId, reg.mRegisterType, last)) != nullptr) {
+                if (value->firstRegister() <= first) {
+                    throw ModMqttException(std::string("Registers ") + std::to_string(value->mSlaveId) + "."
+                        + std::to_string(value->mRegister) + " (" + std::to_string(value->mCount) + ") on network "
+                        + mNetworkName + " are converted to a single value and cannot be read with a single modbus command of "
+                        + std::to_string(maxCount) + " registers");
+                }
+                last = value->firstRegister() - 1;
+            }
+
+            MsgRegisterPoll part(reg);
+            part.mRegister = first;
+            part.mCount = last - first + 1;
+            result.push_back(part);
+            first = last + 1;
+        }
+    }
+    mRegisters = result;
+}
+
+
+const ModbusSlaveAddressRange*
+MsgRegisterPollSpecification::findValueRangeCut(int pSlaveId, RegisterType pType, int pRegister) const {
+    for(const auto& range: mValueRanges) {
+        if (range.mSlaveId == pSlaveId && range.mRegisterType == pType
+            && range.firstRegister() <= pRegister && range.lastRegister() > pRegister)
+        {
+            return &range;
+        }
+    }
+    return nullptr;
+}
+
+
+int
+MsgRegisterPollSpecification::coalesce() {
+    // poll groups are joined only if they are read at the same time
+    // and sent to MqttClient in the same way
+    typedef std::tuple<int, int, long, int> CoalesceKey;
+    std::map<CoalesceKey, std::deque<MsgRegisterPoll>> map;
+
+    std::vector<MsgRegisterPoll> result;
+    for(auto& reg: mRegisters) {
+        // modbus poll groups not merged with any mqtt register will be dropped
+        // by modbus thread, do not extend reads with them
+        if (reg.mRefreshMsec == MsgRegisterPoll::INVALID_REFRESH || getMaxGap(reg.mSlaveId) <= 0) {
+            result.push_back(reg);
+        } else {
+            map[CoalesceKey(reg.mSlaveId, reg.mRegisterType, reg.mRefreshMsec.count(), reg.mPublishMode)].push_back(reg);
+        }
+    }
+
+    int saved = 0;
+    for(auto& group: map) {
+        auto& regs = group.second;
+        sort(regs.begin(), regs.end(), registerNumberCompare);
+        int maxGap = getMaxGap(regs.front().mSlaveId);
+        int maxCount = getMaxReadCount(regs.front().mSlaveId, regs.front().mRegisterType);
+
+        std::vector<MsgRegisterPoll> joined(1, regs.front()); regs.pop_front();
+        while(!regs.empty()) {
+            MsgRegisterPoll& current = joined.back();
+            const MsgRegisterPoll& next = regs.front();
+            int gap = next.firstRegister() - current.lastRegister() - 1;
+            int count = next.lastRegister() - current.firstRegister() + 1;
+            if (gap <= maxGap && count <= maxCount) {
+                if (current.mDeliveryRanges.empty())
+                    current.mDeliveryRanges.push_back(current);
+                current.mDeliveryRanges.push_back(next);
+                current.ModbusAddressRange::merge(next);
+                saved++;
+            } else {
+                joined.push_back(next);
+            }
+            regs.pop_front();
+        }
+        result.insert(result.end(), joined.begin(), joined.end());
+    }
+
+    mRegisters = result;
+    return saved;
+}
+
 }
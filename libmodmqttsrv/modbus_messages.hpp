@@ -3,6 +3,7 @@
 #include <string>
 #include <map>
 #include <chrono>
+#include <tuple>
 #include <vector>
 
 #include "libmodmqttconv/modbusregisters.hpp"
@@ -37,6 +38,15 @@ class MsgRegisterValues : public ModbusSlaveAddressRange {
         int mCommandId = 0;
 };
 
+/**
+ * Register values read by modbus thread during a single
+ * executor round, sent to main thread as one queue item
+ * */
+class MsgRegisterValuesBatch {
+    public:
+        std::vector<MsgRegisterValues> mValues;
+};
+
 class MsgRegisterReadFailed : public ModbusSlaveAddressRange {
     public:
         MsgRegisterReadFailed(int slaveId, RegisterType regType, int registerNumber, int registerCount)
@@ -71,12 +81,21 @@ class MsgRegisterPoll : public ModbusSlaveAddressRange {
 
         std::chrono::milliseconds mRefreshMsec = INVALID_REFRESH;
         PublishMode mPublishMode = PublishMode::ON_CHANGE;
+
+        // register ranges that should be sent back as MsgRegisterValues
+        // if poll groups were coalesced to a single read.
+        // Empty if the whole range should be sent.
+        std::vector<ModbusAddressRange> mDeliveryRanges;
 };
 
 class MsgRegisterPollSpecification {
     public:
         static boost::log::sources::severity_logger<Log::severity> log;
 
+        // modbus protocol limits for a single read command
+        static constexpr int MAX_READ_REGISTERS = 125;
+        static constexpr int MAX_READ_BITS = 2000;
+
         MsgRegisterPollSpecification(const std::string& networkName) : mNetworkName(networkName) {}
 
         /*!
@@ -101,8 +120,63 @@ class MsgRegisterPollSpecification {
         */
         void merge(const MsgRegisterPoll& poll);
 
+        /*!
+            Join poll groups of the same slave, register type, refresh time
+            and publish mode that are separated by no more than max_gap
+            unused registers into a single modbus read.
+            Original ranges are stored in mDeliveryRanges.
+
+            Returns number of modbus reads saved in a single poll cycle.
+        */
+        int coalesce();
+
+        /*!
+            Split poll groups that cannot be read with a single modbus
+            command due to protocol limits or slave max_read_registers
+            setting. Parts are never cut inside a value range.
+            Throws ModMqttException if a value range cannot be read
+            with a single command.
+
+            Must be called before coalesce().
+        */
+        void split();
+
+        /*!
+            Mark registers converted to a single value, like
+            int32 or float32. split() keeps them in a single read
+            so the value is not built from registers read at
+            different time.
+        */
+        void addValueRange(const ModbusSlaveAddressRange& pRange) { mValueRanges.push_back(pRange); }
+
+        /*!
+            Set deadband for pCount registers starting at pRegister.
+            If register is declared many times with different deadbands,
+            then the smaller one is used. Zero deadband or deadbands of
+            different type disable filtering for a register.
+        */
+        void addDeadband(int pSlaveId, RegisterType pType, int pRegister, int pCount, const RegisterDeadband& pDeadband);
+        // nullptr if all register changes should be sent
+        const RegisterDeadband* findDeadband(int pSlaveId, RegisterType pType, int pRegister) const;
+
+        int getMaxGap(int pSlaveId) const;
+        int getMaxReadCount(int pSlaveId, RegisterType pType) const;
+
         std::string mNetworkName;
         std::vector<MsgRegisterPoll> mRegisters;
+
+        int mMaxGap = 0;
+        // slave id -> max_gap overriding network setting
+        std::map<int, int> mSlaveMaxGap;
+        // slave id -> max_read_registers
+        std::map<int, int> mSlaveMaxReadRegisters;
+        // registers converted to a single value
+        std::vector<ModbusSlaveAddressRange> mValueRanges;
+        // (slave id, register type, register) -> deadband
+        std::map<std::tuple<int, int, int>, RegisterDeadband> mDeadbands;
+    private:
+        // value range that contains pRegister and ends after it
+        const ModbusSlaveAddressRange* findValueRangeCut(int pSlaveId, RegisterType pType, int pRegister) const;
 };
 
 class MsgModbusNetworkState {
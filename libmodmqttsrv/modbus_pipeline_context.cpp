@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "modbus_pipeline_context.hpp"
+#include "modbus_context.hpp"
+#include "register_poll.hpp"
+
+namespace modmqttd {
+
+boost::log::sources::severity_logger<Log::severity> ModbusPipelineContext::log;
+
+// MBAP header size including unit identifier
+static const std::size_t MBAP_HEADER_SIZE = 7;
+
+static uint8_t
+getReadFunction(RegisterType pType) {
+    switch(pType) {
+        case RegisterType::COIL: return 0x01;
+        case RegisterType::BIT: return 0x02;
+        case RegisterType::HOLDING: return 0x03;
+        case RegisterType::INPUT: return 0x04;
+        default:
+            throw ModbusContextException(std::string("Cannot read, unknown register type ") + std::to_string(pType));
+    }
+}
+
+static void
+appendUint16(std::vector<uint8_t>& pData, uint16_t pValue) {
+    pData.push_back(pValue >> 8);
+    pData.push_back(pValue & 0xFF);
+}
+
+void
+ModbusPipelineContext::init(const ModbusNetworkConfig& config) {
+    mAddress = config.mAddress;
+    mPort = config.mPort;
+    mPipelineDepth = config.mPipelineDepth;
+    mResponseTimeout = config.mResponseTimeout;
+    BOOST_LOG_SEV(log, Log::info) << "Connecting to " << mAddress << ":" << mPort
+        << ", up to " << mPipelineDepth << " pipelined requests";
+    BOOST_LOG_SEV(log, Log::info) << "Response timeout set to " << mResponseTimeout.count() << "ms";
+}
+
+void
+ModbusPipelineContext::connect() {
+    disconnect();
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* addresses = nullptr;
+    int rc = getaddrinfo(mAddress.c_str(), std::to_string(mPort).c_str(), &hints, &addresses);
+    if (rc != 0) {
+        BOOST_LOG_SEV(log, Log::error) << "modbus: cannot resolve " << mAddress << ": " << gai_strerror(rc);
+        return;
+    }
+
+    int err = 0;
+    for(struct addrinfo* ai = addresses; ai != nullptr && mSocket == -1; ai = ai->ai_next) {
+        int s = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (s == -1) {
+            err = errno;
+            continue;
+        }
+
+        if (::connect(s, ai->ai_addr, ai->ai_addrlen) == -1 && errno == EINPROGRESS) {
+            struct pollfd pfd = { s, POLLOUT, 0 };
+            if (poll(&pfd, 1, mResponseTimeout.count()) == 1) {
+                socklen_t len = sizeof(err);
+                getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len);
+            } else {
+                err = ETIMEDOUT;
+            }
+        } else {
+            err = errno;
+        }
+
+        if (err == 0) {
+            int flag = 1;
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+            mSocket = s;
+        } else {
+            close(s);
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (mSocket == -1) {
+        BOOST_LOG_SEV(log, Log::error) << "modbus: connection to " << mAddress << " failed(" << err << ") : " << strerror(err);
+    }
+    mReadBuffer.clear();
+}
+
+void
+ModbusPipelineContext::disconnect() {
+    if (mSocket != -1) {
+        close(mSocket);
+        mSocket = -1;
+    }
+}
+
+uint16_t
+ModbusPipelineContext::sendRequest(int slaveId, const std::vector<uint8_t>& pdu) {
+    uint16_t transactionId = ++mTransactionId;
+
+    std::vector<uint8_t> frame;
+    frame.reserve(MBAP_HEADER_SIZE + pdu.size());
+    appendUint16(frame, transactionId);
+    appendUint16(frame, 0);
+    appendUint16(frame, pdu.size() + 1);
+    frame.push_back(slaveId == -1 ? MODBUS_TCP_SLAVE : slaveId);
+    frame.insert(frame.end(), pdu.begin(), pdu.end());
+
+    std::size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t rc = send(mSocket, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (rc == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return 0;
+            struct pollfd pfd = { mSocket, POLLOUT, 0 };
+            if (poll(&pfd, 1, mResponseTimeout.count()) != 1) {
+                errno = ETIMEDOUT;
+                return 0;
+            }
+        } else {
+            sent += rc;
+        }
+    }
+
+    // transaction id 0 is used to signal send error
+    if (mTransactionId == 0xFFFF)
+        mTransactionId = 0;
+
+    return transactionId;
+}
+
+int
+ModbusPipelineContext::parseResponse(uint16_t& transactionId, Response& response) {
+    if (mReadBuffer.size() < MBAP_HEADER_SIZE)
+        return 0;
+
+    uint16_t length = (mReadBuffer[4] << 8) | mReadBuffer[5];
+    // unit identifier, function code and at least one data byte
+    if (mReadBuffer[2] != 0 || mReadBuffer[3] != 0 || length < 3 || length > MODBUS_MAX_PDU_LENGTH + 1)
+        return -1;
+
+    std::size_t frameSize = MBAP_HEADER_SIZE - 1 + length;
+    if (mReadBuffer.size() < frameSize)
+        return 0;
+
+    transactionId = (mReadBuffer[0] << 8) | mReadBuffer[1];
+    response.mFunction = mReadBuffer[MBAP_HEADER_SIZE];
+    response.mData.assign(mReadBuffer.begin() + MBAP_HEADER_SIZE + 1, mReadBuffer.begin() + frameSize);
+    mReadBuffer.erase(mReadBuffer.begin(), mReadBuffer.begin() + frameSize);
+    return 1;
+}
+
+int
+ModbusPipelineContext::receiveResponses(const std::vector<uint16_t>& pTransactions, std::map<uint16_t, Response>& pResponses) {
+    std::size_t waiting = pTransactions.size();
+    // response timeout is counted from the last received response
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + mResponseTimeout;
+    uint8_t buffer[MODBUS_TCP_MAX_ADU_LENGTH];
+
+    while (waiting != 0) {
+        uint16_t transactionId;
+        Response response;
+        int rc = parseResponse(transactionId, response);
+        if (rc == -1) {
+            BOOST_LOG_SEV(log, Log::error) << "modbus: invalid MBAP header received from " << mAddress << ", reconnecting";
+            disconnect();
+            return EMBBADDATA;
+        }
+        if (rc == 1) {
+            if (std::find(pTransactions.begin(), pTransactions.end(), transactionId) != pTransactions.end()
+                && pResponses.find(transactionId) == pResponses.end())
+            {
+                pResponses[transactionId] = response;
+                waiting--;
+                deadline = std::chrono::steady_clock::now() + mResponseTimeout;
+            } else {
+                BOOST_LOG_SEV(log, Log::debug) << "modbus: dropping late response for transaction " << transactionId;
+            }
+            continue;
+        }
+
+        auto timeLeft = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (timeLeft.count() <= 0)
+            return ETIMEDOUT;
+
+        struct pollfd pfd = { mSocket, POLLIN, 0 };
+        int prc = poll(&pfd, 1, timeLeft.count());
+        if (prc == 0)
+            return ETIMEDOUT;
+        if (prc == -1) {
+            if (errno == EINTR)
+                continue;
+            int err = errno;
+            disconnect();
+            return err;
+        }
+
+        ssize_t len = recv(mSocket, buffer, sizeof(buffer), 0);
+        if (len == 0) {
+            disconnect();
+            return ECONNRESET;
+        }
+        if (len == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                continue;
+            int err = errno;
+            disconnect();
+            return err;
+        }
+        mReadBuffer.insert(mReadBuffer.end(), buffer, buffer + len);
+    }
+    return 0;
+}
+
+std::vector<ModbusReadResult>
+ModbusPipelineContext::readRegisters(int slaveId, const std::vector<const RegisterPoll*>& pRegisters) {
+    std::vector<ModbusReadResult> ret(pRegisters.size());
+    std::vector<uint16_t> transactions;
+    int error = 0;
+
+    // stale responses from timed out requests are dropped by transaction id
+    for(const RegisterPoll* reg: pRegisters) {
+        if (!isConnected()) {
+            error = ENOTCONN;
+            break;
+        }
+        std::vector<uint8_t> pdu;
+        pdu.push_back(getReadFunction(reg->mRegisterType));
+        appendUint16(pdu, reg->mRegister);
+        appendUint16(pdu, reg->getCount());
+
+        uint16_t transactionId = sendRequest(slaveId, pdu);
+        if (transactionId == 0) {
+            error = errno;
+            disconnect();
+            break;
+        }
+        transactions.push_back(transactionId);
+    }
+
+    std::map<uint16_t, Response> responses;
+    if (!transactions.empty()) {
+        int rc = receiveResponses(transactions, responses);
+        if (error == 0)
+            error = rc;
+    }
+
+    for(std::size_t i = 0; i < pRegisters.size(); i++) {
+        const RegisterPoll& reg(*pRegisters[i]);
+        std::string desc(std::string("read fn ") + std::to_string(reg.mRegister) + " failed");
+
+        std::map<uint16_t, Response>::const_iterator it = responses.end();
+        if (i < transactions.size())
+            it = responses.find(transactions[i]);
+
+        if (it == responses.end()) {
+            errno = error;
+            ret[i].mError = std::make_exception_ptr(ModbusReadException(desc));
+            continue;
+        }
+
+        const Response& response(it->second);
+        uint8_t function = getReadFunction(reg.mRegisterType);
+        if (response.mFunction == (function | 0x80)) {
+            errno = MODBUS_ENOBASE + response.mData[0];
+            ret[i].mError = std::make_exception_ptr(ModbusReadException(desc));
+            continue;
+        }
+
+        bool bits = reg.mRegisterType == RegisterType::COIL || reg.mRegisterType == RegisterType::BIT;
+        std::size_t byteCount = bits ? (reg.getCount() + 7) / 8 : reg.getCount() * 2;
+        if (response.mFunction != function || response.mData[0] != byteCount || response.mData.size() != byteCount + 1) {
+            errno = EMBBADDATA;
+            ret[i].mError = std::make_exception_ptr(ModbusReadException(desc));
+            continue;
+        }
+
+        ret[i].mValues.resize(reg.getCount());
+        for(int r = 0; r < reg.getCount(); r++) {
+            if (bits)
+                ret[i].mValues[r] = (response.mData[1 + r / 8] >> (r % 8)) & 0x01;
+            else
+                ret[i].mValues[r] = (response.mData[1 + r * 2] << 8) | response.mData[2 + r * 2];
+        }
+    }
+
+    return ret;
+}
+
+std::vector<ModbusReadResult>
+ModbusPipelineContext::readModbusRegisterList(int slaveId, const std::vector<std::shared_ptr<RegisterPoll>>& pRegisters) {
+    std::vector<const RegisterPoll*> regs;
+    for(const std::shared_ptr<RegisterPoll>& reg: pRegisters)
+        regs.push_back(reg.get());
+    return readRegisters(slaveId, regs);
+}
+
+std::vector<uint16_t>
+ModbusPipelineContext::readModbusRegisters(int slaveId, const RegisterPoll& regData) {
+    std::vector<ModbusReadResult> result(readRegisters(slaveId, std::vector<const RegisterPoll*>(1, &regData)));
+    if (result[0].mError)
+        std::rethrow_exception(result[0].mError);
+    return result[0].mValues;
+}
+
+void
+ModbusPipelineContext::writeModbusRegisters(int slaveId, const RegisterWrite& msg) {
+    std::vector<uint8_t> pdu;
+    int count = msg.mValues.getCount();
+    switch(msg.mRegisterType) {
+        case RegisterType::COIL:
+            if (count == 1) {
+                pdu.push_back(0x05);
+                appendUint16(pdu, msg.mRegister);
+                appendUint16(pdu, msg.mValues.getValue(0) == 1 ? 0xFF00 : 0x0000);
+            } else {
+                pdu.push_back(0x0F);
+                appendUint16(pdu, msg.mRegister);
+                appendUint16(pdu, count);
+                pdu.push_back((count + 7) / 8);
+                pdu.resize(pdu.size() + (count + 7) / 8, 0);
+                for(int i = 0; i < count; i++) {
+                    if (msg.mValues.getValue(i) == 1)
+                        pdu[6 + i / 8] |= 1 << (i % 8);
+                }
+            }
+        break;
+        case RegisterType::HOLDING:
+            if (count == 1) {
+                pdu.push_back(0x06);
+                appendUint16(pdu, msg.mRegister);
+                appendUint16(pdu, msg.mValues.getValue(0));
+            } else {
+                pdu.push_back(0x10);
+                appendUint16(pdu, msg.mRegister);
+                appendUint16(pdu, count);
+                pdu.push_back(count * 2);
+                for(int i = 0; i < count; i++)
+                    appendUint16(pdu, msg.mValues.getValue(i));
+            }
+        break;
+        default:
+            throw ModbusContextException(std::string("Cannot write, unknown register type ") + std::to_string(msg.mRegisterType));
+    }
+
+    std::string desc(std::string("write fn ") + std::to_string(msg.mRegister) + " failed");
+    if (!isConnected()) {
+        errno = ENOTCONN;
+        throw ModbusWriteException(desc);
+    }
+
+    uint16_t transactionId = sendRequest(slaveId, pdu);
+    if (transactionId == 0) {
+        int err = errno;
+        disconnect();
+        errno = err;
+        throw ModbusWriteException(desc);
+    }
+
+    std::map<uint16_t, Response> responses;
+    int rc = receiveResponses(std::vector<uint16_t>(1, transactionId), responses);
+    if (rc != 0) {
+        errno = rc;
+        throw ModbusWriteException(desc);
+    }
+
+    const Response& response(responses[transactionId]);
+    if (response.mFunction == (pdu[0] | 0x80)) {
+        errno = MODBUS_ENOBASE + response.mData[0];
+        throw ModbusWriteException(desc);
+    }
+    if (response.mFunction != pdu[0]) {
+        errno = EMBBADDATA;
+        throw ModbusWriteException(desc);
+    }
+}
+
+} //namespace
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <map>
+
+#include "logging.hpp"
+#include "imodbuscontext.hpp"
+
+namespace modmqttd {
+
+/**
+ * Modbus TCP implementation that sends multiple read
+ * requests without waiting for responses. Responses are
+ * matched with requests by MBAP transaction identifier.
+ *
+ * Used for TCP networks with pipeline_depth > 1
+ * */
+class ModbusPipelineContext : public IModbusContext {
+    public:
+        virtual void init(const ModbusNetworkConfig& config);
+        virtual void connect();
+        virtual bool isConnected() const { return mSocket != -1; }
+        virtual void disconnect();
+        virtual std::vector<uint16_t> readModbusRegisters(int slaveId, const RegisterPoll& regData);
+        virtual void writeModbusRegisters(int slaveId, const RegisterWrite& msg);
+        virtual std::vector<ModbusReadResult> readModbusRegisterList(int slaveId, const std::vector<std::shared_ptr<RegisterPoll>>& pRegisters);
+        virtual int getMaxPipelinedRequests() const { return mPipelineDepth; }
+        virtual ModbusNetworkConfig::Type getNetworkType() const { return ModbusNetworkConfig::TCPIP; }
+        virtual ~ModbusPipelineContext() { disconnect(); }
+    private:
+        // PDU part of modbus response
+        struct Response {
+            uint8_t mFunction = 0;
+            std::vector<uint8_t> mData;
+        };
+
+        static boost::log::sources::severity_logger<Log::severity> log;
+
+        std::string mAddress;
+        int mPort = 0;
+        int mPipelineDepth = 1;
+        std::chrono::milliseconds mResponseTimeout;
+        int mSocket = -1;
+        uint16_t mTransactionId = 0;
+        std::vector<uint8_t> mReadBuffer;
+
+        uint16_t sendRequest(int slaveId, const std::vector<uint8_t>& pdu);
+        // waits for responses to pTransactions, responses for other
+        // transaction ids are dropped. Missing responses are not added to pResponses.
+        // Returns 0 or errno value of the first error
+        int receiveResponses(const std::vector<uint16_t>& pTransactions, std::map<uint16_t, Response>& pResponses);
+        // Returns 1 if response was taken from mReadBuffer, 0 if more data is needed
+        // and -1 if MBAP header is invalid
+        int parseResponse(uint16_t& transactionId, Response& response);
+        std::vector<ModbusReadResult> readRegisters(int slaveId, const std::vector<const RegisterPoll*>& pRegisters);
+};
+
+}
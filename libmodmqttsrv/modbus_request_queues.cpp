@@ -103,11 +103,41 @@ check_cache:
     return ret;
 }
 
-void
-ModbusRequestsQueues::addWriteCommand(const std::shared_ptr<RegisterWrite>& pReq) {
+bool
+ModbusRequestsQueues::addWriteCommand(const std::shared_ptr<RegisterWrite>& pReq, bool pCoalesce) {
+    // merging with older write would execute pReq
+    // before writes queued after it
+    if (pCoalesce && !mWriteQueue.empty() && mWriteQueue.back()->merge(*pReq))
+        return false;
     mWriteQueue.push_back(pReq);
+    return true;
+}
+
+bool
+ModbusRequestsQueues::replaceWriteCommand(const std::shared_ptr<RegisterWrite>& pReq) {
+    for(auto it = mWriteQueue.rbegin(); it != mWriteQueue.rend(); it++) {
+        if ((*it)->overlaps(*pReq)) {
+            if (!(*it)->isSameAs(*pReq))
+                return false;
+            // MQTT commands of replaced write still need
+            // the state published after pReq is written
+            pReq->mReturnMessages.insert(pReq->mReturnMessages.begin(), (*it)->mReturnMessages.begin(), (*it)->mReturnMessages.end());
+            *it = pReq;
+            return true;
+        }
+    }
+    return false;
 }
 
+std::shared_ptr<RegisterWrite>
+ModbusRequestsQueues::dropOldestWrite() {
+    std::shared_ptr<RegisterWrite> ret;
+    if (!mWriteQueue.empty()) {
+        ret = mWriteQueue.front();
+        mWriteQueue.pop_front();
+    }
+    return ret;
+}
 
 void
 ModbusRequestsQueues::readdCommand(const std::shared_ptr<RegisterCommand>& pCmd) {
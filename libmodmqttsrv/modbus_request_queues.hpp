@@ -15,7 +15,20 @@ class ModbusRequestsQueues {
         // shared_ptr because RegisterWrite will be long-lived object
         // just like RegisterPoll. ModbusThread will maintain a list of writeRequests just like PollSpecification
         // to count and log write errors in 5min timeframes
-        void addWriteCommand(const std::shared_ptr<RegisterWrite>& pReq);
+        // If pCoalesce is set then pReq is merged into the last queued write
+        // if it has the same or consecutive register range. Older writes
+        // are never merged so the order of writes is kept.
+        // Returns false if pReq was merged and not added to queue.
+        bool addWriteCommand(const std::shared_ptr<RegisterWrite>& pReq, bool pCoalesce = false);
+
+        // replace queued write to the same register range with pReq
+        // if it is not followed by other write to any of those registers.
+        // Return messages of the replaced write are moved to pReq.
+        // Returns false if there is no such write in queue.
+        bool replaceWriteCommand(const std::shared_ptr<RegisterWrite>& pReq);
+
+        // remove the oldest write from queue, returns nullptr if queue is empty
+        std::shared_ptr<RegisterWrite> dropOldestWrite();
 
         void readdCommand(const std::shared_ptr<RegisterCommand>& pCmd);
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "modbus_scheduler.hpp"
 #include "modbus_types.hpp"
 
@@ -5,43 +7,107 @@ namespace modmqttd {
 
 boost::log::sources::severity_logger<Log::severity> ModbusScheduler::log;
 
+void
+ModbusScheduler::setPollSpecification(const std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>& pRegisterMap) {
+    mRegisterMap = pRegisterMap;
+    mSchedule.clear();
+    for(std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>::const_iterator slave = mRegisterMap.begin();
+        slave != mRegisterMap.end(); slave++)
+    {
+        for(std::size_t i = 0; i < slave->second.size(); i++) {
+            const std::shared_ptr<RegisterPoll>& reg = slave->second[i];
+            mSchedule.push_back(ScheduleEntry{reg->mLastRead + reg->mRefresh, i, slave->first, reg});
+        }
+    }
+    std::make_heap(mSchedule.begin(), mSchedule.end());
+}
+
+bool
+ModbusScheduler::replaceRegisterPoll(const std::shared_ptr<RegisterPoll>& pOld, const std::vector<std::shared_ptr<RegisterPoll>>& pParts) {
+    std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>::iterator slave = mRegisterMap.find(pOld->mSlaveId);
+    if (slave == mRegisterMap.end())
+        return false;
+
+    std::vector<std::shared_ptr<RegisterPoll>>::iterator reg_it = std::find(slave->second.begin(), slave->second.end(), pOld);
+    if (reg_it == slave->second.end())
+        return false;
+
+    std::size_t index = reg_it - slave->second.begin();
+    reg_it = slave->second.erase(reg_it);
+    slave->second.insert(reg_it, pParts.begin(), pParts.end());
+
+    // keep poll times of other registers, they could be
+    // already returned by getRegistersToPoll and not polled yet
+    mSchedule.erase(
+        std::remove_if(mSchedule.begin(), mSchedule.end(),
+            [&pOld](const ScheduleEntry& entry) -> bool { return entry.mRegister == pOld; }),
+        mSchedule.end()
+    );
+    for(std::vector<ScheduleEntry>::iterator it = mSchedule.begin(); it != mSchedule.end(); it++) {
+        if (it->mSlaveId == pOld->mSlaveId && it->mIndex > index)
+            it->mIndex += pParts.size() - 1;
+    }
+    for(std::size_t i = 0; i < pParts.size(); i++) {
+        const std::shared_ptr<RegisterPoll>& reg = pParts[i];
+        mSchedule.push_back(ScheduleEntry{reg->mLastRead + reg->mRefresh, index + i, pOld->mSlaveId, reg});
+    }
+    std::make_heap(mSchedule.begin(), mSchedule.end());
+    return true;
+}
+
 std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>
 ModbusScheduler::getRegistersToPoll(
     std::chrono::steady_clock::duration& outDuration,
     const std::chrono::time_point<std::chrono::steady_clock>& timePoint
 ) {
     std::map<int, std::vector<std::shared_ptr<RegisterPoll>>> ret;
+    std::vector<ScheduleEntry> due;
 
-    //BOOST_LOG_SEV(log, Log::trace) << "initial outduration " << std::chrono::duration_cast<std::chrono::milliseconds>(outDuration).count();
+    // mNextPoll in heap is a lower bound of the real poll time:
+    // mLastRead is updated by ModbusExecutor after the register was read,
+    // so the top entry is checked against current mLastRead and moved back
+    // to its real position if it was polled in the meantime.
+    while (!mSchedule.empty()) {
+        ScheduleEntry& entry = mSchedule.front();
+        const RegisterPoll& reg = *entry.mRegister;
 
-    outDuration = std::chrono::steady_clock::duration::max();
-    for(std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>::const_iterator slave = mRegisterMap.begin();
-        slave != mRegisterMap.end(); slave++)
-    {
-        for(std::vector<std::shared_ptr<RegisterPoll>>::const_iterator reg_it = slave->second.begin();
-            reg_it != slave->second.end(); reg_it++)
-        {
-            const RegisterPoll& reg = **reg_it;
-
-            auto time_passed = timePoint - reg.mLastRead;
-            auto time_to_poll = reg.mRefresh;
-
-            //BOOST_LOG_SEV(log, Log::trace) << "time passed: " << std::chrono::duration_cast<std::chrono::milliseconds>(time_to_poll).count();
-
-            if (time_passed >= reg.mRefresh) {
-                BOOST_LOG_SEV(log, Log::trace) << "Register " << slave->first << "." << reg.mRegister << " (0x" << std::hex << slave->first << ".0x" << std::hex << reg.mRegister << ")"
-                                << " added, last read " << std::dec << std::chrono::duration_cast<std::chrono::milliseconds>(time_passed).count() << "ms ago";
-                ret[slave->first].push_back(*reg_it);
-            } else {
-                time_to_poll = reg.mRefresh - time_passed;
-            }
-
-            if (outDuration > time_to_poll) {
-                outDuration = time_to_poll;
-                BOOST_LOG_SEV(log, Log::trace) << "Wait duration set to " << std::chrono::duration_cast<std::chrono::milliseconds>(time_to_poll).count()
-                                << "ms as next poll for register " << slave->first << "." << reg.mRegister << " (0x" << std::hex << slave->first << ".0x" << std::hex << reg.mRegister << ")";
-            }
+        auto nextPoll = reg.mLastRead + reg.mRefresh;
+        if (nextPoll > entry.mNextPoll) {
+            std::pop_heap(mSchedule.begin(), mSchedule.end());
+            mSchedule.back().mNextPoll = nextPoll;
+            std::push_heap(mSchedule.begin(), mSchedule.end());
+            continue;
         }
+
+        if (entry.mNextPoll > timePoint)
+            break;
+
+        BOOST_LOG_SEV(log, Log::trace) << "Register " << entry.mSlaveId << "." << reg.mRegister << " (0x" << std::hex << entry.mSlaveId << ".0x" << std::hex << reg.mRegister << ")"
+                        << " added, last read " << std::dec << std::chrono::duration_cast<std::chrono::milliseconds>(timePoint - reg.mLastRead).count() << "ms ago";
+        std::pop_heap(mSchedule.begin(), mSchedule.end());
+        due.push_back(mSchedule.back());
+        mSchedule.pop_back();
+    }
+
+    // due registers are expected to be polled now, if executor
+    // will not do it, they will be returned again after mRefresh
+    std::sort(due.begin(), due.end(), [](const ScheduleEntry& a, const ScheduleEntry& b) -> bool {
+        return a.mSlaveId == b.mSlaveId ? a.mIndex < b.mIndex : a.mSlaveId < b.mSlaveId;
+    });
+    for(std::vector<ScheduleEntry>::iterator it = due.begin(); it != due.end(); it++) {
+        ret[it->mSlaveId].push_back(it->mRegister);
+        it->mNextPoll = timePoint + it->mRegister->mRefresh;
+        mSchedule.push_back(*it);
+        std::push_heap(mSchedule.begin(), mSchedule.end());
+    }
+
+    if (mSchedule.empty()) {
+        outDuration = std::chrono::steady_clock::duration::max();
+    } else {
+        const ScheduleEntry& next = mSchedule.front();
+        outDuration = next.mNextPoll - timePoint;
+        BOOST_LOG_SEV(log, Log::trace) << "Wait duration set to " << std::chrono::duration_cast<std::chrono::milliseconds>(outDuration).count()
+                        << "ms as next poll for register " << next.mSlaveId << "." << next.mRegister->mRegister << " (0x" << std::hex << next.mSlaveId << ".0x" << std::hex << next.mRegister->mRegister << ")";
     }
 
     return ret;
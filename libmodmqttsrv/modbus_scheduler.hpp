@@ -13,14 +13,17 @@ namespace modmqttd {
 
     class ModbusScheduler {
         public:
-            void setPollSpecification(const std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>& pRegisterMap) {
-                mRegisterMap = pRegisterMap;
-            }
+            void setPollSpecification(const std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>& pRegisterMap);
             const std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>& getPollSpecification() const {
                 return mRegisterMap;
             }
 
             std::shared_ptr<RegisterPoll> findRegisterPoll(const MsgRegisterValues& pValues) const;
+            /**
+             * Replaces pOld register in poll specification with pParts.
+             * Returns false if pOld is not in poll specification.
+             * */
+            bool replaceRegisterPoll(const std::shared_ptr<RegisterPoll>& pOld, const std::vector<std::shared_ptr<RegisterPoll>>& pParts);
             /**
              * Returns map of devices with list of registers, that
              * should be polled now.
@@ -28,14 +31,29 @@ namespace modmqttd {
              * sets outDuration to time period that should be waited
              * for next poll to be done.
              *
+             * Registers are kept in a min-heap ordered by the next poll time,
+             * so only due registers are visited.
              * */
             std::map<int, std::vector<std::shared_ptr<RegisterPoll>>> getRegistersToPoll(
                 std::chrono::steady_clock::duration& outDuration,
                 const std::chrono::time_point<std::chrono::steady_clock>& timePoint
             );
         private:
+            struct ScheduleEntry {
+                std::chrono::steady_clock::time_point mNextPoll;
+                // position in mRegisterMap slave list, used to keep
+                // returned registers in configuration order
+                std::size_t mIndex;
+                int mSlaveId;
+                std::shared_ptr<RegisterPoll> mRegister;
+
+                // std heap functions build max-heap, reverse order to get
+                // the earliest poll time on top
+                bool operator<(const ScheduleEntry& other) const { return mNextPoll > other.mNextPoll; }
+            };
+
             std::map<int, std::vector<std::shared_ptr<RegisterPoll>>> mRegisterMap;
+            std::vector<ScheduleEntry> mSchedule;
             static  boost::log::sources::severity_logger<Log::severity> log;
     };
 }
-
@@ -33,6 +33,14 @@ ModbusSlaveConfig::ModbusSlaveConfig(int pAddress, const YAML::Node& data)
 
     ConfigTools::readOptionalValue<unsigned short>(mMaxWriteRetryCount, data, "write_retries");
     ConfigTools::readOptionalValue<unsigned short>(mMaxReadRetryCount, data, "read_retries");
+
+    YAML::Node gapNode(ConfigTools::setOptionalValueFromNode<int>(mMaxGap, data, "max_gap"));
+    if (gapNode.IsDefined() && mMaxGap < 0)
+        throw ConfigurationException(gapNode.Mark(), "max_gap must be greater or equal to 0");
+
+    YAML::Node readNode(ConfigTools::setOptionalValueFromNode<int>(mMaxReadRegisters, data, "max_read_registers"));
+    if (readNode.IsDefined() && mMaxReadRegisters <= 0)
+        throw ConfigurationException(readNode.Mark(), "max_read_registers must be greater than 0");
 }
 
 }
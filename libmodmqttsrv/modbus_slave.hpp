@@ -28,6 +28,10 @@ class ModbusSlaveConfig {
 
         unsigned short mMaxWriteRetryCount = 0;
         unsigned short mMaxReadRetryCount = 0;
+        // -1 if not set, network max_gap is used
+        int mMaxGap = -1;
+        // 0 if not set, modbus protocol limit is used
+        int mMaxReadRegisters = 0;
     private:
         std::shared_ptr<std::chrono::milliseconds> mDelayBeforeCommand;
         std::shared_ptr<std::chrono::milliseconds> mDelayBeforeFirstCommand;
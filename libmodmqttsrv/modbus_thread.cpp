@@ -8,6 +8,10 @@
 
 namespace modmqttd {
 
+#if __cplusplus < 201703L
+constexpr std::chrono::milliseconds ModbusThread::MAX_VALUES_BATCH_DELAY;
+#endif
+
 void
 setCommandDelays(RegisterCommand& cmd, const std::shared_ptr<const std::chrono::milliseconds>& everyTime, const std::shared_ptr<const std::chrono::milliseconds>& onChange) {
     if (everyTime != nullptr)
@@ -17,26 +21,53 @@ setCommandDelays(RegisterCommand& cmd, const std::shared_ptr<const std::chrono::
 }
 
 void
-ModbusThread::sendMessageFromModbus(moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue, const QueueItem& item) {
+setDeadbands(RegisterPoll& pReg, const MsgRegisterPollSpecification& pSpec) {
+    bool found = false;
+    std::vector<RegisterDeadband> deadbands(pReg.getCount());
+    for(int i = 0; i < pReg.getCount(); i++) {
+        const RegisterDeadband* deadband = pSpec.findDeadband(pReg.mSlaveId, pReg.mRegisterType, pReg.mRegister + i);
+        if (deadband != nullptr) {
+            deadbands[i] = *deadband;
+            found = true;
+        }
+    }
+    if (found)
+        pReg.mDeadbands = deadbands;
+}
+
+void
+ModbusThread::sendMessageFromModbus(
+    moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue,
+    QueueSignal* fromModbusSignal,
+    const QueueItem& item)
+{
     fromModbusQueue.enqueue(item);
-    modmqttd::notifyQueues();
+    if (fromModbusSignal != nullptr)
+        fromModbusSignal->notify();
 }
 
 ModbusThread::ModbusThread(
     moodycamel::BlockingReaderWriterQueue<QueueItem>& toModbusQueue,
-    moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue)
+    moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue,
+    QueueSignal& fromModbusSignal)
     : mToModbusQueue(toModbusQueue),
       mFromModbusQueue(fromModbusQueue),
+      mFromModbusSignal(fromModbusSignal),
       mExecutor(fromModbusQueue, toModbusQueue)
 {
+    mExecutor.setFromModbusSignal(fromModbusSignal);
 }
 
 void
 ModbusThread::configure(const ModbusNetworkConfig& config) {
     mNetworkName = config.mName;
-    mModbus = ModMqtt::getModbusFactory().getContext(config.mName);
+    mModbus = ModMqtt::getModbusFactory().getNetworkContext(config);
     mModbus->init(config);
     mExecutor.init(mModbus);
+    mExecutor.setCoalesceWrites(config.mCoalesceWrites);
+    mExecutor.setMaxBatchDelay(MAX_VALUES_BATCH_DELAY);
+    mExecutor.setMaxQueuedWrites(config.mMaxQueuedWrites, config.mWriteOverflowPolicy);
+    mExecutor.setMaxQueuedUpdates(config.mMaxQueuedUpdates);
     mWatchdog.init(config.mWatchdogConfig);
 
     if (config.hasDelayBeforeCommand())
@@ -56,6 +87,9 @@ ModbusThread::configure(const ModbusNetworkConfig& config) {
 
     mMaxReadRetryCount = config.mMaxReadRetryCount;
     mMaxWriteRetryCount = config.mMaxWriteRetryCount;
+
+    if (!config.mRegisterLayoutFile.empty())
+        mLayout.load(config.mRegisterLayoutFile);
 }
 
 void
@@ -68,6 +102,8 @@ ModbusThread::setPollSpecification(const MsgRegisterPollSpecification& spec) {
         // that was not merged with any mqtt register declaration
         if (it->mRefreshMsec != MsgRegisterPoll::INVALID_REFRESH) {
             std::shared_ptr<RegisterPoll> reg(new RegisterPoll(it->mSlaveId, it->mRegister, it->mRegisterType, it->mCount, it->mRefreshMsec, it->mPublishMode));
+            reg->mDeliveryRanges = it->mDeliveryRanges;
+            setDeadbands(*reg, spec);
             std::map<int, ModbusSlaveConfig>::const_iterator slave_cfg = mSlaves.find(reg->mSlaveId);
 
             setCommandDelays(*reg, mDelayBeforeCommand, mDelayBeforeFirstCommand);
@@ -82,6 +118,11 @@ ModbusThread::setPollSpecification(const MsgRegisterPollSpecification& spec) {
         }
     }
 
+    int learned = mLayout.apply(registerMap);
+    if (learned != 0) {
+        BOOST_LOG_SEV(log, Log::info) << mNetworkName << ": using learned layout for " << learned << " poll group(s) from " << mLayout.getPath();
+    }
+
     mScheduler.setPollSpecification(registerMap);
     BOOST_LOG_SEV(log, Log::debug) << "Poll specification set, got " << registerMap.size() << " slaves," << spec.mRegisters.size() << " registers to poll:";
     for (auto sit = registerMap.begin(); sit != registerMap.end(); sit++) {
@@ -108,7 +149,7 @@ ModbusThread::processWrite(const std::shared_ptr<MsgRegisterValues>& msg) {
 
     //TODO cache this setup
 
-    cmd->mReturnMessage = msg;
+    cmd->mReturnMessages.push_back(msg);
 
     setCommandDelays(*cmd, mDelayBeforeCommand, mDelayBeforeFirstCommand);
     cmd->setMaxRetryCounts(mMaxReadRetryCount, mMaxWriteRetryCount, true);
@@ -151,7 +192,8 @@ ModbusThread::dispatchMessages(const QueueItem& read) {
 
 void
 ModbusThread::sendMessage(const QueueItem& item) {
-    sendMessageFromModbus(mFromModbusQueue, item);
+    mExecutor.flushRegisterValues();
+    sendMessageFromModbus(mFromModbusQueue, &mFromModbusSignal, item);
 }
 
 void
@@ -172,6 +214,30 @@ ModbusThread::updateFromSlaveConfig(const ModbusSlaveConfig& pConfig) {
 }
 
 
+void
+ModbusThread::splitRegisters() {
+    std::vector<std::shared_ptr<RegisterPoll>> registers(mExecutor.takeRegistersToSplit());
+    bool changed = false;
+    for(const std::shared_ptr<RegisterPoll>& reg: registers) {
+        std::vector<std::shared_ptr<RegisterPoll>> parts(reg->bisect());
+        // poll specification could be replaced in the meantime
+        if (parts.empty() || !mScheduler.replaceRegisterPoll(reg, parts))
+            continue;
+
+        BOOST_LOG_SEV(log, Log::info) << mNetworkName << ": register " << reg->mSlaveId << "." << reg->mRegister
+            << " (" << reg->getCount() << ") split into "
+            << parts[0]->mRegister << " (" << parts[0]->getCount() << ") and "
+            << parts[1]->mRegister << " (" << parts[1]->getCount() << ")";
+
+        mLayout.update(*reg, parts);
+        changed = true;
+    }
+
+    if (changed)
+        mLayout.save();
+}
+
+
 std::string
 constructIdleWaitMessage(const std::chrono::steady_clock::duration& idleWaitDuration) {
     std::stringstream out;
@@ -187,104 +253,128 @@ constructIdleWaitMessage(const std::chrono::steady_clock::duration& idleWaitDura
 }
 
 void
-ModbusThread::run() {
-    try {
-        BOOST_LOG_SEV(log, Log::debug) << "Modbus thread started";
-        const int maxReconnectTime = 60;
-        std::chrono::steady_clock::duration idleWaitDuration = std::chrono::steady_clock::duration::max();
-        std::chrono::steady_clock::time_point nextPollTimePoint = std::chrono::steady_clock::now();
+ModbusThread::dispatchQueuedMessages() {
+    QueueItem item;
+    if (mToModbusQueue.try_dequeue(item))
+        dispatchMessages(item);
+}
 
-        while(mShouldRun) {
-            if (mModbus) {
-                if (!mModbus->isConnected()) {
-                    if (idleWaitDuration > std::chrono::seconds(maxReconnectTime))
-                        idleWaitDuration = std::chrono::seconds(0);
-                    BOOST_LOG_SEV(log, Log::info) << "modbus: connecting";
-                    mModbus->connect();
-                    if (mModbus->isConnected()) {
-                        BOOST_LOG_SEV(log, Log::info) << "modbus: connected";
-                        mWatchdog.reset();
-                        sendMessage(QueueItem::create(MsgModbusNetworkState(mNetworkName, true)));
-                        // if modbus network was disconnected
-                        // we need to refresh everything
-                        if (!mExecutor.isInitialPollInProgress()) {
-                            mExecutor.setupInitialPoll(mScheduler.getPollSpecification());
-                        }
-                    }
+std::chrono::steady_clock::duration
+ModbusThread::step() {
+    const int maxReconnectTime = 60;
+
+    if (mModbus) {
+        if (!mModbus->isConnected()) {
+            if (mIdleWaitDuration > std::chrono::seconds(maxReconnectTime))
+                mIdleWaitDuration = std::chrono::seconds(0);
+            BOOST_LOG_SEV(log, Log::info) << "modbus: connecting";
+            mModbus->connect();
+            if (mModbus->isConnected()) {
+                BOOST_LOG_SEV(log, Log::info) << "modbus: connected";
+                mWatchdog.reset();
+                sendMessage(QueueItem::create(MsgModbusNetworkState(mNetworkName, true)));
+                // if modbus network was disconnected
+                // we need to refresh everything
+                if (!mExecutor.isInitialPollInProgress()) {
+                    mExecutor.setupInitialPoll(mScheduler.getPollSpecification());
                 }
-
-                if (mModbus->isConnected()) {
-                    // start polling only if Mosquitto
-                    // have succesfully connected to Mqtt broker
-                    // to avoid growing mFromModbusQueue with queued register updates
-                    // and if we already got the first MsgPollSpecification
-                    if (mMqttConnected) {
-
-                        auto now = std::chrono::steady_clock::now();
-                        if (!mExecutor.isInitialPollInProgress() && nextPollTimePoint < now) {
-                            std::chrono::steady_clock::duration schedulerWaitDuration;
-                            std::map<int, std::vector<std::shared_ptr<RegisterPoll>>> regsToPoll = mScheduler.getRegistersToPoll(schedulerWaitDuration, now);
-                            nextPollTimePoint = now + schedulerWaitDuration;
-                            mExecutor.addPollList(regsToPoll);
-                            BOOST_LOG_SEV(log, Log::trace) << "Scheduling " << regsToPoll.size() << " registers to execute" <<
-                                ", next schedule in " << std::chrono::duration_cast<std::chrono::milliseconds>(schedulerWaitDuration).count() << "ms";
-                        }
-
-                        if (mExecutor.allDone()) {
-                            idleWaitDuration = (nextPollTimePoint - now);
-                        } else {
-                            idleWaitDuration = mExecutor.executeNext();
-                            if (idleWaitDuration == std::chrono::steady_clock::duration::zero()) {
-                                mWatchdog.inspectCommand(*mExecutor.getLastCommand());
-                            }
-                        }
-                        mMqttConWaitReported = false;
-                    } else {
-                        if (!mMqttConnected && !mMqttConWaitReported) {
-                            BOOST_LOG_SEV(log, Log::info) << "Waiting for mqtt network to become online";
-                            mMqttConWaitReported = true;
-                        }
-
-                        idleWaitDuration = std::chrono::steady_clock::duration::max();
-                    }
-                } else {
-                    sendMessage(QueueItem::create(MsgModbusNetworkState(mNetworkName, false)));
-                    if (idleWaitDuration < std::chrono::seconds(maxReconnectTime))
-                        idleWaitDuration += std::chrono::seconds(5);
-                };
-            } else {
-                //wait for modbus network config
-                idleWaitDuration = std::chrono::steady_clock::duration::max();
             }
+        }
 
-            //dispatchMessages can change mShouldRun flag, do not wait
-            //for next poll if we are exiting
-            if (mShouldRun) {
-                if (mModbus && mModbus->isConnected() && mWatchdog.isReconnectRequired()) {
-                    if (mWatchdog.isDeviceRemoved()) {
-                        BOOST_LOG_SEV(log, Log::error) << "Device " << mWatchdog.getDevicePath() << " was removed, forcing reconnect";
-                    } else {
-                        BOOST_LOG_SEV(log, Log::error) << "Cannot execute any command in last "
-                            << std::chrono::duration_cast<std::chrono::seconds>(mWatchdog.getCurrentErrorPeriod()).count() << "s"
-                            << ", reconnecting";
-                    }
-                    mWatchdog.reset();
-                    mModbus->disconnect();
-                    sendMessage(QueueItem::create(MsgModbusNetworkState(mNetworkName, false)));
+        if (mModbus->isConnected()) {
+            // start polling only if Mosquitto
+            // have succesfully connected to Mqtt broker
+            // to avoid growing mFromModbusQueue with queued register updates
+            // and if we already got the first MsgPollSpecification
+            if (mMqttConnected) {
+
+                auto now = std::chrono::steady_clock::now();
+                if (!mExecutor.isInitialPollInProgress() && mNextPollTimePoint < now) {
+                    std::chrono::steady_clock::duration schedulerWaitDuration;
+                    std::map<int, std::vector<std::shared_ptr<RegisterPoll>>> regsToPoll = mScheduler.getRegistersToPoll(schedulerWaitDuration, now);
+                    mNextPollTimePoint = now + schedulerWaitDuration;
+                    mExecutor.addPollList(regsToPoll);
+                    BOOST_LOG_SEV(log, Log::trace) << "Scheduling " << regsToPoll.size() << " registers to execute" <<
+                        ", next schedule in " << std::chrono::duration_cast<std::chrono::milliseconds>(schedulerWaitDuration).count() << "ms";
+                }
+
+                if (mExecutor.allDone()) {
+                    mIdleWaitDuration = (mNextPollTimePoint - now);
                 } else {
-                    QueueItem item;
-                    BOOST_LOG_SEV(log, Log::trace) << constructIdleWaitMessage(idleWaitDuration);
-                    if (!mToModbusQueue.wait_dequeue_timed(item, idleWaitDuration))
-                        continue;
-                    dispatchMessages(item);
-                    while(mToModbusQueue.try_dequeue(item))
-                        dispatchMessages(item);
+                    mIdleWaitDuration = mExecutor.executeNext();
+                    if (mIdleWaitDuration == std::chrono::steady_clock::duration::zero()) {
+                        mWatchdog.inspectCommand(*mExecutor.getLastCommand());
+                        splitRegisters();
+                    }
+                }
+                mMqttConWaitReported = false;
+            } else {
+                if (!mMqttConnected && !mMqttConWaitReported) {
+                    BOOST_LOG_SEV(log, Log::info) << "Waiting for mqtt network to become online";
+                    mMqttConWaitReported = true;
                 }
+
+                mIdleWaitDuration = std::chrono::steady_clock::duration::max();
             }
+        } else {
+            sendMessage(QueueItem::create(MsgModbusNetworkState(mNetworkName, false)));
+            if (mIdleWaitDuration < std::chrono::seconds(maxReconnectTime))
+                mIdleWaitDuration += std::chrono::seconds(5);
+        };
+    } else {
+        //wait for modbus network config
+        mIdleWaitDuration = std::chrono::steady_clock::duration::max();
+    }
+
+    if (mModbus && mModbus->isConnected() && mWatchdog.isReconnectRequired()) {
+        if (mWatchdog.isDeviceRemoved()) {
+            BOOST_LOG_SEV(log, Log::error) << "Device " << mWatchdog.getDevicePath() << " was removed, forcing reconnect";
+        } else {
+            BOOST_LOG_SEV(log, Log::error) << "Cannot execute any command in last "
+                << std::chrono::duration_cast<std::chrono::seconds>(mWatchdog.getCurrentErrorPeriod()).count() << "s"
+                << ", reconnecting";
+        }
+        mWatchdog.reset();
+        mModbus->disconnect();
+        sendMessage(QueueItem::create(MsgModbusNetworkState(mNetworkName, false)));
+        return std::chrono::steady_clock::duration::zero();
+    }
+
+    BOOST_LOG_SEV(log, Log::trace) << constructIdleWaitMessage(mIdleWaitDuration);
+    return mIdleWaitDuration;
+}
+
+void
+ModbusThread::finish() {
+    if (mModbus && mModbus->isConnected())
+        mModbus->disconnect();
+    if (mExecutor.getDroppedWriteCount() != 0 || mExecutor.getReplacedWriteCount() != 0 || mExecutor.getCollapsedValueCount() != 0) {
+        BOOST_LOG_SEV(log, Log::info) << mNetworkName << ": queue overflow summary"
+            << ", dropped writes: " << mExecutor.getDroppedWriteCount()
+            << ", replaced writes: " << mExecutor.getReplacedWriteCount()
+            << ", skipped register values: " << mExecutor.getCollapsedValueCount();
+    }
+    if (mExecutor.getSuppressedUpdateCount() != 0) {
+        BOOST_LOG_SEV(log, Log::info) << mNetworkName << ": " << mExecutor.getSuppressedUpdateCount()
+            << " register update(s) suppressed by deadband";
+    }
+    BOOST_LOG_SEV(log, Log::debug) << "Modbus thread " << mNetworkName << " ended";
+}
+
+void
+ModbusThread::run() {
+    try {
+        BOOST_LOG_SEV(log, Log::debug) << "Modbus thread started";
+
+        while(mShouldRun) {
+            std::chrono::steady_clock::duration idleWaitDuration = step();
+
+            QueueItem item;
+            if (!mToModbusQueue.wait_dequeue_timed(item, idleWaitDuration))
+                continue;
+            dispatchMessages(item);
         };
-        if (mModbus && mModbus->isConnected())
-            mModbus->disconnect();
-        BOOST_LOG_SEV(log, Log::debug) << "Modbus thread " << mNetworkName << " ended";
+        finish();
     } catch (const std::exception& ex) {
         BOOST_LOG_SEV(log, Log::critical) << "Error in modbus thread " << mNetworkName << ": " << ex.what();
     } catch (...) {
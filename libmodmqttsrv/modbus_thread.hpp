@@ -8,6 +8,7 @@
 #include "modbus_slave.hpp"
 #include "modbus_executor.hpp"
 #include "modbus_watchdog.hpp"
+#include "register_layout.hpp"
 
 #include "imodbuscontext.hpp"
 
@@ -15,16 +16,38 @@ namespace modmqttd {
 
 class ModbusThread {
     public:
-        static void sendMessageFromModbus(moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue, const QueueItem& item);
+        // max time polled values are held by executor
+        // before sending them to main thread
+        static constexpr std::chrono::milliseconds MAX_VALUES_BATCH_DELAY = std::chrono::milliseconds(20);
+
+        static void sendMessageFromModbus(
+            moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue,
+            QueueSignal* fromModbusSignal,
+            const QueueItem& item);
 
         ModbusThread(
             moodycamel::BlockingReaderWriterQueue<QueueItem>& toModbusQueue,
-            moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue);
+            moodycamel::BlockingReaderWriterQueue<QueueItem>& fromModbusQueue,
+            QueueSignal& fromModbusSignal);
+        // thread loop used when network has its own thread
         void run();
+
+        /**
+         * Single iteration of run() loop without waiting for messages.
+         * Returns time after which step() should be called again
+         * if no new message is received.
+         * */
+        std::chrono::steady_clock::duration step();
+        void dispatchQueuedMessages();
+        bool isRunning() const { return mShouldRun; }
+        // disconnect from modbus network after exit command
+        void finish();
+        const std::string& getNetworkName() const { return mNetworkName; }
     private:
         boost::log::sources::severity_logger<Log::severity> log;
         moodycamel::BlockingReaderWriterQueue<QueueItem>& mToModbusQueue;
         moodycamel::BlockingReaderWriterQueue<QueueItem>& mFromModbusQueue;
+        QueueSignal& mFromModbusSignal;
 
         // global config
         std::string mNetworkName;
@@ -42,14 +65,19 @@ class ModbusThread {
         bool mMqttConWaitReported = false;
         bool mGotRegisters = false;
 
+        std::chrono::steady_clock::duration mIdleWaitDuration = std::chrono::steady_clock::duration::max();
+        std::chrono::steady_clock::time_point mNextPollTimePoint = std::chrono::steady_clock::now();
+
         std::shared_ptr<IModbusContext> mModbus;
         ModbusScheduler mScheduler;
         ModbusExecutor mExecutor;
         ModbusWatchdog mWatchdog;
+        RegisterLayout mLayout;
 
         void configure(const ModbusNetworkConfig& config);
         void setPollSpecification(const MsgRegisterPollSpecification& spec);
         void updateFromSlaveConfig(const ModbusSlaveConfig& pSlaveConfig);
+        void splitRegisters();
 
         void dispatchMessages(const QueueItem& read);
         void sendMessage(const QueueItem& item);
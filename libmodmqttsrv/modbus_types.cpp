@@ -1,3 +1,4 @@
+#include <cmath>
 
 #include "modbus_types.hpp"
 
@@ -15,6 +16,14 @@ ModbusAddressRange::overlaps(const ModbusAddressRange& poll) const {
     );
 }
 
+bool
+ModbusAddressRange::contains(const ModbusAddressRange& other) const {
+    if (mRegisterType != other.mRegisterType)
+        return false;
+
+    return firstRegister() <= other.firstRegister() && other.lastRegister() <= lastRegister();
+}
+
 void
 ModbusAddressRange::merge(const ModbusAddressRange& other) {
     int first = firstRegister() <= other.firstRegister() ? firstRegister() : other.firstRegister();
@@ -41,4 +50,13 @@ ModbusAddressRange::isSameAs(const ModbusAddressRange& other) const {
     return mRegister == other.mRegister && mCount == other.mCount;
 }
 
+bool
+RegisterDeadband::isInside(uint16_t pSent, uint16_t pNew) const {
+    double sent = mSigned ? int16_t(pSent) : pSent;
+    double diff = std::abs((mSigned ? int16_t(pNew) : pNew) - sent);
+    if (mType == Type::PERCENT)
+        return diff <= std::abs(sent) * mValue / 100;
+    return diff <= mValue;
+}
+
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 
 #include "logging.hpp"
 
@@ -23,6 +24,7 @@ class ModbusAddressRange {
 
         void merge(const ModbusAddressRange& other);
         bool overlaps(const ModbusAddressRange& poll) const;
+        bool contains(const ModbusAddressRange& other) const;
         bool isConsecutiveOf(const ModbusAddressRange& other) const;
         bool isSameAs(const ModbusAddressRange& other) const;
         int firstRegister() const { return mRegister; }
@@ -44,4 +46,35 @@ class ModbusSlaveAddressRange : public ModbusAddressRange {
         int mSlaveId;
 };
 
+
+/**
+ * Minimum change of a polled register value from the last
+ * value sent to MqttClient. Smaller changes are dropped by modbus thread.
+ * */
+class RegisterDeadband {
+    public:
+        enum Type {
+            ABSOLUTE = 0,
+            // percent of the last sent value
+            PERCENT = 1
+        };
+
+        RegisterDeadband(double pValue = 0, Type pType = Type::ABSOLUTE)
+            : mValue(pValue), mType(pType)
+        {}
+
+        bool isZero() const { return mValue == 0; }
+        // true if pNew differs from pSent not more than deadband allows
+        bool isInside(uint16_t pSent, uint16_t pNew) const;
+
+        bool operator==(const RegisterDeadband& other) const {
+            return mValue == other.mValue && mType == other.mType && mSigned == other.mSigned;
+        }
+
+        double mValue;
+        Type mType;
+        // register holds int16_t value
+        bool mSigned = false;
+};
+
 }
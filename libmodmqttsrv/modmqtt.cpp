@@ -1,7 +1,9 @@
 #include <string>
 #include <regex>
+#include <algorithm>
 #include <yaml-cpp/yaml.h>
 #include <boost/dll/import.hpp>
+#include <boost/dll/shared_library.hpp>
 #include <boost/algorithm/string.hpp>
 
 
@@ -14,10 +16,14 @@
 #include "modbus_context.hpp"
 #include "modbus_slave.hpp"
 #include "conv_name_parser.hpp"
+#include "converter_v2_adapter.hpp"
 #include "yaml_converters.hpp"
 
 #include <csignal>
+#include <cstring>
 #include <iostream>
+#include <sys/epoll.h>
+#include <unistd.h>
 
 namespace
 {
@@ -32,9 +38,7 @@ void signal_handler(int signal)
 
 namespace modmqttd {
 
-std::mutex gQueueMutex;
-std::condition_variable gHasMessagesCondition;
-bool gHasMessages = false;
+QueueSignal gMainLoopSignal;
 std::shared_ptr<IModbusFactory> ModMqtt::mModbusFactory;
 
 
@@ -84,9 +88,16 @@ class RegisterConfigName {
 
 void
 notifyQueues() {
-    std::unique_lock<std::mutex> lock(gQueueMutex);
-    gHasMessages = true;
-	gHasMessagesCondition.notify_one();
+    gMainLoopSignal.notify();
+}
+
+static void
+watchQueueSignal(int epollFd, const QueueSignal& signal, void* data) {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = data;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, signal.getFd(), &ev) == -1)
+        throw ModMqttException(std::string("Cannot add descriptor to epoll: ") + strerror(errno));
 }
 
 RegisterType
@@ -114,9 +125,90 @@ parsePublishMode(const YAML::Node& data, PublishMode pDefault = PublishMode::ON_
         return PublishMode::ON_CHANGE;
     } else if (pmode == "every_poll") {
         return PublishMode::EVERY_POLL;
+    } else if (pmode == "aggregate") {
+        return PublishMode::AGGREGATE;
+    }
+
+    throw ConfigurationException(data.Mark(), std::string("Invalid publish mode '") + pmode + "', valid values are: on_change, every_poll, aggregate");
+}
+
+/**
+ * Deadband is checked by modbus thread on raw register data,
+ * so it is allowed only for values stored in a single register
+ * and converters that do not change the order of values
+ */
+RegisterDeadband
+parseDeadband(const YAML::Node& data, RegisterType pType, int pCount, const YAML::Node& pConverter) {
+    std::string value;
+    if (!ConfigTools::readOptionalValue<std::string>(value, data, "deadband"))
+        return RegisterDeadband();
+
+    if (pType == RegisterType::COIL || pType == RegisterType::BIT)
+        throw ConfigurationException(data["deadband"].Mark(), "deadband cannot be set for coil and bit registers");
+
+    if (pCount > 1)
+        throw ConfigurationException(data["deadband"].Mark(), "deadband can be set only for a value stored in a single register");
+
+    RegisterDeadband ret;
+    if (pConverter.IsDefined()) {
+        std::string name(ConfigTools::readRequiredValue<std::string>(pConverter));
+        ConverterSpecification spec(ConverterNameParser::parse(name));
+        if (spec.plugin == "std" && spec.converter == "int16") {
+            ret.mSigned = true;
+        } else if (spec.plugin != "std" || (spec.converter != "divide" && spec.converter != "multiply" && spec.converter != "scale")) {
+            throw ConfigurationException(data["deadband"].Mark(), "deadband cannot be used with converter " + name
+                + ", allowed converters are std.int16, std.divide, std.multiply and std.scale");
+        }
+    }
+
+    if (!value.empty() && value.back() == '%') {
+        ret.mType = RegisterDeadband::Type::PERCENT;
+        value.pop_back();
+    }
+
+    std::size_t parsed = 0;
+    try {
+        ret.mValue = std::stod(value, &parsed);
+    } catch (const std::exception&) {
+        parsed = 0;
     }
+    if (parsed == 0 || parsed != value.size() || ret.mValue < 0)
+        throw ConfigurationException(data["deadband"].Mark(), "deadband must be a positive number or a percent value");
 
-    throw ConfigurationException(data.Mark(), std::string("Invalid publish mode '") + pmode + "', valid values are: on_change, every_poll");
+    return ret;
+}
+
+/**
+ * Registers converted to a single value must be read with a single
+ * modbus command, otherwise the value could be built from registers
+ * read at different time
+ */
+void
+addValueRange(MqttObjectDataNode& pNode, std::vector<MsgRegisterPollSpecification>& pSpecs) {
+    std::vector<MqttObjectDataNode*> scalars;
+    pNode.collectScalarNodes(scalars);
+    if (scalars.size() < 2)
+        return;
+
+    const MqttObjectRegisterIdent& first = scalars.front()->getRegisterIdent();
+    int minRegister = first.mRegisterNumber;
+    int maxRegister = first.mRegisterNumber;
+    for(const MqttObjectDataNode* scalar: scalars) {
+        const MqttObjectRegisterIdent& ident = scalar->getRegisterIdent();
+        // registers of different type or slave cannot be read together anyway
+        if (ident.mNetworkId != first.mNetworkId || ident.mSlaveId != first.mSlaveId || ident.mRegisterType != first.mRegisterType)
+            return;
+        minRegister = std::min(minRegister, ident.mRegisterNumber);
+        maxRegister = std::max(maxRegister, ident.mRegisterNumber);
+    }
+
+    const std::string& network = first.getNetworkName();
+    auto spec_it = std::find_if(
+        pSpecs.begin(), pSpecs.end(),
+        [&network](const MsgRegisterPollSpecification& s) -> bool { return s.mNetworkName == network; }
+    );
+    if (spec_it != pSpecs.end())
+        spec_it->addValueRange(ModbusSlaveAddressRange(first.mSlaveId, minRegister, first.mRegisterType, maxRegister - minRegister + 1));
 }
 
 MqttObjectCommand::PayloadType
@@ -136,6 +228,10 @@ ModMqtt::ModMqtt()
     // unit tests create main class multiple times
     // reset global flag at each creation
     gSignalStatus = -1;
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd == -1)
+        throw ModMqttException(std::string("Cannot create epoll instance: ") + strerror(errno));
+    watchQueueSignal(mEpollFd, gMainLoopSignal, nullptr);
     Mosquitto::libInit();
     mMqtt.reset(new MqttClient(*this));
     mModbusFactory.reset(new ModbusFactory());
@@ -169,6 +265,7 @@ ModMqtt::init(const YAML::Node& config) {
         sit++)
     {
         const std::string& netname = sit->mNetworkName;
+        int networkId = StringPool::networkNames().find(netname);
 
         const auto& mqtt_spec = std::find_if(
             mqtt_specs.begin(), mqtt_specs.end(),
@@ -182,8 +279,28 @@ ModMqtt::init(const YAML::Node& config) {
             for(const auto& reg: mqtt_spec->mRegisters) {
                 sit->merge(reg);
             }
+            sit->mValueRanges.insert(sit->mValueRanges.end(), mqtt_spec->mValueRanges.begin(), mqtt_spec->mValueRanges.end());
+            sit->mDeadbands.insert(mqtt_spec->mDeadbands.begin(), mqtt_spec->mDeadbands.end());
         }
 
+        // poll groups are split before creating MqttPollObjMap
+        // so MqttObjects get values from modbus reads that fit in a single command.
+        // Drop parts that are not used by any MqttObject.
+        try {
+            sit->split();
+        } catch (const ModMqttException& ex) {
+            throw ConfigurationException(config["mqtt"].Mark(), ex.what());
+        }
+        sit->mRegisters.erase(
+            std::remove_if(sit->mRegisters.begin(), sit->mRegisters.end(),
+                [&objects, networkId](const MsgRegisterPoll& poll) -> bool {
+                    return std::none_of(objects.begin(), objects.end(),
+                        [networkId, &poll](const MqttObject& obj) -> bool { return obj.hasRegisterIn(networkId, poll); }
+                    );
+                }),
+            sit->mRegisters.end()
+        );
+
         std::vector<std::shared_ptr<ModbusClient>>::iterator client = std::find_if(
             mModbusClients.begin(), mModbusClients.end(),
             [&netname](const std::shared_ptr<ModbusClient>& client) -> bool { return client->mNetworkName == netname; }
@@ -191,8 +308,16 @@ ModMqtt::init(const YAML::Node& config) {
         if (client == mModbusClients.end()) {
             BOOST_LOG_SEV(log, Log::error) << "Modbus client for network [" << netname << "] not initialized, ignoring specification";
         } else {
+            // MqttClient gets values for poll groups from *sit,
+            // modbus thread reads them using coalesced groups
+            MsgRegisterPollSpecification readSpec(*sit);
+            int saved = readSpec.coalesce();
+            if (saved != 0) {
+                BOOST_LOG_SEV(log, Log::info) << "Network " << netname << ": " << sit->mRegisters.size() << " poll groups coalesced into "
+                    << readSpec.mRegisters.size() << " modbus reads, " << saved << " transaction(s) saved per poll cycle";
+            }
             BOOST_LOG_SEV(log, Log::debug) << "Sending register specification to modbus thread for network " << netname;
-            (*client)->mToModbusQueue.enqueue(QueueItem::create(*sit));
+            (*client)->sendToModbus(QueueItem::create(readSpec));
         }
     };
 
@@ -206,18 +331,20 @@ ModMqtt::init(const YAML::Node& config) {
             sit != modbusData.mPollSpecification.end();
             sit++)
         {
+            int networkId = StringPool::networkNames().find(sit->mNetworkName);
             for(std::vector<MsgRegisterPoll>::const_iterator rit = sit->mRegisters.begin(); rit != sit->mRegisters.end(); rit++) {
-                if (obj.hasRegisterIn(sit->mNetworkName, *rit)) {
+                if (obj.hasRegisterIn(networkId, *rit)) {
                     MqttObjectRegisterIdent ident(sit->mNetworkName, *rit);
                     mappedPollObjects[ident].push_back(optr);
                 }
             }
         }
-        const std::map<std::string, MqttObjectCommand>& commands(mMqtt->getCommands());
-        for(std::map<std::string, MqttObjectCommand>::const_iterator it = commands.begin(); it != commands.end(); it++) {
-            if (obj.hasRegisterIn(it->second.mModbusNetworkName, it->second)) {
-                assert(it->second.getCommandId() > 0);
-                mappedCommandObjects[it->second.getCommandId()].push_back(optr);
+        const MqttCommandRouter::RouteMap& commands(mMqtt->getCommands());
+        for(MqttCommandRouter::RouteMap::const_iterator it = commands.begin(); it != commands.end(); it++) {
+            const MqttObjectCommand& command(it->second.mCommand);
+            if (obj.hasRegisterIn(StringPool::networkNames().find(command.mModbusNetworkName), command)) {
+                assert(command.getCommandId() > 0);
+                mappedCommandObjects[command.getCommandId()].push_back(optr);
             }
         }
     }
@@ -268,6 +395,15 @@ ModMqtt::initServer(const YAML::Node& config) {
             }
         }
     }
+
+    int workerThreads = 0;
+    const YAML::Node& workers = ConfigTools::setOptionalValueFromNode(workerThreads, server, "modbus_worker_threads");
+    if (workers.IsDefined()) {
+        if (workerThreads < 0)
+            throw ConfigurationException(workers.Mark(), "modmqttd.modbus_worker_threads cannot be negative");
+        if (workerThreads > 0)
+            mModbusEventLoop.reset(new ModbusEventLoop(workerThreads));
+    }
 }
 
 std::shared_ptr<ConverterPlugin>
@@ -297,6 +433,28 @@ ModMqtt::initConverterPlugin(const std::string& name) {
 
     BOOST_LOG_SEV(log, Log::debug) << "Trying to load converter plugin from " << final_path;
 
+    boost::dll::shared_library lib(final_path, boost::dll::load_mode::append_decorations);
+    // plugins built before converter API was versioned do not export it
+    int version = lib.has("converter_api_version") ? lib.get<const int>("converter_api_version") : MODMQTT_CONVERTER_API_VERSION_V1;
+    if (version == MODMQTT_CONVERTER_API_VERSION_V1 || version == MODMQTT_CONVERTER_API_VERSION_V2) {
+        BOOST_LOG_SEV(log, Log::info) << "Converter plugin " << name
+            << " is built for converter API version " << version << ", values are copied to current MqttValue on every conversion."
+            << " Rebuild plugin with version " << MODMQTT_CONVERTER_API_VERSION << " to avoid it";
+        std::shared_ptr<ConverterPluginV2> legacy = boost_dll_import<ConverterPluginV2>(
+            final_path,
+            "converter_plugin",
+            boost::dll::load_mode::append_decorations
+        );
+        return std::shared_ptr<ConverterPlugin>(new ConverterPluginV2Adapter(legacy, version));
+    }
+
+    if (version != MODMQTT_CONVERTER_API_VERSION) {
+        throw ConvPluginNotFoundException(std::string("Converter plugin ") + name
+            + " is built for converter API version " + std::to_string(version)
+            + ", expected " + std::to_string(MODMQTT_CONVERTER_API_VERSION) + ". Please rebuild plugin."
+        );
+    }
+
     std::shared_ptr<ConverterPlugin> plugin = boost_dll_import<ConverterPlugin>(
         final_path,
         "converter_plugin",
@@ -373,10 +531,12 @@ ModMqtt::initModbusClients(const YAML::Node& config) {
 
         //initialize modbus thread
         std::shared_ptr<ModbusClient> modbus(new ModbusClient());
-        modbus->init(modbus_config);
+        watchQueueSignal(mEpollFd, modbus->mFromModbusSignal, modbus.get());
+        modbus->init(modbus_config, mModbusEventLoop);
         mModbusClients.push_back(modbus);
 
         MsgRegisterPollSpecification spec(modbus_config.mName);
+        spec.mMaxGap = modbus_config.mMaxGap;
         // send modbus slave configurations
         // for defined slaves
         const YAML::Node& slaves = network["slaves"];
@@ -395,8 +555,12 @@ ModMqtt::initModbusClients(const YAML::Node& config) {
 
                     for(int addr = addr_range.first; addr <= addr_range.second; addr++) {
                         ModbusSlaveConfig slave_config(addr, ySlave);
-                        modbus->mToModbusQueue.enqueue(QueueItem::create(slave_config));
+                        modbus->sendToModbus(QueueItem::create(slave_config));
                         spec.merge(readModbusPollGroups(modbus_config.mName, slave_config.mAddress, ySlave["poll_groups"]));
+                        if (slave_config.mMaxGap >= 0)
+                            spec.mSlaveMaxGap[slave_config.mAddress] = slave_config.mMaxGap;
+                        if (slave_config.mMaxReadRegisters > 0)
+                            spec.mSlaveMaxReadRegisters[slave_config.mAddress] = slave_config.mMaxReadRegisters;
 
                         if (!slave_config.mSlaveName.empty())
                             ret.mSlaveNames[modbus->mNetworkName][slave_config.mAddress] = slave_config.mSlaveName;
@@ -575,6 +739,8 @@ ModMqtt::parseObjectDataNode(
             throw ConfigurationException(yRegisters.Mark(), "'registers' must be a list");
         for(size_t i = 0; i < yRegisters.size(); i++) {
             const YAML::Node& yData = yRegisters[i];
+            if (converter.IsDefined() && yData["deadband"].IsDefined())
+                throw ConfigurationException(yData["deadband"].Mark(), "deadband cannot be set for registers converted to a single value");
             MqttObjectDataNode childNode(parseObjectDataNode(yData, pDefaultNetwork, pDefaultSlaveId, pRefresh, pMode, pEveryPollRefreshOut, pSpecsOut));
             //the first element defines if we have named or unnamed list
             if (i == 0)
@@ -589,7 +755,8 @@ ModMqtt::parseObjectDataNode(
         int count = 1;
         ConfigTools::readOptionalValue<int>(count, pNode, "count");
 
-        MqttObjectRegisterIdent first_ident = updateSpecification(pNode, count, pRefresh, pDefaultNetwork, pDefaultSlaveId, pMode, pSpecsOut);
+        RegisterDeadband deadband(parseDeadband(pNode, parseRegisterType(pNode), count, converter));
+        MqttObjectRegisterIdent first_ident = updateSpecification(pNode, count, pRefresh, pDefaultNetwork, pDefaultSlaveId, pMode, pSpecsOut, deadband);
         if (count == 1) {
             node.setScalarNode(first_ident);
         } else {
@@ -603,6 +770,9 @@ ModMqtt::parseObjectDataNode(
         }
     }
 
+    if (node.hasConverter())
+        addValueRange(node, pSpecsOut);
+
     return node;
 }
 
@@ -652,6 +822,15 @@ ModMqtt::createConverter(const YAML::Node& node) const {
     try {
         ConverterSpecification spec(ConverterNameParser::parse(line));
 
+        // the same key for definitions that differ in whitespace
+        // and quoting only, arguments are prefixed with their length
+        std::string key(spec.plugin + "." + spec.converter);
+        for(const std::string& arg: spec.args)
+            key += std::to_string(arg.size()) + ":" + arg;
+        std::map<std::string, std::shared_ptr<DataConverter>>::const_iterator shared = mSharedConverters.find(key);
+        if (shared != mSharedConverters.end())
+            return shared->second;
+
         std::shared_ptr<DataConverter> conv = createConverterInstance(spec.plugin, spec.converter);
         if (conv == nullptr)
             throw ConfigurationException(node.Mark(), "Converter " + spec.plugin + "." + spec.converter + " not found");
@@ -660,6 +839,10 @@ ModMqtt::createConverter(const YAML::Node& node) const {
         } catch (const std::exception& ex) {
             throw ConfigurationException(node.Mark(), ex.what());
         }
+        // allows to convert all values in poll group
+        // with a single toMqttBatch() call
+        if (conv->hasBatchConversion())
+            mSharedConverters[key] = conv;
         return conv;
     } catch (const ConvNameParserException& ex) {
         throw ConfigurationException(node.Mark(), ex.what());
@@ -723,6 +906,12 @@ ModMqtt::initObjects(const YAML::Node& config, const ModMqtt::ModbusInitData& mo
 
     PublishMode defaultPublishMode = parsePublishMode(mqtt);
 
+    auto mqttMinPublishInterval = std::chrono::milliseconds::zero();
+    ConfigTools::readOptionalValue<std::chrono::milliseconds>(mqttMinPublishInterval, mqtt, "min_publish_interval");
+
+    auto mqttAggregateWindow = std::chrono::milliseconds(60000);
+    ConfigTools::readOptionalValue<std::chrono::milliseconds>(mqttAggregateWindow, mqtt, "aggregate_window");
+
     const YAML::Node& config_objects = mqtt["objects"];
     if (!config_objects.IsDefined())
         throw ConfigurationException(mqtt.Mark(), "objects section is missing");
@@ -750,6 +939,14 @@ ModMqtt::initObjects(const YAML::Node& config, const ModMqtt::ModbusInitData& mo
         auto defaultRefresh = mqttDefaultRefresh;
         ConfigTools::readOptionalValue<std::chrono::milliseconds>(defaultRefresh, objdata, "refresh");
 
+        auto minPublishInterval = mqttMinPublishInterval;
+        ConfigTools::readOptionalValue<std::chrono::milliseconds>(minPublishInterval, objdata, "min_publish_interval");
+
+        auto aggregateWindow = mqttAggregateWindow;
+        ConfigTools::readOptionalValue<std::chrono::milliseconds>(aggregateWindow, objdata, "aggregate_window");
+        if (aggregateWindow <= std::chrono::milliseconds::zero())
+            throw ConfigurationException(objdata.Mark(), "aggregate_window must be greater than 0");
+
         for(const std::string& currentNetwork: networks) {
             if (currentNetwork.size() != 0) {
                 std::vector<std::shared_ptr<ModbusClient>>::const_iterator cit = std::find_if(
@@ -778,6 +975,9 @@ ModMqtt::initObjects(const YAML::Node& config, const ModMqtt::ModbusInitData& mo
                         defaultPublishMode,
                         pSpecsOut)
                     );
+                    object.setMinPublishInterval(minPublishInterval);
+                    if (object.getPublishMode() == PublishMode::AGGREGATE)
+                        object.setAggregateWindow(aggregateWindow);
                     const std::string& baseTopic(object.getTopic());
 
                     std::vector<MqttObject>::const_iterator oit = std::find_if(
@@ -808,7 +1008,8 @@ ModMqtt::updateSpecification(
     const std::string& pDefaultNetwork,
     int pDefaultSlaveId,
     PublishMode pCurrentMode,
-    std::vector<MsgRegisterPollSpecification>& specs)
+    std::vector<MsgRegisterPollSpecification>& specs,
+    const RegisterDeadband& pDeadband)
 {
     const RegisterConfigName rname(data, pDefaultNetwork, pDefaultSlaveId);
 
@@ -828,6 +1029,7 @@ ModMqtt::updateSpecification(
     }
 
     spec_it->merge(poll);
+    spec_it->addDeadband(poll.mSlaveId, poll.mRegisterType, poll.mRegister, poll.mCount, pDeadband);
 
     return MqttObjectRegisterIdent(rname.mNetworkName, rname.mSlaveId, poll.mRegisterType, poll.mRegister);
 }
@@ -854,8 +1056,9 @@ void ModMqtt::start() {
 
     while(mMqtt->isStarted()) {
         if (gSignalStatus == -1) {
-            waitForQueues();
+            waitForQueues(mMqtt->getDelayedPublishTimeout());
             processModbusMessages();
+            mMqtt->publishDelayedStates();
         } else if (gSignalStatus > 0) {
             int currentSignal = gSignalStatus;
             gSignalStatus = -1;
@@ -881,7 +1084,12 @@ void ModMqtt::start() {
     }
 
     //process mqtt queue after modbus clients are stopped
-    processModbusMessages();
+    for(std::vector<std::shared_ptr<ModbusClient>>::iterator client = mModbusClients.begin();
+        client < mModbusClients.end(); client++)
+    {
+        processModbusMessages(**client);
+    }
+    mReadyClients.clear();
 
     if (mMqtt->isConnected()) {
         BOOST_LOG_SEV(log, Log::info) << "Publishing availability status 0 for all registers";
@@ -895,12 +1103,13 @@ void ModMqtt::start() {
     BOOST_LOG_SEV(log, Log::debug) << "Shutting down mosquitto client";
     // If connected, then shutdown()
     // will send disconnection request to mqtt broker.
-    // After disconnection mMqtt will notify global queue mutex
+    // After disconnection mMqtt will notify main loop
     // Otherwise we are already stopped.
     mMqtt->shutdown();
     if (mMqtt->isStarted()) {
         BOOST_LOG_SEV(log, Log::debug) << "Waiting for disconnection event";
-        waitForQueues();
+        while(mMqtt->isStarted())
+            waitForQueues();
     }
 
     //TODO mosquitto thread could add some messages to
@@ -918,26 +1127,33 @@ ModMqtt::stop() {
 
 void
 ModMqtt::processModbusMessages() {
+    for(ModbusClient* client: mReadyClients)
+        processModbusMessages(*client);
+    mReadyClients.clear();
+}
+
+void
+ModMqtt::processModbusMessages(ModbusClient& client) {
     QueueItem item;
-    for(std::vector<std::shared_ptr<ModbusClient>>::iterator client = mModbusClients.begin();
-        client < mModbusClients.end(); client++)
-    {
-        while ((*client)->mFromModbusQueue.try_dequeue(item)) {
-            if (item.isSameAs(typeid(MsgRegisterValues))) {
-                std::unique_ptr<MsgRegisterValues> val(item.getData<MsgRegisterValues>());
-                mMqtt->processRegisterValues((*client)->mNetworkName, *val);
-            } else if (item.isSameAs(typeid(MsgRegisterReadFailed))) {
-                std::unique_ptr<MsgRegisterReadFailed> val(item.getData<MsgRegisterReadFailed>());
-                mMqtt->processRegistersOperationFailed((*client)->mNetworkName, *val);
-            } else if (item.isSameAs(typeid(MsgRegisterWriteFailed))) {
-                std::unique_ptr<MsgRegisterWriteFailed> val(item.getData<MsgRegisterWriteFailed>());
-                mMqtt->processRegistersOperationFailed((*client)->mNetworkName, *val);
-            } else if (item.isSameAs(typeid(MsgModbusNetworkState))) {
-                std::unique_ptr<MsgModbusNetworkState> val(item.getData<MsgModbusNetworkState>());
-                mMqtt->processModbusNetworkState(val->mNetworkName, val->mIsUp);
-            } else {
-                BOOST_LOG_SEV(log, Log::error) << "Unknown message from modbus thread, ignoring";
-            }
+    while (client.mFromModbusQueue.try_dequeue(item)) {
+        if (item.isSameAs(typeid(MsgRegisterValuesBatch))) {
+            std::unique_ptr<MsgRegisterValuesBatch> batch(item.getData<MsgRegisterValuesBatch>());
+            for(const MsgRegisterValues& val: batch->mValues)
+                mMqtt->processRegisterValues(client.mNetworkName, val);
+        } else if (item.isSameAs(typeid(MsgRegisterValues))) {
+            std::unique_ptr<MsgRegisterValues> val(item.getData<MsgRegisterValues>());
+            mMqtt->processRegisterValues(client.mNetworkName, *val);
+        } else if (item.isSameAs(typeid(MsgRegisterReadFailed))) {
+            std::unique_ptr<MsgRegisterReadFailed> val(item.getData<MsgRegisterReadFailed>());
+            mMqtt->processRegistersOperationFailed(client.mNetworkName, *val);
+        } else if (item.isSameAs(typeid(MsgRegisterWriteFailed))) {
+            std::unique_ptr<MsgRegisterWriteFailed> val(item.getData<MsgRegisterWriteFailed>());
+            mMqtt->processRegistersOperationFailed(client.mNetworkName, *val);
+        } else if (item.isSameAs(typeid(MsgModbusNetworkState))) {
+            std::unique_ptr<MsgModbusNetworkState> val(item.getData<MsgModbusNetworkState>());
+            mMqtt->processModbusNetworkState(val->mNetworkName, val->mIsUp);
+        } else {
+            BOOST_LOG_SEV(log, Log::error) << "Unknown message from modbus thread, ignoring";
         }
     }
 }
@@ -958,15 +1174,33 @@ ModMqtt::hasConverterPlugin(const std::string& name) const {
 
 void
 ModMqtt::waitForSignal() {
-    std::unique_lock<std::mutex> lock(gQueueMutex);
-    gHasMessagesCondition.wait_for(lock, std::chrono::seconds(5));
+    waitForQueues(5000);
 }
 
 void
-ModMqtt::waitForQueues() {
-    std::unique_lock<std::mutex> lock(gQueueMutex);
-    gHasMessagesCondition.wait(lock, []{ return gHasMessages;});
-    gHasMessages = false;
+ModMqtt::waitForQueues(int pTimeoutMs) {
+    const int maxEvents = 16;
+    struct epoll_event events[maxEvents];
+
+    int count = epoll_wait(mEpollFd, events, maxEvents, pTimeoutMs);
+    if (count == -1) {
+        if (errno != EINTR)
+            BOOST_LOG_SEV(log, Log::error) << "Main loop epoll_wait failed: " << strerror(errno);
+        return;
+    }
+
+    for(int i = 0; i < count; i++) {
+        if (events[i].data.ptr == nullptr) {
+            gMainLoopSignal.clear();
+            continue;
+        }
+        ModbusClient* client = static_cast<ModbusClient*>(events[i].data.ptr);
+        // signal must be cleared before queue is drained, otherwise
+        // notification for message added after draining can be lost
+        client->mFromModbusSignal.clear();
+        if (std::find(mReadyClients.begin(), mReadyClients.end(), client) == mReadyClients.end())
+            mReadyClients.push_back(client);
+    }
 }
 
 void
@@ -984,6 +1218,7 @@ ModMqtt::~ModMqtt() {
     // we need to delete all conveter instances
     // from plugins before unloading plugin libraries
     mMqtt = nullptr;
+    close(mEpollFd);
 }
 
 } //namespace
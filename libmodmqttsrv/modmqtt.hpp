@@ -1,8 +1,6 @@
 #pragma once
 #include <vector>
 #include <stack>
-#include <mutex>
-#include <condition_variable>
 
 #include "libmodmqttconv/converterplugin.hpp"
 
@@ -12,14 +10,13 @@
 #include "modbus_messages.hpp"
 #include "mqttobject.hpp"
 #include "imodbuscontext.hpp"
+#include "queue_signal.hpp"
 
 
 namespace modmqttd {
 
-// global shared lock for modbus threads and main loop
-// to wait on empty queues and posix singals processing
-extern std::mutex gQueueMutex;
-extern std::condition_variable gHasMessagesCondition;
+// wakes up main loop for posix signal
+// and mqtt connection state processing
 void notifyQueues();
 
 
@@ -39,7 +36,9 @@ class ModMqtt {
             Used by unit tests only
         */
         void stop();
-        void waitForQueues();
+        // wait until main loop is notified or one of
+        // modbus clients sends a message. Timeout -1 waits forever
+        void waitForQueues(int pTimeoutMs = -1);
         void setMqttFinished() { mMqttFinished = true; }
 
         void setMqttImplementation(const std::shared_ptr<IMqttImpl>& impl);
@@ -67,9 +66,19 @@ class ModMqtt {
         static std::shared_ptr<IModbusFactory> mModbusFactory;
 
         std::shared_ptr<MqttClient> mMqtt;
+        // must outlive mModbusClients, they are stopped in destructor
+        std::shared_ptr<ModbusEventLoop> mModbusEventLoop;
         std::vector<std::shared_ptr<ModbusClient>> mModbusClients;
+        // watches notifyQueues() signal and mFromModbusSignal of every client
+        int mEpollFd = -1;
+        // clients signalled since last processModbusMessages() call
+        std::vector<ModbusClient*> mReadyClients;
 
         std::vector<std::shared_ptr<ConverterPlugin>> mConverterPlugins;
+        // converters with batch conversion are stateless, a single
+        // instance is created for every converter definition.
+        // Keyed by plugin, converter name and parsed arguments.
+        mutable std::map<std::string, std::shared_ptr<DataConverter>> mSharedConverters;
 
         void initServer(const YAML::Node& config);
         void initBroker(const YAML::Node& config);
@@ -84,7 +93,8 @@ class ModMqtt {
             const std::string& pDefaultNetwork,
             int pDefaultSlave,
             PublishMode pCurrentMode,
-            std::vector<MsgRegisterPollSpecification>& specs
+            std::vector<MsgRegisterPollSpecification>& specs,
+            const RegisterDeadband& pDeadband = RegisterDeadband()
         );
 
         bool parseAndAddRefresh(std::stack<std::chrono::milliseconds>& values, const YAML::Node& data);
@@ -127,6 +137,7 @@ class ModMqtt {
 
         std::vector<modmqttd::MsgRegisterPoll> readModbusPollGroups(const std::string& modbus_network, int default_slave, const YAML::Node& groups);
         void processModbusMessages();
+        void processModbusMessages(ModbusClient& client);
 
         MqttObjectCommand parseObjectCommand(const std::string& pTopicPrefix, int nextCommandId, const YAML::Node& node, const std::string& default_network, int default_slave);
 
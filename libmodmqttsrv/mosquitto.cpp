@@ -26,13 +26,11 @@ static void on_disconnect_wrapper(struct mosquitto *mosq, void *userdata, int rc
 	m->on_disconnect(rc);
 }
 
-/*
 static void on_publish_wrapper(struct mosquitto *mosq, void *userdata, int mid)
 {
 	class Mosquitto *m = (class Mosquitto *)userdata;
 	m->on_publish(mid);
 }
-*/
 
 static void on_message_wrapper(struct mosquitto *mosq, void *userdata, const struct mosquitto_message *message)
 {
@@ -133,7 +131,7 @@ Mosquitto::connect(const MqttBrokerConfig& config) {
         mosquitto_connect_callback_set(mMosq, on_connect_wrapper);
         mosquitto_connect_with_flags_callback_set(mMosq, on_connect_with_flags_wrapper);
         mosquitto_disconnect_callback_set(mMosq, on_disconnect_wrapper);
-        //mosquitto_publish_callback_set(mMosq, on_publish_wrapper);
+        mosquitto_publish_callback_set(mMosq, on_publish_wrapper);
         mosquitto_message_callback_set(mMosq, on_message_wrapper);
         //mosquitto_subscribe_callback_set(mMosq, on_subscribe_wrapper);
         //mosquitto_unsubscribe_callback_set(mMosq, on_unsubscribe_wrapper);
@@ -175,10 +173,11 @@ Mosquitto::subscribe(const char* topic) {
     mosquitto_subscribe(mMosq, &msgId, topic, 0);
 }
 
-void
+bool
 Mosquitto::publish(const char* topic, int len, const void* data, bool retain) {
     int msgId;
-    mosquitto_publish(mMosq, &msgId, topic, len, data, 0, retain);
+    int rc = mosquitto_publish(mMosq, &msgId, topic, len, data, 0, retain);
+    return rc == MOSQ_ERR_SUCCESS;
 }
 
 
@@ -220,6 +219,11 @@ Mosquitto::on_message(const struct mosquitto_message *message) {
     mOwner->onMessage(message->topic, message->payload, message->payloadlen);
 }
 
+void
+Mosquitto::on_publish(int mid) {
+    mOwner->onPublish();
+}
+
 const char*
 Mosquitto::returnCodeToStr(int mosq_errno) {
     // copied from mosquitto.c
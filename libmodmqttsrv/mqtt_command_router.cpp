@@ -0,0 +1,117 @@
+#include "mqtt_command_router.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace modmqttd {
+
+static std::vector<std::string>
+splitTopic(const std::string& pTopic) {
+    std::vector<std::string> ret;
+    std::size_t start = 0;
+    while(true) {
+        std::size_t end = pTopic.find('/', start);
+        if (end == std::string::npos) {
+            ret.push_back(pTopic.substr(start));
+            return ret;
+        }
+        ret.push_back(pTopic.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+static std::string
+joinTopic(const std::vector<std::string>& pLevels) {
+    std::string ret;
+    for(std::size_t i = 0; i < pLevels.size(); i++) {
+        if (i != 0)
+            ret += "/";
+        ret += pLevels[i];
+    }
+    return ret;
+}
+
+static ModbusClient*
+findModbusClient(const std::vector<std::shared_ptr<ModbusClient>>& pClients, const std::string& pNetwork) {
+    std::vector<std::shared_ptr<ModbusClient>>::const_iterator it = std::find_if(
+        pClients.begin(), pClients.end(),
+        [&pNetwork](const std::shared_ptr<ModbusClient>& client) -> bool { return client->mNetworkName == pNetwork; }
+    );
+    return it == pClients.end() ? nullptr : it->get();
+}
+
+void
+MqttCommandRouter::addCommand(const MqttObjectCommand& pCommand, const std::vector<std::shared_ptr<ModbusClient>>& pClients) {
+    RouteMap::iterator it = mRoutes.insert(std::make_pair(pCommand.mTopic, Route(pCommand))).first;
+    it->second.mClient = findModbusClient(pClients, pCommand.mModbusNetworkName);
+}
+
+void
+MqttCommandRouter::setModbusClients(const std::vector<std::shared_ptr<ModbusClient>>& pClients) {
+    for(auto& route: mRoutes)
+        route.second.mClient = findModbusClient(pClients, route.second.mCommand.mModbusNetworkName);
+}
+
+const MqttCommandRouter::Route*
+MqttCommandRouter::find(const char* pTopic) const {
+    RouteMap::const_iterator it = mRoutes.find(pTopic);
+    if (it == mRoutes.end())
+        return nullptr;
+    return &(it->second);
+}
+
+std::vector<std::string>
+MqttCommandRouter::createSubscriptions(const std::vector<std::string>& pPublishedTopics) const {
+    // (number of levels, last level) -> topics
+    std::map<std::pair<std::size_t, std::string>, std::vector<std::vector<std::string>>> groups;
+    for(const auto& route: mRoutes) {
+        std::vector<std::string> levels(splitTopic(route.first));
+        groups[std::make_pair(levels.size(), levels.back())].push_back(levels);
+    }
+
+    std::vector<std::string> ret;
+    for(const auto& group: groups) {
+        const std::vector<std::vector<std::string>>& topics(group.second);
+
+        std::vector<std::string> filterLevels(topics.front());
+        for(const std::vector<std::string>& levels: topics) {
+            for(std::size_t i = 0; i < levels.size(); i++) {
+                if (filterLevels[i] != levels[i])
+                    filterLevels[i] = "+";
+            }
+        }
+
+        std::string filter(joinTopic(filterLevels));
+
+        bool conflicts = topics.size() > 1 && std::any_of(
+            pPublishedTopics.begin(), pPublishedTopics.end(),
+            [&filter](const std::string& topic) -> bool { return topicMatches(filter, topic); }
+        );
+
+        if (!conflicts) {
+            ret.push_back(filter);
+        } else {
+            for(const std::vector<std::string>& levels: topics)
+                ret.push_back(joinTopic(levels));
+        }
+    }
+    return ret;
+}
+
+bool
+MqttCommandRouter::topicMatches(const std::string& pFilter, const std::string& pTopic) {
+    std::vector<std::string> filter(splitTopic(pFilter));
+    std::vector<std::string> topic(splitTopic(pTopic));
+
+    for(std::size_t i = 0; i < filter.size(); i++) {
+        if (filter[i] == "#")
+            return true;
+        if (i == topic.size())
+            return false;
+        if (filter[i] != "+" && filter[i] != topic[i])
+            return false;
+    }
+    return filter.size() == topic.size();
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mqttcommand.hpp"
+#include "modbus_client.hpp"
+
+namespace modmqttd {
+
+/**
+ * Maps command topics to commands and modbus clients
+ * that execute them.
+ *
+ * Modbus client for every command is resolved once after
+ * configuration, so incoming messages do not search for
+ * modbus network by name.
+ *
+ * Command topics with the same number of levels and the same
+ * last level are subscribed with a single topic filter with '+' on
+ * levels that differ, i.e. "room1/light/set" and "room2/light/set"
+ * are subscribed as "+/light/set".
+ * */
+class MqttCommandRouter {
+    public:
+        struct Route {
+            Route(const MqttObjectCommand& pCommand) : mCommand(pCommand) {}
+            MqttObjectCommand mCommand;
+            // nullptr if command modbus network is not defined
+            ModbusClient* mClient = nullptr;
+        };
+        typedef std::unordered_map<std::string, Route> RouteMap;
+
+        void addCommand(const MqttObjectCommand& pCommand, const std::vector<std::shared_ptr<ModbusClient>>& pClients);
+        // resolve modbus client of every command again
+        void setModbusClients(const std::vector<std::shared_ptr<ModbusClient>>& pClients);
+
+        // returns nullptr if there is no command for topic
+        const Route* find(const char* pTopic) const;
+        const RouteMap& getRoutes() const { return mRoutes; }
+
+        /**
+         * Create topic filters for all command topics. Filter with wildcard
+         * is not used if it matches any of pPublishedTopics, to not receive
+         * our own state and availability messages.
+         * */
+        std::vector<std::string> createSubscriptions(const std::vector<std::string>& pPublishedTopics) const;
+
+        // MQTT topic filter matching with '+' and '#' wildcards
+        static bool topicMatches(const std::string& pFilter, const std::string& pTopic);
+    private:
+        RouteMap mRoutes;
+};
+
+}
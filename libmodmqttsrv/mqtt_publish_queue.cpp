@@ -0,0 +1,112 @@
+#include "mqtt_publish_queue.hpp"
+
+namespace modmqttd {
+
+bool
+MqttPublishQueue::hasPending() const {
+    return !mPendingIndex.empty();
+}
+
+void
+MqttPublishQueue::publish(const std::string& pTopic, int pLen, const void* pData, bool pRetain, Priority pPriority) {
+    // flush() in other thread could send older payload for pTopic
+    // after checks below, wait until it is done
+    std::lock_guard<std::recursive_mutex> sendLock(mSendMutex);
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!hasPending() && canSend()) {
+            mInFlight++;
+        } else {
+            std::string payload(static_cast<const char*>(pData), pLen);
+            auto key = std::make_pair(pTopic, pRetain);
+            auto it = mPendingIndex.find(key);
+            if (it != mPendingIndex.end()) {
+                it->second->mPayload.swap(payload);
+                mReplacedCount++;
+            } else {
+                std::list<Entry>& pending(mPending[pPriority]);
+                pending.push_back(Entry{pTopic, std::move(payload), pRetain});
+                mPendingIndex[key] = std::prev(pending.end());
+            }
+            lock.unlock();
+            // in-flight message could be confirmed after
+            // hasPending() and canSend() check above
+            flush();
+            return;
+        }
+    }
+    send(pTopic.c_str(), pLen, pData, pRetain);
+}
+
+void
+MqttPublishQueue::send(const char* pTopic, int pLen, const void* pData, bool pRetain) {
+    // message is dropped or sent synchronously,
+    // onPublished() will not be called for it
+    if (!mImpl->publish(pTopic, pLen, pData, pRetain)) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mInFlight > 0)
+            mInFlight--;
+    }
+}
+
+void
+MqttPublishQueue::flush() {
+    std::lock_guard<std::recursive_mutex> sendLock(mSendMutex);
+    while(true) {
+        Entry entry;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (!hasPending() || !canSend())
+                return;
+
+            std::list<Entry>* pending = mPending;
+            while(pending->empty())
+                pending++;
+
+            entry = std::move(pending->front());
+            pending->pop_front();
+            mPendingIndex.erase(std::make_pair(entry.mTopic, entry.mRetain));
+            mInFlight++;
+        }
+        send(entry.mTopic.c_str(), entry.mPayload.length(), entry.mPayload.c_str(), entry.mRetain);
+    }
+}
+
+void
+MqttPublishQueue::onPublished() {
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mInFlight > 0)
+            mInFlight--;
+    }
+    flush();
+}
+
+void
+MqttPublishQueue::clear() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    for(int i = 0; i < PRIORITY_COUNT; i++)
+        mPending[i].clear();
+    mPendingIndex.clear();
+    mInFlight = 0;
+}
+
+int
+MqttPublishQueue::getInFlightCount() const {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mInFlight;
+}
+
+std::size_t
+MqttPublishQueue::getPendingCount() const {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mPendingIndex.size();
+}
+
+uint64_t
+MqttPublishQueue::getReplacedCount() const {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mReplacedCount;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "imqttimpl.hpp"
+
+namespace modmqttd {
+
+/**
+ * Outbound stage between MqttClient and IMqttImpl.
+ *
+ * Messages are passed to IMqttImpl directly until the number
+ * of messages sent but not confirmed by onPublished() reaches
+ * the in-flight limit. Then messages wait in the queue, where
+ * a new payload for the same topic replaces the pending one,
+ * so the queue holds at most one message per topic and
+ * a slow broker gets the latest data only.
+ *
+ * Pending availability messages are sent before state messages.
+ *
+ * publish() is called from modmqttd main thread and from
+ * MqttClient::onConnect(), onPublished() from mqtt library thread.
+ * Messages are passed to IMqttImpl by one thread at a time, so
+ * a pending payload cannot be sent after a newer one for the same topic.
+ * */
+class MqttPublishQueue {
+    public:
+        // in flush order
+        enum Priority {
+            AVAILABILITY = 0,
+            STATE = 1
+        };
+
+        void setMqttImplementation(const std::shared_ptr<IMqttImpl>& pImpl) { mImpl = pImpl; }
+        // 0 means no limit
+        void setMaxInFlight(int pCount) { mMaxInFlight = pCount; }
+
+        void publish(const std::string& pTopic, int pLen, const void* pData, bool pRetain, Priority pPriority);
+        // called by mqtt library when message was sent
+        void onPublished();
+        // drops pending messages and resets in-flight counter
+        // after broker connection is lost
+        void clear();
+
+        int getInFlightCount() const;
+        std::size_t getPendingCount() const;
+        // number of pending messages replaced by a newer payload
+        uint64_t getReplacedCount() const;
+    private:
+        struct Entry {
+            std::string mTopic;
+            std::string mPayload;
+            bool mRetain;
+        };
+        static const int PRIORITY_COUNT = 2;
+
+        std::shared_ptr<IMqttImpl> mImpl;
+        mutable std::mutex mMutex;
+        // held while a message is taken from queue and sent,
+        // always locked before mMutex. Recursive because mqtt
+        // library could call onPublished() from IMqttImpl::publish()
+        std::recursive_mutex mSendMutex;
+        std::list<Entry> mPending[PRIORITY_COUNT];
+        // pending message for topic and retain flag, retained
+        // and not retained messages for the same topic are not merged
+        std::map<std::pair<std::string, bool>, std::list<Entry>::iterator> mPendingIndex;
+        int mMaxInFlight = 0;
+        int mInFlight = 0;
+        uint64_t mReplacedCount = 0;
+
+        bool hasPending() const;
+        bool canSend() const { return mMaxInFlight == 0 || mInFlight < mMaxInFlight; }
+        void send(const char* pTopic, int pLen, const void* pData, bool pRetain);
+        void flush();
+};
+
+}
@@ -1,6 +1,8 @@
 #include <cstring>
 #include <cassert>
 #include <map>
+#include <set>
+#include <algorithm>
 
 #include "common.hpp"
 #include "mqttclient.hpp"
@@ -15,6 +17,7 @@ boost::log::sources::severity_logger<Log::severity> MqttClient::log;
 
 MqttClient::MqttClient(ModMqtt& modmqttd) : mOwner(modmqttd) {
     mMqttImpl.reset(new Mosquitto());
+    mPublishQueue.setMqttImplementation(mMqttImpl);
 };
 
 void
@@ -22,6 +25,7 @@ MqttClient::setBrokerConfig(const MqttBrokerConfig& config) {
     if (!mBrokerConfig.isSameAs(config)) {
 		//TODO reconnect
         mBrokerConfig = config;
+        mPublishQueue.setMaxInFlight(mBrokerConfig.mMaxInFlight);
     }
 };
 
@@ -50,6 +54,10 @@ MqttClient::shutdown() {
     //are already stopped
     mModbusClients.clear();
 
+    uint64_t replaced = mPublishQueue.getReplacedCount();
+    if (replaced > 0)
+        BOOST_LOG_SEV(log, Log::info) << replaced << " queued mqtt messages were replaced by newer payload";
+
     switch(mConnectionState) {
         case State::CONNECTED:
             BOOST_LOG_SEV(log, Log::info) << "Disconnecting from mqtt broker";
@@ -75,6 +83,8 @@ MqttClient::onDisconnect() {
     for(std::vector<std::shared_ptr<ModbusClient>>::iterator it = mModbusClients.begin(); it != mModbusClients.end(); it++) {
         (*it)->sendMqttNetworkIsUp(false);
     }
+    // all data is republished in onConnect()
+    mPublishQueue.clear();
     switch(mConnectionState) {
         case State::CONNECTED:
         case State::CONNECTING:
@@ -89,7 +99,7 @@ MqttClient::onDisconnect() {
             mMqttImpl->stop();
 #endif
             mIsStarted = false;
-            // signal modmqttd that is waiting on queues mutex
+            // signal modmqttd main loop that is waiting
             // for us to disconnect
             modmqttd::notifyQueues();
     };
@@ -99,8 +109,8 @@ void
 MqttClient::onConnect() {
 	BOOST_LOG_SEV(log, Log::info) << "Mqtt connected, sending subscriptions…";
 
-    for(auto cmd: mCommands) {
-        mMqttImpl->subscribe(cmd.second.mTopic.c_str());
+    for(const std::string& filter: mCommandSubscriptions) {
+        mMqttImpl->subscribe(filter.c_str());
     }
 
     mConnectionState = State::CONNECTED;
@@ -112,6 +122,8 @@ MqttClient::onConnect() {
     // all subscribed clients
     publishAll();
 
+    // modbus data changes are published while
+    // remaining objects are republished
     for(std::vector<std::shared_ptr<ModbusClient>>::iterator it = mModbusClients.begin(); it != mModbusClients.end(); it++) {
         (*it)->sendMqttNetworkIsUp(true);
     }
@@ -119,6 +131,40 @@ MqttClient::onConnect() {
 	BOOST_LOG_SEV(log, Log::info) << "Mqtt ready to process messages";
 }
 
+void
+MqttClient::setObjects(const MqttPollObjMap& pObjects) {
+    mObjects = pObjects;
+    mDispatchIndex.build(mObjects);
+    mOldAvailFlags.resize(mDispatchIndex.getMaxObjectsInGroup());
+    mChangedFlags.resize(mDispatchIndex.getMaxObjectsInGroup());
+
+    // do not subscribe to wildcard topic
+    // that matches our state or availability topic
+    std::vector<std::string> publishedTopics;
+    for(MqttPollObjMap::iterator it = mObjects.begin(); it != mObjects.end(); it++) {
+        for(const std::shared_ptr<MqttObject>& obj: it->second) {
+            publishedTopics.push_back(obj->getStateTopic());
+            publishedTopics.push_back(obj->getAvailabilityTopic());
+        }
+    }
+    mCommandSubscriptions = mCommandRouter.createSubscriptions(publishedTopics);
+
+    // object can be a member of multiple poll groups
+    std::set<MqttObject*> known;
+    mAllObjects.clear();
+    mAggregateObjects.clear();
+    for(MqttPollObjMap::iterator it = mObjects.begin(); it != mObjects.end(); it++) {
+        for(const std::shared_ptr<MqttObject>& obj: it->second) {
+            if (!known.insert(obj.get()).second)
+                continue;
+            mAllObjects.push_back(obj.get());
+            if (obj->getPublishMode() == PublishMode::AGGREGATE)
+                mAggregateObjects.push_back(obj.get());
+        }
+    }
+    mPublishAllCursor = mAllObjects.size();
+}
+
 void
 MqttClient::processRegisterValues(const std::string& pModbusNetworkName, const MsgRegisterValues& pSlaveData) {
     if (!isConnected()) {
@@ -129,55 +175,149 @@ MqttClient::processRegisterValues(const std::string& pModbusNetworkName, const M
         return;
     }
 
-    std::vector<std::shared_ptr<MqttObject>>* affectedObjects = nullptr;
-
+    int networkId = StringPool::networkNames().find(pModbusNetworkName);
     if (pSlaveData.hasCommandId()) {
         MqttCmdObjMap::iterator it = mCommandObjects.find(pSlaveData.getCommandId());
-        if (it != mCommandObjects.end())
-            affectedObjects = &(it->second);
+        // possible if write command registers do not overlap with
+        // any MqttObject
+        if (it == mCommandObjects.end()) {
+            BOOST_LOG_SEV(log, Log::trace) << "No affected objects for received register values";
+            return;
+        }
+        updateObjects(networkId, pSlaveData, it->second);
     } else {
-        MqttObjectRegisterIdent ident(pModbusNetworkName, pSlaveData);
-        MqttPollObjMap::iterator it = mObjects.find(ident);
-        assert(it != mObjects.end());
-        affectedObjects = &(it->second);
+        const RegisterDispatchIndex::Group* group = mDispatchIndex.findGroup(networkId, pSlaveData);
+        if (group != nullptr) {
+            dispatchRegisterValues(*group, pSlaveData);
+            return;
+        }
+        // values do not start at the first register of a poll group,
+        // search all objects with registers in the received range
+        BOOST_LOG_SEV(log, Log::debug) << "No poll group starts at " << pSlaveData.mSlaveId << "." << pSlaveData.mRegister
+            << ", updating objects by register range";
+        std::vector<std::shared_ptr<MqttObject>> affected;
+        for(MqttPollObjMap::iterator it = mObjects.begin(); it != mObjects.end(); it++) {
+            for(const std::shared_ptr<MqttObject>& obj: it->second) {
+                if (obj->hasRegisterIn(networkId, pSlaveData) && std::find(affected.begin(), affected.end(), obj) == affected.end())
+                    affected.push_back(obj);
+            }
+        }
+        updateObjects(networkId, pSlaveData, affected);
     }
+}
 
-    // possible if write command registers do not overlap with
-    // any MqttObject
-    if (affectedObjects == nullptr) {
-    	BOOST_LOG_SEV(log, Log::trace) << "No affected objects for received register values";
-        return;
+void
+MqttClient::updateObjects(int pNetworkId, const MsgRegisterValues& pSlaveData, std::vector<std::shared_ptr<MqttObject>>& pObjects) {
+    for (std::shared_ptr<MqttObject>& obj: pObjects) {
+        AvailableFlag oldAvail = obj->getAvailableFlag();
+        obj->updateRegisterValues(pNetworkId, pSlaveData);
+        publishObjectUpdate(*obj, oldAvail);
     }
+}
 
-    for (std::shared_ptr<MqttObject>& obj: *affectedObjects) {
-        AvailableFlag oldAvail = obj->getAvailableFlag();
-        obj->updateRegisterValues(pModbusNetworkName, pSlaveData);
-        AvailableFlag newAvail = obj->getAvailableFlag();
+void
+MqttClient::dispatchRegisterValues(const RegisterDispatchIndex::Group& pGroup, const MsgRegisterValues& pSlaveData) {
+    const std::vector<std::shared_ptr<MqttObject>>& objects(*pGroup.mObjects);
+    for(std::size_t i = 0; i < objects.size(); i++) {
+        mOldAvailFlags[i] = objects[i]->getAvailableFlag();
+        mChangedFlags[i] = false;
+    }
 
-        if (oldAvail != newAvail) {
-            if (newAvail == AvailableFlag::True) {
-                // if object is not retained
-                // then publish state changes only
-                // if availability is already set to true
-                if (obj->getRetain()) {
-                    publishState(*obj, true);
-                } else {
-                    // delete retained message
-                    if (oldAvail == AvailableFlag::NotSet) {
-                        mMqttImpl->publish(obj->getStateTopic().c_str(), 0, NULL, true);
-                        // remember initial payload for comparsion with subsequent modbus data updates
-                        if (!obj->getRetain())
-                            obj->setLastPublishedPayload(MqttPayload::generate(*obj));
-                    }
-                    if (obj->getPublishMode() == PublishMode::EVERY_POLL)
-                        publishState(*obj, true);
+    for(std::size_t i = pGroup.mFirstSlot; i < pGroup.mFirstSlot + pGroup.mSlotCount; i++) {
+        const RegisterDispatchIndex::Slot& slot(mDispatchIndex.getSlot(i));
+        if (slot.mOffset >= pSlaveData.mCount)
+            continue;
+        if (slot.mNode->setScalarValue(pSlaveData.mRegisters.getValue(slot.mOffset)))
+            mChangedFlags[slot.mObjectIndex] = true;
+    }
+
+    convertBatches(pGroup, pSlaveData);
+
+    for(std::size_t i = 0; i < objects.size(); i++) {
+        objects[i]->valuesUpdated(mChangedFlags[i]);
+        publishObjectUpdate(*objects[i], mOldAvailFlags[i]);
+    }
+}
+
+void
+MqttClient::convertBatches(const RegisterDispatchIndex::Group& pGroup, const MsgRegisterValues& pSlaveData) {
+    const std::vector<uint16_t>& registers(pSlaveData.mRegisters.values());
+    for(std::size_t b = pGroup.mFirstBatch; b < pGroup.mFirstBatch + pGroup.mBatchCount; b++) {
+        const RegisterDispatchIndex::Batch& batch(mDispatchIndex.getBatch(b));
+
+        // convert changed nodes only, values of other nodes
+        // are cached as json
+        mBatchNodes.clear();
+        mBatchSlots.clear();
+        for(std::size_t i = batch.mFirstNode; i < batch.mFirstNode + batch.mNodeCount; i++) {
+            const RegisterDispatchIndex::BatchNode& bnode(mDispatchIndex.getBatchNode(i));
+            if (bnode.mSlot.mOffset + bnode.mSlot.mCount > registers.size())
+                continue;
+            if (!bnode.mNode->isChanged())
+                continue;
+            bnode.mNode->setBatchValue(nullptr);
+            mBatchNodes.push_back(i);
+            mBatchSlots.push_back(bnode.mSlot);
+        }
+
+        if (mBatchNodes.empty())
+            continue;
+
+        mBatchValues.resize(mBatchNodes.size());
+        try {
+            batch.mConverter->toMqttBatch(registers, mBatchSlots, std::span<MqttValue>(mBatchValues.data(), mBatchNodes.size()));
+        } catch (const std::exception& ex) {
+            // error is reported when node value
+            // is converted by getConvertedValue()
+            BOOST_LOG_SEV(log, Log::trace) << "Batch conversion failed: " << ex.what();
+            continue;
+        }
+
+        for(std::size_t i = 0; i < mBatchNodes.size(); i++) {
+            MqttValue& value(mDispatchIndex.getBatchValue(mBatchNodes[i]));
+            value = std::move(mBatchValues[i]);
+            mDispatchIndex.getBatchNode(mBatchNodes[i]).mNode->setBatchValue(&value);
+        }
+    }
+}
+
+void
+MqttClient::publishObjectUpdate(MqttObject& obj, AvailableFlag oldAvail) {
+    AvailableFlag newAvail = obj.getAvailableFlag();
+
+    if (obj.getPublishMode() == PublishMode::AGGREGATE) {
+        // state is published by publishDelayedStates()
+        // at the end of aggregation window
+        if (newAvail == AvailableFlag::True)
+            obj.aggregateState();
+        if (oldAvail != newAvail)
+            publishAvailabilityChange(obj);
+        return;
+    }
+
+    if (oldAvail != newAvail) {
+        if (newAvail == AvailableFlag::True) {
+            // if object is not retained
+            // then publish state changes only
+            // if availability is already set to true
+            if (obj.getRetain()) {
+                publishState(obj, true);
+            } else {
+                // delete retained message
+                if (oldAvail == AvailableFlag::NotSet) {
+                    mPublishQueue.publish(obj.getStateTopic(), 0, NULL, true, MqttPublishQueue::STATE);
+                    // remember initial payload for comparsion with subsequent modbus data updates
+                    if (!obj.getRetain())
+                        obj.setLastPublishedPayload(MqttPayload::generate(obj));
                 }
+                if (obj.getPublishMode() == PublishMode::EVERY_POLL)
+                    publishState(obj, true);
             }
-
-            publishAvailabilityChange(*obj);
-        } else {
-            publishState(*obj, obj->needStateRepublish());
         }
+
+        publishAvailabilityChange(obj);
+    } else {
+        publishState(obj, obj.needStateRepublish());
     }
 }
 
@@ -185,14 +325,111 @@ void
 MqttClient::publishState(MqttObject& obj, bool force) {
     if (obj.getAvailableFlag() != AvailableFlag::True)
         return;
+    if (obj.getPublishMode() == PublishMode::AGGREGATE) {
+        // republish the last aggregated state
+        if (force && !obj.getLastPublishedPayload().empty()) {
+            const std::string& messageData(obj.getLastPublishedPayload());
+            mPublishQueue.publish(obj.getStateTopic(), messageData.length(), messageData.c_str(), obj.getRetain(), MqttPublishQueue::STATE);
+        }
+        return;
+    }
+    // payload would be the same as last published one
+    if (!force && !obj.isStateChanged())
+        return;
+    if (!force && delayStatePublish(obj))
+        return;
     std::string messageData(MqttPayload::generate(obj));
     if (messageData != obj.getLastPublishedPayload() || force) {
         BOOST_LOG_SEV(log, Log::debug) << "Publish on topic " << obj.getStateTopic() << ": " << messageData;
-        mMqttImpl->publish(obj.getStateTopic().c_str(), messageData.length(), messageData.c_str(), obj.getRetain());
+        mPublishQueue.publish(obj.getStateTopic(), messageData.length(), messageData.c_str(), obj.getRetain(), MqttPublishQueue::STATE);
         obj.setLastPublishedPayload(messageData);
     }
 }
 
+bool
+MqttClient::delayStatePublish(MqttObject& obj) {
+    // every_poll mode has its own publish period
+    if (obj.getPublishMode() != PublishMode::ON_CHANGE || obj.getMinPublishInterval() == std::chrono::milliseconds::zero())
+        return false;
+
+    if (obj.getNextPublishTime() <= std::chrono::steady_clock::now())
+        return false;
+
+    if (!obj.isPublishDelayed()) {
+        obj.setPublishDelayed(true);
+        mDelayedObjects.push_back(&obj);
+    }
+    return true;
+}
+
+void
+MqttClient::publishDelayedStates() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    continuePublishAll(now);
+    publishAggregates(now);
+
+    if (mDelayedObjects.empty())
+        return;
+
+    std::vector<MqttObject*>::iterator ready = std::partition(
+        mDelayedObjects.begin(), mDelayedObjects.end(),
+        [&now](const MqttObject* obj) -> bool { return obj->getNextPublishTime() > now; }
+    );
+    std::vector<MqttObject*> toPublish(ready, mDelayedObjects.end());
+    mDelayedObjects.erase(ready, mDelayedObjects.end());
+
+    for(MqttObject* obj: toPublish) {
+        obj->setPublishDelayed(false);
+        // latest state or nothing if state was already
+        // published by availability change
+        publishState(*obj);
+    }
+}
+
+void
+MqttClient::publishAggregates(const std::chrono::steady_clock::time_point& pNow) {
+    for(MqttObject* obj: mAggregateObjects) {
+        if (!obj->hasAggregatedValues() || obj->getAggregateWindowEnd() > pNow)
+            continue;
+
+        if (obj->getAvailableFlag() == AvailableFlag::True) {
+            std::string messageData(MqttPayload::generateAggregate(*obj));
+            BOOST_LOG_SEV(log, Log::debug) << "Publish on topic " << obj->getStateTopic() << ": " << messageData;
+            mPublishQueue.publish(obj->getStateTopic(), messageData.length(), messageData.c_str(), obj->getRetain(), MqttPublishQueue::STATE);
+            obj->setLastPublishedPayload(messageData);
+        }
+        obj->startNextAggregateWindow();
+    }
+}
+
+int
+MqttClient::getDelayedPublishTimeout() const {
+    if (mPublishAllRequested)
+        return 0;
+
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::time_point::max();
+    if (mPublishAllCursor < mAllObjects.size()) {
+        if (mBrokerConfig.mRepublishRate == 0)
+            return 0;
+        next = mPublishAllStart + std::chrono::microseconds(mPublishAllCursor * 1000000 / mBrokerConfig.mRepublishRate);
+    }
+    for(const MqttObject* obj: mDelayedObjects)
+        next = std::min(next, obj->getNextPublishTime());
+    for(const MqttObject* obj: mAggregateObjects) {
+        if (obj->hasAggregatedValues())
+            next = std::min(next, obj->getAggregateWindowEnd());
+    }
+
+    if (next == std::chrono::steady_clock::time_point::max())
+        return -1;
+
+    std::chrono::steady_clock::duration left = next - std::chrono::steady_clock::now();
+    if (left <= std::chrono::steady_clock::duration::zero())
+        return 0;
+    // round up to not wake up before publish time
+    return std::chrono::ceil<std::chrono::milliseconds>(left).count();
+}
+
 void
 MqttClient::processRegistersOperationFailed(const std::string& pModbusNetworkName, const ModbusSlaveAddressRange& pSlaveData) {
     MqttObjectRegisterIdent ident(pModbusNetworkName, pSlaveData);
@@ -205,7 +442,7 @@ MqttClient::processRegistersOperationFailed(const std::string& pModbusNetworkNam
 
     for (std::shared_ptr<MqttObject>& obj: it->second) {
         AvailableFlag oldAvail = obj->getAvailableFlag();
-        obj->updateRegistersReadFailed(pModbusNetworkName, pSlaveData);
+        obj->updateRegistersReadFailed(ident.mNetworkId, pSlaveData);
         AvailableFlag newAvail = obj->getAvailableFlag();
 
         publishState(*obj);
@@ -219,10 +456,11 @@ MqttClient::processRegistersOperationFailed(const std::string& pModbusNetworkNam
 void
 MqttClient::processModbusNetworkState(const std::string& pNetworkName, bool pIsUp) {
     std::set<std::shared_ptr<MqttObject>> processed;
+    int networkId = StringPool::networkNames().find(pNetworkName);
 
     for(MqttPollObjMap::iterator it = mObjects.begin(); it != mObjects.end(); it++)
     {
-        if (it->first.mNetworkName != pNetworkName)
+        if (it->first.mNetworkId != networkId)
             continue;
 
         for (std::vector<std::shared_ptr<MqttObject>>::iterator oit = it->second.begin(); oit != it->second.end(); oit++) {
@@ -230,7 +468,7 @@ MqttClient::processModbusNetworkState(const std::string& pNetworkName, bool pIsU
             if (processed.find(optr) == processed.end()) {
 
                 AvailableFlag oldAvail = (*oit)->getAvailableFlag();
-                (*oit)->setModbusNetworkState(pNetworkName, pIsUp);
+                (*oit)->setModbusNetworkState(networkId, pIsUp);
                 if (oldAvail != (*oit)->getAvailableFlag())
                     publishAvailabilityChange(**oit);
                 processed.insert(optr);
@@ -244,25 +482,50 @@ MqttClient::publishAvailabilityChange(const MqttObject& obj) {
     if (obj.getAvailableFlag() == AvailableFlag::NotSet)
         return;
     char msg = obj.getAvailableFlag() == AvailableFlag::True ? '1' : '0';
-    int msgId;
-    mMqttImpl->publish(obj.getAvailabilityTopic().c_str(), 1, &msg, true);
+    mPublishQueue.publish(obj.getAvailabilityTopic(), 1, &msg, true, MqttPublishQueue::AVAILABILITY);
 }
 
 void
 MqttClient::publishAll() {
-    std::set<std::shared_ptr<MqttObject>> published;
+    mPublishAllRequested = true;
+    // wake up main loop
+    modmqttd::notifyQueues();
+}
 
-    for(MqttPollObjMap::iterator it = mObjects.begin(); it != mObjects.end(); it++)
-    {
-        for (std::vector<std::shared_ptr<MqttObject>>::iterator oit = it->second.begin(); oit != it->second.end(); oit++) {
-            const std::shared_ptr<MqttObject>& optr = *oit;
-            if (published.find(optr) == published.end()) {
-                if ((*oit)->getAvailableFlag() == AvailableFlag::True)
-                    publishState(**oit, true);
-                publishAvailabilityChange(**oit);
-                published.insert(*oit);
-            }
-        }
+void
+MqttClient::continuePublishAll(const std::chrono::steady_clock::time_point& pNow) {
+    if (mPublishAllRequested.exchange(false)) {
+        mPublishAllCursor = 0;
+        mPublishAllStart = pNow;
+        BOOST_LOG_SEV(log, Log::debug) << "Republishing " << mAllObjects.size() << " objects";
+    }
+
+    if (mPublishAllCursor >= mAllObjects.size())
+        return;
+
+    if (!isConnected()) {
+        // publishAll() is called again after reconnect
+        mPublishAllCursor = mAllObjects.size();
+        return;
+    }
+
+    std::size_t end = mAllObjects.size();
+    if (mBrokerConfig.mRepublishRate > 0) {
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(pNow - mPublishAllStart).count();
+        std::size_t allowed = elapsed * mBrokerConfig.mRepublishRate / 1000000 + 1;
+        end = std::min(end, allowed);
+    }
+
+    for(; mPublishAllCursor < end; mPublishAllCursor++) {
+        MqttObject& obj(*mAllObjects[mPublishAllCursor]);
+        if (obj.getAvailableFlag() == AvailableFlag::True)
+            publishState(obj, true);
+        publishAvailabilityChange(obj);
+    }
+
+    if (mPublishAllCursor == mAllObjects.size()) {
+        BOOST_LOG_SEV(log, Log::info) << "Republished " << mAllObjects.size() << " objects in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mPublishAllStart).count() << "ms";
     }
 }
 
@@ -284,16 +547,11 @@ createMqttValue(const MqttObjectCommand& command, const void* data, int datalen)
 void
 MqttClient::onMessage(const char* topic, const void* payload, int payloadlen) {
     try {
-        const MqttObjectCommand& command = findCommand(topic);
-        const std::string network = command.mModbusNetworkName;
-
-        //TODO is is thread safe to iterate on modbus clients from mosquitto callback?
-        std::vector<std::shared_ptr<ModbusClient>>::const_iterator it = std::find_if(
-            mModbusClients.begin(), mModbusClients.end(),
-            [&network](const std::shared_ptr<ModbusClient>& client) -> bool { return client->mNetworkName == network; }
-        );
-        if (it == mModbusClients.end()) {
-            BOOST_LOG_SEV(log, Log::error) << "Modbus network " << network << " not found for command  " << topic << ", dropping message";
+        const MqttCommandRouter::Route& route = findCommand(topic);
+        const MqttObjectCommand& command(route.mCommand);
+
+        if (route.mClient == nullptr) {
+            BOOST_LOG_SEV(log, Log::error) << "Modbus network " << command.mModbusNetworkName << " not found for command  " << topic << ", dropping message";
         } else {
             MqttValue tmpval(createMqttValue(command, payload, payloadlen));
 
@@ -308,28 +566,36 @@ MqttClient::onMessage(const char* topic, const void* payload, int payloadlen) {
             if (reg_values.getCount() != command.mCount)
                 throw MqttPayloadConversionException(std::string("Conversion failed, expecting ") + std::to_string(command.mCount) + " register values, got " + std::to_string(reg_values.getCount()));
 
-            (*it)->sendCommand(command, reg_values);
+            route.mClient->sendCommand(command, reg_values);
         }
     } catch (const ConvException& ex) {
         BOOST_LOG_SEV(log, Log::error) << "Converter error for " << topic << ":" << ex.what();
     } catch (const MqttPayloadConversionException& ex) {
         BOOST_LOG_SEV(log, Log::error) << "Value error for " << topic << ":" << ex.what();
     } catch (const ObjectCommandNotFoundException&) {
-        BOOST_LOG_SEV(log, Log::error) << "No command for topic " << topic << ", dropping message";
+        // possible if wildcard subscription matches topic
+        // that is not used by any command
+        BOOST_LOG_SEV(log, Log::debug) << "No command for topic " << topic << ", dropping message";
     }
 }
 
+void
+MqttClient::setModbusClients(const std::vector<std::shared_ptr<ModbusClient>>& clients) {
+    mModbusClients = clients;
+    mCommandRouter.setModbusClients(mModbusClients);
+}
+
 void
 MqttClient::addCommand(const MqttObjectCommand& pCommand) {
-    mCommands.insert(std::pair<std::string, MqttObjectCommand>(pCommand.mTopic, pCommand));
+    mCommandRouter.addCommand(pCommand, mModbusClients);
 }
 
 
-const MqttObjectCommand&
+const MqttCommandRouter::Route&
 MqttClient::findCommand(const char* topic) const {
-    auto cmd = mCommands.find(topic);
-    if (cmd != mCommands.end())
-        return cmd->second;
+    const MqttCommandRouter::Route* route = mCommandRouter.find(topic);
+    if (route != nullptr)
+        return *route;
     throw ObjectCommandNotFoundException(topic);
 }
 
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <atomic>
+
 #include "config.hpp"
 #include "common.hpp"
 #include "mqttobject.hpp"
 #include "modbus_client.hpp"
 #include "imqttimpl.hpp"
+#include "mqtt_publish_queue.hpp"
+#include "mqtt_command_router.hpp"
 #include "default_command_converter.hpp"
+#include "register_dispatch_index.hpp"
 
 namespace modmqttd {
 
@@ -13,7 +18,7 @@ class ModMqtt;
 
 class MqttClient {
     public:
-        typedef std::map<MqttObjectRegisterIdent, std::vector<std::shared_ptr<MqttObject>>, MqttObjectRegisterIdent::Compare> MqttPollObjMap;
+        typedef RegisterDispatchIndex::ObjectMap MqttPollObjMap;
         typedef std::map<int, std::vector<std::shared_ptr<MqttObject>>> MqttCmdObjMap;
 
         enum State {
@@ -26,22 +31,29 @@ class MqttClient {
         MqttClient(ModMqtt& modmqttd);
         void setClientId(const std::string& clientId);
         void setBrokerConfig(const MqttBrokerConfig& config);
-        void setModbusClients(const std::vector<std::shared_ptr<ModbusClient>>& clients) { mModbusClients = clients; }
+        void setModbusClients(const std::vector<std::shared_ptr<ModbusClient>>& clients);
         void start() ;//TODO throw(MosquittoException) - deprecated?;
         bool isStarted() { return mIsStarted; }
         void shutdown();
         bool isConnected() const { return mConnectionState == State::CONNECTED; }
         void reconnect() { mMqttImpl->reconnect(); }
-        void setObjects(const MqttPollObjMap& pObjects) { mObjects = pObjects; };
+        void setObjects(const MqttPollObjMap& pObjects);
         void setCommandObjects(const MqttCmdObjMap& pCmdObjects) { mCommandObjects = pCmdObjects; }
 
         void addCommand(const MqttObjectCommand& pCommand);
-        const std::map<std::string, MqttObjectCommand>& getCommands() const { return mCommands; }
+        const MqttCommandRouter::RouteMap& getCommands() const { return mCommandRouter.getRoutes(); }
 
-        //publish all data after broker is reconnected
+        //publish all data after broker is reconnected.
+        //Objects are published from main loop by publishDelayedStates()
         void publishAll();
         void publishState(MqttObject& obj, bool force=false);
         void publishAvailabilityChange(const MqttObject& obj);
+        // publish state of objects delayed by min_publish_interval,
+        // aggregated state of objects with expired aggregation window
+        // and next objects requested by publishAll()
+        void publishDelayedStates();
+        // milliseconds to the next delayed state publish, -1 if there is none
+        int getDelayedPublishTimeout() const;
 
         void processRegisterValues(const std::string& modbusNetworkName, const MsgRegisterValues& values);
         void processRegistersOperationFailed(const std::string& modbusNetworkName, const ModbusSlaveAddressRange& values);
@@ -51,11 +63,17 @@ class MqttClient {
         void onDisconnect();
         void onConnect();
         void onMessage(const char* topic, const void* payload, int payload_len);
+        void onPublish() { mPublishQueue.onPublished(); }
 
         //for unit tests
-        void setMqttImplementation(const std::shared_ptr<IMqttImpl>& impl) { mMqttImpl = impl; }
+        void setMqttImplementation(const std::shared_ptr<IMqttImpl>& impl) {
+            mMqttImpl = impl;
+            mPublishQueue.setMqttImplementation(impl);
+        }
     private:
         std::shared_ptr<IMqttImpl> mMqttImpl;
+        // all messages are published through this queue
+        MqttPublishQueue mPublishQueue;
 
         void subscribeToCommandTopic(const std::string& objectName, const MqttObjectCommand& cmd);
 
@@ -64,7 +82,7 @@ class MqttClient {
         MqttBrokerConfig mBrokerConfig;
 
         void checkAvailabilityChange(MqttObject& object, const MqttObjectRegisterIdent& ident, uint16_t value);
-        const MqttObjectCommand& findCommand(const char* topic) const;
+        const MqttCommandRouter::Route& findCommand(const char* topic) const;
 
         std::vector<std::shared_ptr<ModbusClient>> mModbusClients;
 
@@ -80,13 +98,50 @@ class MqttClient {
         */
         MqttPollObjMap mObjects;
 
+        // scalar nodes of mObjects per poll group
+        RegisterDispatchIndex mDispatchIndex;
+        // reused by processRegisterValues for objects in a single poll group
+        std::vector<AvailableFlag> mOldAvailFlags;
+        std::vector<char> mChangedFlags;
+        // reused by convertBatches()
+        std::vector<std::size_t> mBatchNodes;
+        std::vector<DataConverter::BatchSlot> mBatchSlots;
+        std::vector<MqttValue> mBatchValues;
+
+        // objects with state changes waiting for min_publish_interval.
+        // Objects are owned by mObjects
+        std::vector<MqttObject*> mDelayedObjects;
+        // true if state publish is postponed by min_publish_interval
+        bool delayStatePublish(MqttObject& obj);
+
+        // unique objects from mObjects in publishAll() order, owned by mObjects
+        std::vector<MqttObject*> mAllObjects;
+        // set by publishAll() in mosquitto thread, handled in main loop
+        std::atomic<bool> mPublishAllRequested = false;
+        // next object in mAllObjects to republish
+        std::size_t mPublishAllCursor = 0;
+        std::chrono::steady_clock::time_point mPublishAllStart;
+        void continuePublishAll(const std::chrono::steady_clock::time_point& pNow);
+
+        // objects in aggregate publish mode, owned by mObjects
+        std::vector<MqttObject*> mAggregateObjects;
+        void publishAggregates(const std::chrono::steady_clock::time_point& pNow);
+
+        void updateObjects(int pNetworkId, const MsgRegisterValues& pSlaveData, std::vector<std::shared_ptr<MqttObject>>& pObjects);
+        void dispatchRegisterValues(const RegisterDispatchIndex::Group& pGroup, const MsgRegisterValues& pSlaveData);
+        // convert changed nodes of pGroup with DataConverter::toMqttBatch()
+        void convertBatches(const RegisterDispatchIndex::Group& pGroup, const MsgRegisterValues& pSlaveData);
+        void publishObjectUpdate(MqttObject& obj, AvailableFlag oldAvail);
+
         /**
          * Direct relation between command and objects that poll the
          * same registers
         */
         MqttCmdObjMap mCommandObjects;
 
-        std::map<std::string, MqttObjectCommand> mCommands;
+        MqttCommandRouter mCommandRouter;
+        // topic filters subscribed for all commands
+        std::vector<std::string> mCommandSubscriptions;
 
         DefaultCommandConverter mDefaultConverter;
 };
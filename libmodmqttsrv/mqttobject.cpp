@@ -22,24 +22,25 @@ MqttObjectRegisterValue::setValue(uint16_t val) {
 
 
 bool
-MqttObjectDataNode::updateRegisterValues(const std::string& pNetworkName, const MsgRegisterValues& pSlaveData) {
+MqttObjectDataNode::updateRegisterValues(int pNetworkId, const MsgRegisterValues& pSlaveData) {
     bool ret = false;
     if (!isScalar()) {
         for(MqttObjectDataNode& node: mNodes) {
-            if (node.updateRegisterValues(pNetworkName, pSlaveData))
+            if (node.updateRegisterValues(pNetworkId, pSlaveData))
                 ret = true;
         }
+        if (ret)
+            mBatchValue = nullptr;
     } else {
         if (
-            pSlaveData.mSlaveId == mIdent->mSlaveId
-            && pSlaveData.mRegisterType == mIdent->mRegisterType
-            && pNetworkName == mIdent->mNetworkName
+            pSlaveData.mSlaveId == mIdent.mSlaveId
+            && pSlaveData.mRegisterType == mIdent.mRegisterType
+            && pNetworkId == mIdent.mNetworkId
         ) {
             //check if our value is in pSlaveData range and update
-            if (mIdent->mRegisterNumber >= pSlaveData.mRegister && mIdent->mRegisterNumber <= (pSlaveData.lastRegister())) {
-                uint16_t idx = mIdent->mRegisterNumber - pSlaveData.mRegister;
-                ret = mValue.setValue(pSlaveData.mRegisters.getValue(idx));
-                mValue.setReadError(false);
+            if (mIdent.mRegisterNumber >= pSlaveData.mRegister && mIdent.mRegisterNumber <= (pSlaveData.lastRegister())) {
+                uint16_t idx = mIdent.mRegisterNumber - pSlaveData.mRegister;
+                ret = setScalarValue(pSlaveData.mRegisters.getValue(idx));
             }
         }
     }
@@ -48,21 +49,83 @@ MqttObjectDataNode::updateRegisterValues(const std::string& pNetworkName, const
 
 
 bool
-MqttObjectDataNode::updateRegistersReadFailed(const std::string& pNetworkName, const ModbusSlaveAddressRange& pSlaveData) {
+MqttObjectDataNode::setScalarValue(uint16_t pValue) {
+    bool ret = mValue.setValue(pValue);
+    mValue.setReadError(false);
+    mPolled = true;
+    if (ret) {
+        mChanged = true;
+        mBatchValue = nullptr;
+    }
+    return ret;
+}
+
+
+bool
+MqttObjectDataNode::isChanged() const {
+    if (isScalar())
+        return mChanged;
+    for(const MqttObjectDataNode& node: mNodes) {
+        if (node.isChanged())
+            return true;
+    }
+    return false;
+}
+
+
+void
+MqttObjectDataNode::clearChanged() const {
+    mChanged = false;
+    for(const MqttObjectDataNode& node: mNodes)
+        node.clearChanged();
+}
+
+
+void
+MqttObjectDataNode::setJsonCache(const char* pJson, std::size_t pLength) const {
+    mJsonCache.assign(pJson, pLength);
+    clearChanged();
+}
+
+
+void
+MqttObjectDataNode::collectScalarNodes(std::vector<MqttObjectDataNode*>& pNodes) {
+    if (isScalar()) {
+        pNodes.push_back(this);
+    } else {
+        for(MqttObjectDataNode& node: mNodes)
+            node.collectScalarNodes(pNodes);
+    }
+}
+
+
+void
+MqttObjectDataNode::collectConvertedNodes(std::vector<MqttObjectDataNode*>& pNodes) {
+    if (hasConverter()) {
+        pNodes.push_back(this);
+    } else {
+        for(MqttObjectDataNode& node: mNodes)
+            node.collectConvertedNodes(pNodes);
+    }
+}
+
+
+bool
+MqttObjectDataNode::updateRegistersReadFailed(int pNetworkId, const ModbusSlaveAddressRange& pSlaveData) {
     bool ret = false;
     if (!isScalar()) {
         for(MqttObjectDataNode& node: mNodes) {
-            if (node.updateRegistersReadFailed(pNetworkName, pSlaveData))
+            if (node.updateRegistersReadFailed(pNetworkId, pSlaveData))
                 ret = true;
         }
     } else {
         if (
-            pSlaveData.mSlaveId == mIdent->mSlaveId
-            && pSlaveData.mRegisterType == mIdent->mRegisterType
-            && pNetworkName == mIdent->mNetworkName
+            pSlaveData.mSlaveId == mIdent.mSlaveId
+            && pSlaveData.mRegisterType == mIdent.mRegisterType
+            && pNetworkId == mIdent.mNetworkId
         ) {
             //check if our value is in pSlaveData range and update
-            uint16_t idx = abs(mIdent->mRegisterNumber - pSlaveData.mRegister);
+            uint16_t idx = abs(mIdent.mRegisterNumber - pSlaveData.mRegister);
             if (idx < pSlaveData.mCount) {
                 mValue.setReadError(true);
                 ret = true;
@@ -74,15 +137,15 @@ MqttObjectDataNode::updateRegistersReadFailed(const std::string& pNetworkName, c
 
 
 bool
-MqttObjectDataNode::setModbusNetworkState(const std::string& pNetworkName, bool isUp) {
+MqttObjectDataNode::setModbusNetworkState(int pNetworkId, bool isUp) {
     bool ret = false;
     if (!isScalar()) {
         for(MqttObjectDataNode& node: mNodes) {
-            if (node.setModbusNetworkState(pNetworkName, isUp))
+            if (node.setModbusNetworkState(pNetworkId, isUp))
                 ret = true;
         }
     } else {
-        if (pNetworkName == mIdent->mNetworkName) {
+        if (pNetworkId == mIdent.mNetworkId) {
             if (mValue.isPolling() ^ isUp) {
                 mValue.setReadError(!isUp);
                 ret = true;
@@ -107,6 +170,26 @@ MqttObjectDataNode::isPolling() const {
 }
 
 
+bool
+MqttObjectDataNode::isPolled() const {
+    if (isScalar())
+        return mPolled;
+    for(const MqttObjectDataNode& node: mNodes) {
+        if (!node.isPolled())
+            return false;
+    }
+    return true;
+}
+
+
+void
+MqttObjectDataNode::clearPolled() {
+    mPolled = false;
+    for(MqttObjectDataNode& node: mNodes)
+        node.clearPolled();
+}
+
+
 AvailableFlag
 MqttObjectAvailability::getAvailableFlag() const {
     // no registers for availability
@@ -127,25 +210,38 @@ MqttObjectAvailability::getAvailableFlag() const {
 
 
 void
-MqttObjectDataNode::setScalarNode(const MqttObjectRegisterIdent& ident) {
-    mIdent.reset(new MqttObjectRegisterIdent(ident));
+MqttObjectDataNode::setName(const std::string& pName) {
+    if (pName.empty()) {
+        mKeyName = nullptr;
+    } else {
+        StringPool& pool(StringPool::keyNames());
+        mKeyName = &pool.get(pool.intern(pName));
+    }
+}
+
+
+const std::string&
+MqttObjectDataNode::getName() const {
+    static const std::string empty;
+    if (mKeyName == nullptr)
+        return empty;
+    return *mKeyName;
 }
 
 
 bool
-MqttObjectDataNode::hasRegisterIn(const std::string& pNetworkName, const ModbusSlaveAddressRange& pRange) const {
+MqttObjectDataNode::hasRegisterIn(int pNetworkId, const ModbusSlaveAddressRange& pRange) const {
     if (isScalar()) {
-        assert(mIdent != nullptr);
-        if (mIdent->mSlaveId != pRange.mSlaveId)
+        if (mIdent.mSlaveId != pRange.mSlaveId)
             return false;
-        if (!pRange.overlaps(mIdent->asModbusAddressRange()))
+        if (!pRange.overlaps(mIdent.asModbusAddressRange()))
             return false;
-        if (mIdent->mNetworkName != pNetworkName)
+        if (mIdent.mNetworkId != pNetworkId)
             return false;
         return true;
     } else {
         for(std::vector<MqttObjectDataNode>::const_iterator it = mNodes.begin(); it != mNodes.end(); it++) {
-            if (it->hasRegisterIn(pNetworkName, pRange))
+            if (it->hasRegisterIn(pNetworkId, pRange))
                 return true;
         }
     }
@@ -156,7 +252,6 @@ MqttObjectDataNode::hasRegisterIn(const std::string& pNetworkName, const ModbusS
 bool
 MqttObjectDataNode::hasAllValues() const {
     if (isScalar()) {
-        assert(mIdent != nullptr);
         return mValue.hasValue();
     } else {
         for(std::vector<MqttObjectDataNode>::const_iterator it = mNodes.begin(); it != mNodes.end(); it++) {
@@ -171,6 +266,9 @@ MqttObjectDataNode::hasAllValues() const {
 MqttValue
 MqttObjectDataNode::getConvertedValue() const {
     if (mConverter != nullptr) {
+        if (mBatchValue != nullptr)
+            return *mBatchValue;
+
         ModbusRegisters data;
         if (isScalar()) {
             data.appendValue(getRawValue());
@@ -201,9 +299,9 @@ MqttObjectDataNode::addChildDataNode(const MqttObjectDataNode& pNode, bool force
 
 
 bool
-MqttObjectState::hasRegisterIn(const std::string& pNetworkName, const ModbusSlaveAddressRange& pRange) const {
+MqttObjectState::hasRegisterIn(int pNetworkId, const ModbusSlaveAddressRange& pRange) const {
     for(std::vector<MqttObjectDataNode>::const_iterator it = mNodes.begin(); it != mNodes.end(); it++) {
-        if (it->hasRegisterIn(pNetworkName, pRange))
+        if (it->hasRegisterIn(pNetworkId, pRange))
             return true;
     }
     return false;
@@ -211,10 +309,10 @@ MqttObjectState::hasRegisterIn(const std::string& pNetworkName, const ModbusSlav
 
 
 bool
-MqttObjectState::updateRegisterValues(const std::string& pNetworkName, const MsgRegisterValues& pSlaveData) {
+MqttObjectState::updateRegisterValues(int pNetworkId, const MsgRegisterValues& pSlaveData) {
     bool ret = false;
     for(std::vector<MqttObjectDataNode>::iterator it = mNodes.begin(); it != mNodes.end(); it++) {
-        if (it->updateRegisterValues(pNetworkName, pSlaveData))
+        if (it->updateRegisterValues(pNetworkId, pSlaveData))
             ret = true;
     }
     return ret;
@@ -222,10 +320,10 @@ MqttObjectState::updateRegisterValues(const std::string& pNetworkName, const Msg
 
 
 bool
-MqttObjectState::updateRegistersReadFailed(const std::string& pNetworkName, const ModbusSlaveAddressRange& pSlaveData) {
+MqttObjectState::updateRegistersReadFailed(int pNetworkId, const ModbusSlaveAddressRange& pSlaveData) {
     bool ret = false;
     for(std::vector<MqttObjectDataNode>::iterator it = mNodes.begin(); it != mNodes.end(); it++) {
-        if (it->updateRegistersReadFailed(pNetworkName, pSlaveData))
+        if (it->updateRegistersReadFailed(pNetworkId, pSlaveData))
             ret = true;
     }
     return ret;
@@ -233,16 +331,51 @@ MqttObjectState::updateRegistersReadFailed(const std::string& pNetworkName, cons
 
 
 bool
-MqttObjectState::setModbusNetworkState(const std::string& networkName, bool isUp) {
+MqttObjectState::setModbusNetworkState(int pNetworkId, bool isUp) {
     bool ret = false;
     for(std::vector<MqttObjectDataNode>::iterator it = mNodes.begin(); it != mNodes.end(); it++) {
-        if (it->setModbusNetworkState(networkName, isUp))
+        if (it->setModbusNetworkState(pNetworkId, isUp))
             ret = true;
     }
     return ret;
 }
 
 
+void
+MqttObjectState::collectScalarNodes(std::vector<MqttObjectDataNode*>& pNodes) {
+    for(MqttObjectDataNode& node: mNodes)
+        node.collectScalarNodes(pNodes);
+}
+
+
+void
+MqttObjectState::collectConvertedNodes(std::vector<MqttObjectDataNode*>& pNodes) {
+    for(MqttObjectDataNode& node: mNodes)
+        node.collectConvertedNodes(pNodes);
+}
+
+
+static void
+aggregateNodeValues(const MqttObjectDataNodeList& pNodes, std::vector<MqttValueAggregate>& pAggregates, std::size_t& pIndex) {
+    for(const MqttObjectDataNode& node: pNodes) {
+        if (node.isScalar() || node.hasConverter()) {
+            if (pIndex == pAggregates.size())
+                pAggregates.resize(pIndex + 1);
+            pAggregates[pIndex++].add(node.getConvertedValue());
+        } else {
+            aggregateNodeValues(node.getChildNodes(), pAggregates, pIndex);
+        }
+    }
+}
+
+
+void
+MqttObjectState::aggregateValues(std::vector<MqttValueAggregate>& pAggregates) const {
+    std::size_t index = 0;
+    aggregateNodeValues(mNodes, pAggregates, index);
+}
+
+
 bool
 MqttObjectState::hasAllValues() const {
     for(std::vector<MqttObjectDataNode>::const_iterator it = mNodes.begin(); it != mNodes.end(); it++) {
@@ -263,6 +396,23 @@ MqttObjectState::isPolling() const {
 }
 
 
+bool
+MqttObjectState::isPolled() const {
+    for(const MqttObjectDataNode& node: mNodes) {
+        if (!node.isPolled())
+            return false;
+    }
+    return true;
+}
+
+
+void
+MqttObjectState::clearPolled() {
+    for(MqttObjectDataNode& node: mNodes)
+        node.clearPolled();
+}
+
+
 void
 MqttObjectState::addDataNode(const MqttObjectDataNode& pNode, bool forceList) {
     mNodes.push_back(pNode);
@@ -271,34 +421,84 @@ MqttObjectState::addDataNode(const MqttObjectDataNode& pNode, bool forceList) {
 
 
 
+void
+MqttValueAggregate::add(const MqttValue& pValue) {
+    mCount++;
+    mLast = pValue;
+    if (pValue.getSourceType() == MqttValue::SourceType::BINARY)
+        return;
+
+    double val = pValue.getDouble();
+    if (mNumericCount == 0) {
+        mMin = mMax = mSum = val;
+    } else {
+        mMin = std::min(mMin, val);
+        mMax = std::max(mMax, val);
+        mSum += val;
+    }
+    mNumericCount++;
+}
+
+
+static const std::string STATE_TOPIC_SUFFIX("/state");
+
 MqttObject::MqttObject(const std::string& pTopic)
-    : mTopic(pTopic)
+    : mStateTopic(pTopic + STATE_TOPIC_SUFFIX),
+      mAvailabilityTopic(pTopic + "/availability")
 {
-    mStateTopic = mTopic + "/state";
-    mAvailabilityTopic = mTopic + "/availability";
 };
 
 
+std::string
+MqttObject::getTopic() const {
+    return mStateTopic.substr(0, mStateTopic.length() - STATE_TOPIC_SUFFIX.length());
+}
+
+
 bool
-MqttObject::hasRegisterIn(const std::string& pNetworkName, const ModbusSlaveAddressRange& pRange) const {
-    return mState.hasRegisterIn(pNetworkName, pRange) || mAvailability.hasRegisterIn(pNetworkName, pRange);
+MqttObject::hasRegisterIn(int pNetworkId, const ModbusSlaveAddressRange& pRange) const {
+    return mState.hasRegisterIn(pNetworkId, pRange) || mAvailability.hasRegisterIn(pNetworkId, pRange);
 }
 
 
 void
-MqttObject::updateRegisterValues(const std::string& pNetworkName, const MsgRegisterValues& pSlaveData) {
-    bool stateChanged = mState.updateRegisterValues(pNetworkName, pSlaveData);
-    bool availChanged = mAvailability.updateRegisterValues(pNetworkName, pSlaveData);
-    if (stateChanged || availChanged || !mIsAvailable) {
+MqttObject::updateRegisterValues(int pNetworkId, const MsgRegisterValues& pSlaveData) {
+    bool stateChanged = mState.updateRegisterValues(pNetworkId, pSlaveData);
+    bool availChanged = mAvailability.updateRegisterValues(pNetworkId, pSlaveData);
+    valuesUpdated(stateChanged || availChanged);
+}
+
+
+void
+MqttObject::valuesUpdated(bool pChanged) {
+    // pChanged can be set by availability nodes only,
+    // then publishState compares the whole payload
+    if (pChanged)
+        mStateChanged = true;
+    if (pChanged || !mIsAvailable) {
         updateAvailablityFlag();
     }
 }
 
 
 void
-MqttObject::updateRegistersReadFailed(const std::string& pNetworkName, const ModbusSlaveAddressRange& pSlaveData) {
-    bool stateChanged = mState.updateRegistersReadFailed(pNetworkName, pSlaveData);
-    bool availChanged = mAvailability.updateRegistersReadFailed(pNetworkName, pSlaveData);
+MqttObject::collectScalarNodes(std::vector<MqttObjectDataNode*>& pNodes) {
+    mState.collectScalarNodes(pNodes);
+    mAvailability.collectScalarNodes(pNodes);
+}
+
+
+void
+MqttObject::collectConvertedNodes(std::vector<MqttObjectDataNode*>& pNodes) {
+    mState.collectConvertedNodes(pNodes);
+    mAvailability.collectConvertedNodes(pNodes);
+}
+
+
+void
+MqttObject::updateRegistersReadFailed(int pNetworkId, const ModbusSlaveAddressRange& pSlaveData) {
+    bool stateChanged = mState.updateRegistersReadFailed(pNetworkId, pSlaveData);
+    bool availChanged = mAvailability.updateRegistersReadFailed(pNetworkId, pSlaveData);
     if (stateChanged || availChanged) {
         updateAvailablityFlag();
     }
@@ -306,9 +506,9 @@ MqttObject::updateRegistersReadFailed(const std::string& pNetworkName, const Mod
 
 
 bool
-MqttObject::setModbusNetworkState(const std::string& networkName, bool isUp) {
-    bool stateChanged = mState.setModbusNetworkState(networkName, isUp);
-    bool availChanged = mAvailability.setModbusNetworkState(networkName, isUp);
+MqttObject::setModbusNetworkState(int pNetworkId, bool isUp) {
+    bool stateChanged = mState.setModbusNetworkState(pNetworkId, isUp);
+    bool availChanged = mAvailability.setModbusNetworkState(pNetworkId, isUp);
     if (stateChanged || availChanged) {
         updateAvailablityFlag();
         return true;
@@ -353,6 +553,35 @@ MqttObject::needStateRepublish() const {
     return nextPublish <= std::chrono::steady_clock::now();
 }
 
+void
+MqttObject::aggregateState() {
+    // object registers can be split into many poll groups,
+    // wait until the last one is read
+    if (!mState.isPolled() || !mAvailability.isPolled())
+        return;
+    mState.clearPolled();
+    mAvailability.clearPolled();
+
+    if (!hasAggregatedValues()) {
+        // move to the window with the current time, do not
+        // start a new one at the first sample to avoid drift
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (mAggregateWindowStart == std::chrono::steady_clock::time_point::min())
+            mAggregateWindowStart = now;
+        else if (now >= getAggregateWindowEnd())
+            mAggregateWindowStart += mAggregateWindow * ((now - mAggregateWindowStart) / mAggregateWindow);
+    }
+    mState.aggregateValues(mAggregates);
+}
+
+
+void
+MqttObject::startNextAggregateWindow() {
+    for(MqttValueAggregate& aggregate: mAggregates)
+        aggregate.reset();
+}
+
+
 void
 MqttObject::setPublishMode(const PublishMode& pMode, std::chrono::milliseconds pEveryPollRefresh) {
     mPublishMode = pMode;
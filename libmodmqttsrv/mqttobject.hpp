@@ -8,6 +8,7 @@
 
 #include "modbus_messages.hpp"
 #include "common.hpp"
+#include "string_pool.hpp"
 #include "libmodmqttconv/converter.hpp"
 
 namespace modmqttd {
@@ -19,12 +20,19 @@ enum AvailableFlag {
 };
 
 
+/**
+ * Identifies a single modbus register used by MqttObject.
+ *
+ * Network name is interned in StringPool::networkNames(),
+ * so ident is small enough to be stored inline in every scalar
+ * MqttObjectDataNode and compared without string comparison.
+ * */
 class MqttObjectRegisterIdent {
     public:
         struct Compare {
             bool operator() (const MqttObjectRegisterIdent& left, const MqttObjectRegisterIdent& right) const {
-                return std::tie(left.mNetworkName, left.mSlaveId, left.mRegisterNumber, left.mRegisterType)
-                        < std::tie(right.mNetworkName, right.mSlaveId, right.mRegisterNumber, right.mRegisterType);
+                return std::tie(left.mNetworkId, left.mSlaveId, left.mRegisterNumber, left.mRegisterType)
+                        < std::tie(right.mNetworkId, right.mSlaveId, right.mRegisterNumber, right.mRegisterType);
             }
         };
         struct Equal {
@@ -32,7 +40,7 @@ class MqttObjectRegisterIdent {
                 return left.mSlaveId == right.mSlaveId
                     && left.mRegisterNumber == right.mRegisterNumber
                     && left.mRegisterType == right.mRegisterType
-                    && left.mNetworkName == right.mNetworkName;
+                    && left.mNetworkId == right.mNetworkId;
             }
         };
         MqttObjectRegisterIdent(
@@ -40,19 +48,27 @@ class MqttObjectRegisterIdent {
             int slaveId,
             RegisterType regType,
             int registerNumber
-        ) : mNetworkName(network),
+        ) : mNetworkId(StringPool::networkNames().intern(network)),
             mSlaveId(slaveId),
             mRegisterNumber(registerNumber),
             mRegisterType(regType)
         {}
 
         MqttObjectRegisterIdent(const std::string& network, const ModbusSlaveAddressRange& slaveData)
-          : mNetworkName(network),
+          : mNetworkId(StringPool::networkNames().intern(network)),
             mSlaveId(slaveData.mSlaveId),
             mRegisterNumber(slaveData.mRegister),
             mRegisterType(slaveData.mRegisterType)
         {}
 
+        // ident of a non-scalar MqttObjectDataNode
+        MqttObjectRegisterIdent()
+          : mNetworkId(StringPool::NOT_FOUND),
+            mSlaveId(0),
+            mRegisterNumber(0),
+            mRegisterType(RegisterType::COIL)
+        {}
+
         bool operator==(const MqttObjectRegisterIdent& other) {
             return Equal()(*this, other);
         }
@@ -61,7 +77,11 @@ class MqttObjectRegisterIdent {
             return ModbusAddressRange(mRegisterNumber, mRegisterType, 1);
         }
 
-        std::string mNetworkName;
+        const std::string& getNetworkName() const {
+            return StringPool::networkNames().get(mNetworkId);
+        }
+
+        int mNetworkId;
         int mSlaveId;
         int mRegisterNumber;
         RegisterType mRegisterType;
@@ -102,31 +122,60 @@ class MqttObjectDataNodeList : public std::vector<MqttObjectDataNode> {
 
 class MqttObjectDataNode {
     public:
-        bool updateRegisterValues(const std::string& pNetworkName, const MsgRegisterValues& pSlaveData);
-        bool updateRegistersReadFailed(const std::string& pNetworkName, const ModbusSlaveAddressRange& pSlaveData);
-        bool setModbusNetworkState(const std::string& networkName, bool isUp);
+        bool updateRegisterValues(int pNetworkId, const MsgRegisterValues& pSlaveData);
+        bool updateRegistersReadFailed(int pNetworkId, const ModbusSlaveAddressRange& pSlaveData);
+        bool setModbusNetworkState(int pNetworkId, bool isUp);
 
-        bool hasRegisterIn(const std::string& pNetworkName, const ModbusSlaveAddressRange& pRange) const;
+        bool hasRegisterIn(int pNetworkId, const ModbusSlaveAddressRange& pRange) const;
         bool hasAllValues() const;
         bool isPolling() const;
+        // true if every scalar node was set after clearPolled()
+        bool isPolled() const;
+        void clearPolled();
 
-        bool isUnnamed() const { return mKeyName.empty(); }
-        void setName(const std::string& pName) { mKeyName = pName; }
-        const std::string& getName() const { return mKeyName; }
+        bool isUnnamed() const { return mKeyName == nullptr; }
+        void setName(const std::string& pName);
+        const std::string& getName() const;
 
         void setConverter(std::shared_ptr<DataConverter> conv) { mConverter = conv; }
         bool hasConverter() const { return mConverter != nullptr; }
+        const DataConverter* getConverter() const { return mConverter.get(); }
 
         bool isScalar() const { return mNodes.size() == 0; }
         void addChildDataNode(const MqttObjectDataNode& pNode, bool forceList = false);
-        void setScalarNode(const MqttObjectRegisterIdent& ident);
+        void setScalarNode(const MqttObjectRegisterIdent& ident) { mIdent = ident; }
+        const MqttObjectRegisterIdent& getRegisterIdent() const { return mIdent; }
+        // set value of scalar node, returns true if value is changed
+        bool setScalarValue(uint16_t pValue);
+        // append pointers to all scalar nodes in this tree
+        void collectScalarNodes(std::vector<MqttObjectDataNode*>& pNodes);
+        // append pointers to all nodes with converter in this tree
+        void collectConvertedNodes(std::vector<MqttObjectDataNode*>& pNodes);
+        /**
+         * Set value converted by DataConverter::toMqttBatch(), returned by
+         * getConvertedValue() until register values of this node are changed.
+         * pValue is owned by caller.
+         * */
+        void setBatchValue(const MqttValue* pValue) { mBatchValue = pValue; }
         const MqttObjectDataNodeList& getChildNodes() const { return mNodes; }
         MqttValue getConvertedValue() const;
         uint16_t getRawValue() const;
+
+        /**
+         * Json value of this node serialized by MqttPayload.
+         * Cache is valid until value of this node or any
+         * of its child nodes is changed.
+         */
+        bool hasJsonCache() const { return !mJsonCache.empty() && !isChanged(); }
+        // true if value of this node or any of its child nodes is changed after json cache was set
+        bool isChanged() const;
+        const std::string& getJsonCache() const { return mJsonCache; }
+        void setJsonCache(const char* pJson, std::size_t pLength) const;
     private:
-        // if not empty then json value is published as json object
-        //
-        std::string mKeyName;
+        // if not null then json value is published as json object.
+        // Points to a string in StringPool::keyNames(), the same
+        // key is usually repeated in many objects.
+        const std::string* mKeyName = nullptr;
         /**
          * if not empty then this is composite node
          * that is published as:
@@ -142,30 +191,68 @@ class MqttObjectDataNode {
          * Modbus register identifier used to
          * update values received from modbus threads.
         */
-        std::shared_ptr<MqttObjectRegisterIdent> mIdent;
+        MqttObjectRegisterIdent mIdent;
         /**
          * if mNodes is empty then this is a scalar value.
         */
         MqttObjectRegisterValue mValue;
+        // scalar value changed after mJsonCache was set
+        mutable bool mChanged = true;
+        // scalar value set after clearPolled()
+        bool mPolled = false;
 
         /**
          * A converter used to convert mValue or list of scalars on mNodes list
         */
         std::shared_ptr<DataConverter> mConverter;
+        // converted value set by setBatchValue()
+        const MqttValue* mBatchValue = nullptr;
+
+        mutable std::string mJsonCache;
+
+        void clearChanged() const;
+};
+
+/**
+ * Statistics of a single state value collected in aggregate publish mode.
+ * Non-numeric values are not aggregated, only the last one is kept.
+ * */
+class MqttValueAggregate {
+    public:
+        void add(const MqttValue& pValue);
+        void reset() { mCount = 0; mNumericCount = 0; }
+
+        bool isNumeric() const { return mNumericCount != 0; }
+        double getAverage() const { return mSum / mNumericCount; }
+
+        int mCount = 0;
+        int mNumericCount = 0;
+        double mMin = 0;
+        double mMax = 0;
+        double mSum = 0;
+        MqttValue mLast;
 };
 
 class MqttObjectState {
     public:
         //void addRegister(const std::string& name, const MqttObjectRegisterIdent& regIdent, const std::shared_ptr<DataConverter>& conv);
-        bool hasRegisterIn(const std::string& pNetworkName, const ModbusSlaveAddressRange& pRange) const;
-        bool usesModbusNetwork(const std::string& networkName) const;
-        bool updateRegisterValues(const std::string& pNetworkName, const MsgRegisterValues& pSlaveData);
-        bool updateRegistersReadFailed(const std::string& pNetworkName, const ModbusSlaveAddressRange& pSlaveData);
-        bool setModbusNetworkState(const std::string& networkName, bool isUp);
+        bool hasRegisterIn(int pNetworkId, const ModbusSlaveAddressRange& pRange) const;
+        bool updateRegisterValues(int pNetworkId, const MsgRegisterValues& pSlaveData);
+        bool updateRegistersReadFailed(int pNetworkId, const ModbusSlaveAddressRange& pSlaveData);
+        bool setModbusNetworkState(int pNetworkId, bool isUp);
         bool hasAllValues() const;
         bool isPolling() const;
+        bool isPolled() const;
+        void clearPolled();
         void addDataNode(const MqttObjectDataNode& pNode, bool forceList = false);
         const MqttObjectDataNodeList& getNodes() const { return mNodes; }
+        void collectScalarNodes(std::vector<MqttObjectDataNode*>& pNodes);
+        void collectConvertedNodes(std::vector<MqttObjectDataNode*>& pNodes);
+        /**
+         * Add converted value of every scalar node and node with converter
+         * to pAggregates, in the same order as values in json payload.
+         * */
+        void aggregateValues(std::vector<MqttValueAggregate>& pAggregates) const;
     protected:
         MqttObjectDataNodeList mNodes;
 };
@@ -183,13 +270,20 @@ class MqttObjectAvailability : public MqttObjectState {
 class MqttObject {
     public:
         MqttObject(const std::string& pTopic);
-        const std::string& getTopic() const { return mTopic; };
+        std::string getTopic() const;
         const std::string& getStateTopic() const { return mStateTopic; };
         const std::string& getAvailabilityTopic() const { return mAvailabilityTopic; }
-        bool hasRegisterIn(const std::string& pNetworkName, const ModbusSlaveAddressRange& pRange) const;
-        void updateRegisterValues(const std::string& pNetworkName, const MsgRegisterValues& pSlaveData);
-        void updateRegistersReadFailed(const std::string& pNetworkName, const ModbusSlaveAddressRange& pSlaveData);
-        bool setModbusNetworkState(const std::string& networkName, bool isUp);
+        // pNetworkId is an id from StringPool::networkNames()
+        bool hasRegisterIn(int pNetworkId, const ModbusSlaveAddressRange& pRange) const;
+        void updateRegisterValues(int pNetworkId, const MsgRegisterValues& pSlaveData);
+        void updateRegistersReadFailed(int pNetworkId, const ModbusSlaveAddressRange& pSlaveData);
+        bool setModbusNetworkState(int pNetworkId, bool isUp);
+        // state and availability scalar nodes
+        void collectScalarNodes(std::vector<MqttObjectDataNode*>& pNodes);
+        // state and availability nodes with converter
+        void collectConvertedNodes(std::vector<MqttObjectDataNode*>& pNodes);
+        // update availability after scalar nodes are set directly
+        void valuesUpdated(bool pChanged);
 
         void addAvailabilityDataNode(const MqttObjectDataNode& pNode) { mAvailability.addDataNode(pNode); }
         void setAvailableValue(const MqttValue& pValue) { mAvailability.setAvailableValue(pValue); }
@@ -198,8 +292,11 @@ class MqttObject {
         void setLastPublishedPayload(const std::string& pVal) {
             mLastPublishedPayload = pVal;
             mLastPublishTime = std::chrono::steady_clock::now();
+            mStateChanged = false;
         }
         const std::string& getLastPublishedPayload() const { return mLastPublishedPayload; }
+        // false if no state value changed since last published payload was set
+        bool isStateChanged() const { return mStateChanged; }
 
         void setPublishMode(const PublishMode& pMode, std::chrono::milliseconds pEveryPollRefresh);
 
@@ -210,11 +307,33 @@ class MqttObject {
 
         bool needStateRepublish() const;
 
+        // 0 means that state changes are published immediately
+        void setMinPublishInterval(std::chrono::milliseconds pInterval) { mMinPublishInterval = pInterval; }
+        std::chrono::milliseconds getMinPublishInterval() const { return mMinPublishInterval; }
+        // earliest time when changed state can be published
+        std::chrono::steady_clock::time_point getNextPublishTime() const { return mLastPublishTime + mMinPublishInterval; }
+        // true if changed state is waiting for min publish interval to pass
+        bool isPublishDelayed() const { return mPublishDelayed; }
+        void setPublishDelayed(bool pFlag) { mPublishDelayed = pFlag; }
+
+        void setAggregateWindow(std::chrono::milliseconds pWindow) { mAggregateWindow = pWindow; }
+        std::chrono::milliseconds getAggregateWindow() const { return mAggregateWindow; }
+        /**
+         * Add current state values to aggregation window once per poll cycle,
+         * when all state and availability registers are read again.
+         * */
+        void aggregateState();
+        bool hasAggregatedValues() const { return !mAggregates.empty() && mAggregates.front().mCount != 0; }
+        const std::vector<MqttValueAggregate>& getAggregates() const { return mAggregates; }
+        std::chrono::steady_clock::time_point getAggregateWindowEnd() const { return mAggregateWindowStart + mAggregateWindow; }
+        // clear aggregated values after they are published
+        void startNextAggregateWindow();
+
         MqttObjectState mState;
 
         void dump() const;
     private:
-        std::string mTopic;
+        // base topic is not stored, it is a prefix of mStateTopic
         std::string mStateTopic;
         std::string mAvailabilityTopic;
 
@@ -225,8 +344,17 @@ class MqttObject {
         bool mRetain = true;
         PublishMode mPublishMode;
         std::string mLastPublishedPayload;
+        bool mStateChanged = true;
         std::chrono::steady_clock::time_point mLastPublishTime = std::chrono::steady_clock::time_point::min();
         std::chrono::milliseconds mEveryPollPeriod;
+        std::chrono::milliseconds mMinPublishInterval = std::chrono::milliseconds::zero();
+        bool mPublishDelayed = false;
+
+        std::chrono::milliseconds mAggregateWindow = std::chrono::milliseconds::zero();
+        // windows start at the first sample + n * mAggregateWindow
+        std::chrono::steady_clock::time_point mAggregateWindowStart = std::chrono::steady_clock::time_point::min();
+        // empty if object is not in aggregate mode
+        std::vector<MqttValueAggregate> mAggregates;
 
         void updateAvailablityFlag();
 };
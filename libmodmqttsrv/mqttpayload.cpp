@@ -51,17 +51,35 @@ bool isList(const MqttObjectDataNodeList& pNodes) {
 }
 
 
+// writes json value of node with converter or a scalar node,
+// serializes it again only if node value was changed
 void
-generateJson(rapidjson::Writer<rapidjson::StringBuffer>& pWriter, const MqttObjectDataNodeList& pNodes) {
+writeNodeValue(rapidjson::Writer<rapidjson::StringBuffer>& pWriter, const MqttObjectDataNode& pNode) {
+    if (!pNode.hasJsonCache()) {
+        thread_local rapidjson::StringBuffer buffer;
+        thread_local rapidjson::Writer<rapidjson::StringBuffer> writer;
+        buffer.Clear();
+        writer.Reset(buffer);
+        createConvertedValue(writer, pNode.getConvertedValue());
+        pNode.setJsonCache(buffer.GetString(), buffer.GetSize());
+    }
+    const std::string& json(pNode.getJsonCache());
+    pWriter.RawValue(json.c_str(), json.length(), json[0] == '"' ? rapidjson::kStringType : rapidjson::kNumberType);
+}
+
+
+// pValueWriter writes json value of a scalar node or a node with converter
+template <typename ValueWriter>
+void
+generateJson(rapidjson::Writer<rapidjson::StringBuffer>& pWriter, const MqttObjectDataNodeList& pNodes, ValueWriter& pValueWriter) {
     if (isMap(pNodes)) {
         pWriter.StartObject();
         for(const MqttObjectDataNode& node: pNodes) {
             pWriter.Key(node.getName().c_str());
             if (node.isScalar() || node.hasConverter()) {
-                MqttValue v = node.getConvertedValue();
-                createConvertedValue(pWriter, v);
+                pValueWriter(pWriter, node);
             } else {
-                generateJson(pWriter, node.getChildNodes());
+                generateJson(pWriter, node.getChildNodes(), pValueWriter);
             }
         }
         pWriter.EndObject();
@@ -69,18 +87,38 @@ generateJson(rapidjson::Writer<rapidjson::StringBuffer>& pWriter, const MqttObje
         pWriter.StartArray();
         for(const MqttObjectDataNode& node: pNodes) {
             if (node.isScalar() || node.hasConverter()) {
-                MqttValue v = node.getConvertedValue();
-                createConvertedValue(pWriter, v);
+                pValueWriter(pWriter, node);
             } else {
-                generateJson(pWriter, node.getChildNodes());
+                generateJson(pWriter, node.getChildNodes(), pValueWriter);
             }
         }
         pWriter.EndArray();
     } else {
         //single scalar
-        MqttValue v = pNodes.front().getConvertedValue();
-        createConvertedValue(pWriter, v);
+        pValueWriter(pWriter, pNodes.front());
+    }
+}
+
+
+void
+writeAggregate(rapidjson::Writer<rapidjson::StringBuffer>& pWriter, const MqttValueAggregate& pAggregate) {
+    const MqttValue& last(pAggregate.mLast);
+    pWriter.StartObject();
+    if (pAggregate.isNumeric()) {
+        bool isInteger = last.getSourceType() == MqttValue::SourceType::INT || last.getSourceType() == MqttValue::SourceType::INT64;
+        int precision = isInteger ? MqttValue::NO_PRECISION : last.getDoublePrecision();
+        pWriter.Key("min");
+        createConvertedValue(pWriter, isInteger ? MqttValue::fromInt64(static_cast<int64_t>(pAggregate.mMin)) : MqttValue::fromDouble(pAggregate.mMin, precision));
+        pWriter.Key("max");
+        createConvertedValue(pWriter, isInteger ? MqttValue::fromInt64(static_cast<int64_t>(pAggregate.mMax)) : MqttValue::fromDouble(pAggregate.mMax, precision));
+        pWriter.Key("avg");
+        createConvertedValue(pWriter, MqttValue::fromDouble(pAggregate.getAverage(), precision));
     }
+    pWriter.Key("last");
+    createConvertedValue(pWriter, last);
+    pWriter.Key("count");
+    pWriter.Int(pAggregate.mCount);
+    pWriter.EndObject();
 }
 
 
@@ -98,11 +136,31 @@ MqttPayload::generate(const MqttObject& pObj) {
     };
     // single non-scalar node or a list
     {
-        rapidjson::StringBuffer ret;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(ret);
-        generateJson(writer, nodes);
-        return ret.GetString();
+        // reused to avoid buffer reallocation on every publish
+        thread_local rapidjson::StringBuffer ret;
+        thread_local rapidjson::Writer<rapidjson::StringBuffer> writer;
+        ret.Clear();
+        writer.Reset(ret);
+        generateJson(writer, nodes, writeNodeValue);
+        return std::string(ret.GetString(), ret.GetSize());
     }
 }
 
+
+std::string
+MqttPayload::generateAggregate(const MqttObject& pObj) {
+    const std::vector<MqttValueAggregate>& aggregates(pObj.getAggregates());
+    std::size_t index = 0;
+    auto valueWriter = [&aggregates, &index](rapidjson::Writer<rapidjson::StringBuffer>& pWriter, const MqttObjectDataNode& pNode) {
+        writeAggregate(pWriter, aggregates[index++]);
+    };
+
+    thread_local rapidjson::StringBuffer ret;
+    thread_local rapidjson::Writer<rapidjson::StringBuffer> writer;
+    ret.Clear();
+    writer.Reset(ret);
+    generateJson(writer, pObj.mState.getNodes(), valueWriter);
+    return std::string(ret.GetString(), ret.GetSize());
+}
+
 }
@@ -7,6 +7,8 @@ namespace modmqttd {
 class MqttPayload {
     public:
         static std::string generate(const MqttObject& pObj);
+        // json with min, max, avg, last value and count for every state value
+        static std::string generateAggregate(const MqttObject& pObj);
 
 };
 
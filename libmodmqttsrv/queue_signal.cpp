@@ -0,0 +1,39 @@
+#include <cstring>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "queue_signal.hpp"
+#include "exceptions.hpp"
+
+namespace modmqttd {
+
+QueueSignal::QueueSignal()
+    : mPending(false)
+{
+    mFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mFd == -1)
+        throw ModMqttException(std::string("Cannot create eventfd: ") + strerror(errno));
+}
+
+void
+QueueSignal::notify() {
+    if (mPending.exchange(true))
+        return;
+    uint64_t value = 1;
+    // EAGAIN means counter overflow, consumer is woken up anyway
+    (void)!write(mFd, &value, sizeof(value));
+}
+
+void
+QueueSignal::clear() {
+    uint64_t value;
+    (void)!read(mFd, &value, sizeof(value));
+    mPending = false;
+}
+
+QueueSignal::~QueueSignal() {
+    if (mFd != -1)
+        close(mFd);
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+
+namespace modmqttd {
+
+/**
+ * Wakes up a thread waiting on eventfd descriptor with epoll.
+ * Repeated notify() calls are coalesced until the waiting side
+ * calls clear(), so producer does a syscall at most once
+ * per consumer wakeup.
+ * */
+class QueueSignal {
+    public:
+        QueueSignal();
+        // can be called from any thread and from signal handler
+        void notify();
+        // must be called before draining the queue
+        void clear();
+        int getFd() const { return mFd; }
+        ~QueueSignal();
+    private:
+        QueueSignal(const QueueSignal&);
+
+        int mFd = -1;
+        std::atomic<bool> mPending;
+};
+
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include "register_dispatch_index.hpp"
+
+namespace modmqttd {
+
+uint64_t
+RegisterDispatchIndex::makeKey(int pNetworkId, int pSlaveId, RegisterType pType, int pRegister) {
+    return (uint64_t(uint16_t(pNetworkId)) << 48)
+        | (uint64_t(uint16_t(pSlaveId)) << 32)
+        | (uint64_t(uint8_t(pType)) << 24)
+        | uint64_t(uint32_t(pRegister) & 0xFFFFFF);
+}
+
+bool
+RegisterDispatchIndex::getBatchSlot(const MqttObjectDataNode& pNode, const MqttObjectRegisterIdent& pGroupIdent, int pLastRegister, DataConverter::BatchSlot& pSlotOut) {
+    std::vector<const MqttObjectRegisterIdent*> idents;
+    if (pNode.isScalar()) {
+        idents.push_back(&pNode.getRegisterIdent());
+    } else {
+        for(const MqttObjectDataNode& child: pNode.getChildNodes()) {
+            if (!child.isScalar())
+                return false;
+            idents.push_back(&child.getRegisterIdent());
+        }
+    }
+
+    // registers must be in order without gaps
+    const MqttObjectRegisterIdent& first(*idents.front());
+    for(std::size_t i = 0; i < idents.size(); i++) {
+        const MqttObjectRegisterIdent& ident(*idents[i]);
+        if (ident.mSlaveId != pGroupIdent.mSlaveId
+            || ident.mRegisterType != pGroupIdent.mRegisterType
+            || ident.mNetworkId != pGroupIdent.mNetworkId
+            || ident.mRegisterNumber != first.mRegisterNumber + int(i))
+            return false;
+    }
+
+    int lastRegister = first.mRegisterNumber + idents.size() - 1;
+    if (first.mRegisterNumber < pGroupIdent.mRegisterNumber || lastRegister > pLastRegister)
+        return false;
+
+    pSlotOut.mOffset = first.mRegisterNumber - pGroupIdent.mRegisterNumber;
+    pSlotOut.mCount = idents.size();
+    return true;
+}
+
+void
+RegisterDispatchIndex::build(const ObjectMap& pObjects) {
+    mGroups.clear();
+    mSlots.clear();
+    mBatches.clear();
+    mBatchNodes.clear();
+    mMaxObjectsInGroup = 0;
+    mMaxBatchSize = 0;
+
+    std::vector<MqttObjectDataNode*> nodes;
+    // converter -> nodes in current group
+    std::map<const DataConverter*, std::vector<BatchNode>> batches;
+    for(auto it = pObjects.begin(); it != pObjects.end(); it++) {
+        const MqttObjectRegisterIdent& ident(it->first);
+
+        // poll groups do not overlap, group ends where
+        // the next one for the same slave and register type starts
+        int lastRegister = std::numeric_limits<int>::max();
+        for(auto next = std::next(it); next != pObjects.end(); next++) {
+            if (next->first.mNetworkId != ident.mNetworkId || next->first.mSlaveId != ident.mSlaveId)
+                break;
+            if (next->first.mRegisterType == ident.mRegisterType) {
+                lastRegister = next->first.mRegisterNumber - 1;
+                break;
+            }
+        }
+
+        Group group;
+        group.mFirstSlot = mSlots.size();
+        group.mObjects = &(it->second);
+
+        for(std::size_t i = 0; i < it->second.size(); i++) {
+            nodes.clear();
+            it->second[i]->collectScalarNodes(nodes);
+            for(MqttObjectDataNode* node: nodes) {
+                const MqttObjectRegisterIdent& nodeIdent(node->getRegisterIdent());
+                if (nodeIdent.mSlaveId != ident.mSlaveId
+                    || nodeIdent.mRegisterType != ident.mRegisterType
+                    || nodeIdent.mRegisterNumber < ident.mRegisterNumber
+                    || nodeIdent.mRegisterNumber > lastRegister
+                    || nodeIdent.mNetworkId != ident.mNetworkId)
+                    continue;
+
+                Slot slot;
+                slot.mNode = node;
+                slot.mOffset = nodeIdent.mRegisterNumber - ident.mRegisterNumber;
+                slot.mObjectIndex = i;
+                mSlots.push_back(slot);
+            }
+        }
+
+        group.mSlotCount = mSlots.size() - group.mFirstSlot;
+
+        batches.clear();
+        for(const std::shared_ptr<MqttObject>& obj: it->second) {
+            nodes.clear();
+            obj->collectConvertedNodes(nodes);
+            for(MqttObjectDataNode* node: nodes) {
+                if (!node->getConverter()->hasBatchConversion())
+                    continue;
+                BatchNode bnode;
+                bnode.mNode = node;
+                node->setBatchValue(nullptr);
+                if (getBatchSlot(*node, ident, lastRegister, bnode.mSlot))
+                    batches[node->getConverter()].push_back(bnode);
+            }
+        }
+
+        group.mFirstBatch = mBatches.size();
+        for(auto& bit: batches) {
+            Batch batch;
+            batch.mConverter = bit.first;
+            batch.mFirstNode = mBatchNodes.size();
+            batch.mNodeCount = bit.second.size();
+            mBatchNodes.insert(mBatchNodes.end(), bit.second.begin(), bit.second.end());
+            mBatches.push_back(batch);
+            mMaxBatchSize = std::max(mMaxBatchSize, batch.mNodeCount);
+        }
+        group.mBatchCount = mBatches.size() - group.mFirstBatch;
+
+        mMaxObjectsInGroup = std::max(mMaxObjectsInGroup, it->second.size());
+        mGroups[makeKey(ident.mNetworkId, ident.mSlaveId, ident.mRegisterType, ident.mRegisterNumber)] = group;
+    }
+
+    mBatchValues.clear();
+    mBatchValues.resize(mBatchNodes.size());
+}
+
+const RegisterDispatchIndex::Group*
+RegisterDispatchIndex::findGroup(int pNetworkId, const ModbusSlaveAddressRange& pRange) const {
+    auto it = mGroups.find(makeKey(pNetworkId, pRange.mSlaveId, pRange.mRegisterType, pRange.mRegister));
+    if (it == mGroups.end())
+        return nullptr;
+    return &(it->second);
+}
+
+}
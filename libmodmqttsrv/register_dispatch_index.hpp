@@ -0,0 +1,88 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mqttobject.hpp"
+
+namespace modmqttd {
+
+/**
+ * Flat index from poll group to scalar nodes updated by
+ * MsgRegisterValues read for this group.
+ *
+ * Built once after configuration. Poll group is identified by
+ * network id, slave, register type and first register. Every group
+ * points to a contiguous range of slots with node and register
+ * offset in group, so update does not walk MqttObject trees.
+ *
+ * Nodes with converters that support batch conversion and read
+ * all registers from a single poll group are grouped by converter,
+ * so they can be converted with a single DataConverter::toMqttBatch() call.
+ * */
+class RegisterDispatchIndex {
+    public:
+        typedef std::map<MqttObjectRegisterIdent, std::vector<std::shared_ptr<MqttObject>>, MqttObjectRegisterIdent::Compare> ObjectMap;
+
+        struct Slot {
+            MqttObjectDataNode* mNode;
+            // register number - first register of poll group
+            int mOffset;
+            // index in Group::mObjects
+            int mObjectIndex;
+        };
+
+        struct BatchNode {
+            MqttObjectDataNode* mNode;
+            // registers of mNode in poll group
+            DataConverter::BatchSlot mSlot;
+        };
+
+        // nodes with the same converter in a single poll group
+        struct Batch {
+            const DataConverter* mConverter;
+            std::size_t mFirstNode;
+            std::size_t mNodeCount;
+        };
+
+        struct Group {
+            std::size_t mFirstSlot;
+            std::size_t mSlotCount;
+            std::size_t mFirstBatch;
+            std::size_t mBatchCount;
+            // objects with scalar nodes in this group
+            const std::vector<std::shared_ptr<MqttObject>>* mObjects;
+        };
+
+        void build(const ObjectMap& pObjects);
+
+        // pNetworkId is an id from StringPool::networkNames()
+        const Group* findGroup(int pNetworkId, const ModbusSlaveAddressRange& pRange) const;
+        const Slot& getSlot(std::size_t pIndex) const { return mSlots[pIndex]; }
+        const Batch& getBatch(std::size_t pIndex) const { return mBatches[pIndex]; }
+        const BatchNode& getBatchNode(std::size_t pIndex) const { return mBatchNodes[pIndex]; }
+        // storage for value converted for mBatchNodes[pIndex]
+        MqttValue& getBatchValue(std::size_t pIndex) { return mBatchValues[pIndex]; }
+
+        std::size_t getSlotCount() const { return mSlots.size(); }
+        std::size_t getMaxObjectsInGroup() const { return mMaxObjectsInGroup; }
+        std::size_t getMaxBatchSize() const { return mMaxBatchSize; }
+    private:
+        static uint64_t makeKey(int pNetworkId, int pSlaveId, RegisterType pType, int pRegister);
+        // returns false if pNode registers are not in a single poll group
+        static bool getBatchSlot(const MqttObjectDataNode& pNode, const MqttObjectRegisterIdent& pGroupIdent, int pLastRegister, DataConverter::BatchSlot& pSlotOut);
+
+        std::unordered_map<uint64_t, Group> mGroups;
+        std::vector<Slot> mSlots;
+        std::vector<Batch> mBatches;
+        std::vector<BatchNode> mBatchNodes;
+        // not resized after build(), nodes point to elements
+        std::vector<MqttValue> mBatchValues;
+        std::size_t mMaxObjectsInGroup = 0;
+        std::size_t mMaxBatchSize = 0;
+};
+
+}
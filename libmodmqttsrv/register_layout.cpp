@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "register_layout.hpp"
+
+namespace modmqttd {
+
+boost::log::sources::severity_logger<Log::severity> RegisterLayout::log;
+
+void
+RegisterLayout::load(const std::string& pPath) {
+    mPath = pPath;
+    mLayouts.clear();
+
+    if (!std::filesystem::exists(mPath)) {
+        BOOST_LOG_SEV(log, Log::debug) << "Register layout file " << mPath << " not found, starting with configured poll groups";
+        return;
+    }
+
+    std::ifstream in(mPath);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream str(line);
+        int slave, type, reg, count;
+        if (!(str >> slave >> type >> reg >> count) || type < RegisterType::COIL || type > RegisterType::INPUT) {
+            BOOST_LOG_SEV(log, Log::warn) << "Ignoring invalid line " << lineNumber << " in register layout file " << mPath;
+            continue;
+        }
+
+        ModbusAddressRange group(reg, RegisterType(type), count);
+        std::vector<ModbusAddressRange> parts;
+        std::string part;
+        bool valid = true;
+        while (str >> part) {
+            int partReg, partCount;
+            char sep;
+            std::istringstream pstr(part);
+            if (!(pstr >> partReg >> sep >> partCount) || sep != ':' || partCount <= 0) {
+                valid = false;
+                break;
+            }
+            ModbusAddressRange range(partReg, RegisterType(type), partCount);
+            if (!group.contains(range)) {
+                valid = false;
+                break;
+            }
+            parts.push_back(range);
+        }
+
+        if (!valid || parts.empty()) {
+            BOOST_LOG_SEV(log, Log::warn) << "Ignoring invalid line " << lineNumber << " in register layout file " << mPath;
+            continue;
+        }
+        mLayouts[LayoutKey(slave, type, reg, count)] = parts;
+    }
+    BOOST_LOG_SEV(log, Log::debug) << "Loaded " << mLayouts.size() << " poll group layout(s) from " << mPath;
+}
+
+void
+RegisterLayout::save() const {
+    if (mPath.empty())
+        return;
+
+    std::ofstream out(mPath, std::ios::trunc);
+    for(const auto& layout: mLayouts) {
+        out << std::get<0>(layout.first) << " " << std::get<1>(layout.first) << " "
+            << std::get<2>(layout.first) << " " << std::get<3>(layout.first);
+        for(const ModbusAddressRange& range: layout.second)
+            out << " " << range.mRegister << ":" << range.mCount;
+        out << std::endl;
+    }
+
+    if (!out) {
+        BOOST_LOG_SEV(log, Log::error) << "Failed to write register layout file " << mPath;
+    }
+}
+
+int
+RegisterLayout::apply(std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>& pRegisterMap) const {
+    int ret = 0;
+    if (mLayouts.empty())
+        return ret;
+
+    for(auto& slave: pRegisterMap) {
+        std::vector<std::shared_ptr<RegisterPoll>> result;
+        for(const std::shared_ptr<RegisterPoll>& reg: slave.second) {
+            std::map<LayoutKey, std::vector<ModbusAddressRange>>::const_iterator it = mLayouts.find(
+                LayoutKey(reg->mSlaveId, reg->mRegisterType, reg->mRegister, reg->getCount())
+            );
+            if (it == mLayouts.end()) {
+                result.push_back(reg);
+                continue;
+            }
+            if (!matches(*reg, it->second)) {
+                BOOST_LOG_SEV(log, Log::warn) << "Saved layout of poll group " << reg->mSlaveId << "." << reg->mRegister
+                    << " (" << reg->getCount() << ") does not match configured registers, ignoring";
+                result.push_back(reg);
+                continue;
+            }
+
+            for(const ModbusAddressRange& range: it->second)
+                result.push_back(reg->createPart(range.mRegister, range.mCount));
+            ret++;
+        }
+        slave.second = result;
+    }
+    return ret;
+}
+
+bool
+RegisterLayout::matches(const RegisterPoll& pReg, const std::vector<ModbusAddressRange>& pParts) {
+    // poll without delivery ranges is never split
+    if (pReg.mDeliveryRanges.empty())
+        return false;
+
+    for(std::size_t i = 0; i < pParts.size(); i++) {
+        const ModbusAddressRange& part(pParts[i]);
+        if (i != 0 && pParts[i - 1].lastRegister() >= part.firstRegister())
+            return false;
+
+        bool start = false, end = false;
+        for(const ModbusAddressRange& range: pReg.mDeliveryRanges) {
+            if (range.firstRegister() == part.firstRegister())
+                start = true;
+            if (range.lastRegister() == part.lastRegister())
+                end = true;
+        }
+        if (!start || !end)
+            return false;
+    }
+
+    for(const ModbusAddressRange& range: pReg.mDeliveryRanges) {
+        auto part = std::find_if(pParts.begin(), pParts.end(),
+            [&range](const ModbusAddressRange& p) -> bool { return p.contains(range); });
+        if (part == pParts.end())
+            return false;
+    }
+    return true;
+}
+
+void
+RegisterLayout::update(const RegisterPoll& pOld, const std::vector<std::shared_ptr<RegisterPoll>>& pParts) {
+    std::map<LayoutKey, std::vector<ModbusAddressRange>>::iterator it = mLayouts.begin();
+    for(; it != mLayouts.end(); it++) {
+        ModbusAddressRange group(std::get<2>(it->first), RegisterType(std::get<1>(it->first)), std::get<3>(it->first));
+        if (std::get<0>(it->first) == pOld.mSlaveId && group.contains(pOld))
+            break;
+    }
+
+    if (it == mLayouts.end()) {
+        it = mLayouts.insert(std::make_pair(
+            LayoutKey(pOld.mSlaveId, pOld.mRegisterType, pOld.mRegister, pOld.getCount()),
+            std::vector<ModbusAddressRange>()
+        )).first;
+    }
+
+    std::vector<ModbusAddressRange>& parts(it->second);
+    parts.erase(
+        std::remove_if(parts.begin(), parts.end(),
+            [&pOld](const ModbusAddressRange& range) -> bool { return pOld.contains(range); }),
+        parts.end()
+    );
+    for(const std::shared_ptr<RegisterPoll>& part: pParts)
+        parts.push_back(ModbusAddressRange(part->mRegister, part->mRegisterType, part->getCount()));
+
+    std::sort(parts.begin(), parts.end(), [](const ModbusAddressRange& a, const ModbusAddressRange& b) -> bool {
+        return a.mRegister < b.mRegister;
+    });
+}
+
+}
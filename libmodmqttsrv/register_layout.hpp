@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "logging.hpp"
+#include "modbus_types.hpp"
+#include "register_poll.hpp"
+
+namespace modmqttd {
+
+/**
+ * Reads learned by splitting coalesced poll groups
+ * rejected by slave with illegal data address exception.
+ *
+ * Layout is stored in a text file, one poll group per line:
+ *
+ * slave type register count part_register:part_count ...
+ *
+ * Poll group is identified by its configured range, if configuration
+ * changes then it will not match and slave is probed again.
+ * */
+class RegisterLayout {
+    public:
+        void load(const std::string& pPath);
+        void save() const;
+        const std::string& getPath() const { return mPath; }
+        bool empty() const { return mLayouts.empty(); }
+
+        /**
+         * Replace poll groups with parts learned earlier.
+         * Returns number of replaced poll groups.
+         * */
+        int apply(std::map<int, std::vector<std::shared_ptr<RegisterPoll>>>& pRegisterMap) const;
+
+        // store pParts in place of pOld, that could be a part of configured poll group
+        void update(const RegisterPoll& pOld, const std::vector<std::shared_ptr<RegisterPoll>>& pParts);
+    private:
+        static boost::log::sources::severity_logger<Log::severity> log;
+
+        /**
+         * Returns false if pParts do not match delivery ranges of pReg,
+         * every part must start and end at delivery range boundary
+         * and every delivery range must be read by a single part.
+         * */
+        static bool matches(const RegisterPoll& pReg, const std::vector<ModbusAddressRange>& pParts);
+
+        // slave, register type, register, count
+        typedef std::tuple<int, int, int, int> LayoutKey;
+
+        std::string mPath;
+        std::map<LayoutKey, std::vector<ModbusAddressRange>> mLayouts;
+};
+
+}
@@ -1,9 +1,16 @@
+#include <algorithm>
+
 #include "register_poll.hpp"
 
 namespace modmqttd {
 
 constexpr std::chrono::steady_clock::duration RegisterPoll::DurationBetweenLogError;
 
+#if __cplusplus < 201703L
+constexpr int RegisterWrite::MAX_WRITE_REGISTERS;
+constexpr int RegisterWrite::MAX_WRITE_BITS;
+#endif
+
 void
 RegisterCommand::setMaxRetryCounts(short pMaxRead, short pMaxWrite, bool pForce) {
     if (pMaxRead != 0 || pForce)
@@ -23,4 +30,89 @@ RegisterPoll::RegisterPoll(int pSlaveId, int pRegNum, RegisterType pRegType, int
     mFirstErrorTime = std::chrono::steady_clock::now();
 };
 
+std::shared_ptr<RegisterPoll>
+RegisterPoll::createPart(int pRegister, int pCount) const {
+    std::shared_ptr<RegisterPoll> ret(new RegisterPoll(
+        mSlaveId, pRegister, mRegisterType, pCount,
+        std::chrono::duration_cast<std::chrono::milliseconds>(mRefresh),
+        mPublishMode
+    ));
+
+    ret->setDelayBeforeCommand(mDelayBeforeCommand);
+    ret->setDelayBeforeFirstCommand(mDelayBeforeFirstCommand);
+    ret->setMaxRetryCounts(mMaxReadRetryCount, mMaxWriteRetryCount, true);
+    ret->mReadErrors = mReadErrors;
+    ret->mFirstErrorTime = mFirstErrorTime;
+
+    for(const ModbusAddressRange& range: mDeliveryRanges) {
+        if (ret->contains(range))
+            ret->mDeliveryRanges.push_back(range);
+    }
+
+    if (hasDeadbands()) {
+        auto first = mDeadbands.begin() + (pRegister - mRegister);
+        ret->mDeadbands.assign(first, first + pCount);
+    }
+
+    // part is equal to a single poll group known by MqttClient
+    if (ret->mDeliveryRanges.size() == 1 && ret->mDeliveryRanges.front().isSameAs(*ret))
+        ret->mDeliveryRanges.clear();
+
+    return ret;
+}
+
+bool
+RegisterPoll::isInsideDeadband(const std::vector<uint16_t>& newValues, int pOffset, int pCount) const {
+    if (!hasDeadbands())
+        return false;
+
+    for(int i = pOffset; i < pOffset + pCount; i++) {
+        if (!mDeadbands[i].isInside(mLastValues[i], newValues[i]))
+            return false;
+    }
+    return true;
+}
+
+std::vector<std::shared_ptr<RegisterPoll>>
+RegisterPoll::bisect() const {
+    std::vector<std::shared_ptr<RegisterPoll>> ret;
+    if (!canBisect())
+        return ret;
+
+    std::size_t middle = mDeliveryRanges.size() / 2;
+    const ModbusAddressRange& firstFirst = mDeliveryRanges.front();
+    const ModbusAddressRange& firstLast = mDeliveryRanges[middle - 1];
+    const ModbusAddressRange& secondFirst = mDeliveryRanges[middle];
+    const ModbusAddressRange& secondLast = mDeliveryRanges.back();
+
+    ret.push_back(createPart(firstFirst.mRegister, firstLast.lastRegister() - firstFirst.mRegister + 1));
+    ret.push_back(createPart(secondFirst.mRegister, secondLast.lastRegister() - secondFirst.mRegister + 1));
+
+    return ret;
+}
+
+bool
+RegisterWrite::merge(const RegisterWrite& pOther) {
+    if (mRegisterType != pOther.mRegisterType)
+        return false;
+    if (!overlaps(pOther) && !isConsecutiveOf(pOther))
+        return false;
+
+    int first = std::min(firstRegister(), pOther.firstRegister());
+    int last = std::max(lastRegister(), pOther.lastRegister());
+    int maxCount = mRegisterType == RegisterType::COIL ? MAX_WRITE_BITS : MAX_WRITE_REGISTERS;
+    if (last - first + 1 > maxCount)
+        return false;
+
+    std::vector<uint16_t> values(last - first + 1);
+    std::copy(getValues().begin(), getValues().end(), values.begin() + (mRegister - first));
+    std::copy(pOther.getValues().begin(), pOther.getValues().end(), values.begin() + (pOther.mRegister - first));
+
+    mValues = ModbusRegisters(values);
+    mRegister = first;
+    mCount = values.size();
+    mReturnMessages.insert(mReturnMessages.end(), pOther.mReturnMessages.begin(), pOther.mReturnMessages.end());
+    return true;
+}
+
 } // namespace
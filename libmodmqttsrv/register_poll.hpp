@@ -65,7 +65,32 @@ class RegisterPoll : public RegisterCommand {
         virtual bool executedOk() const { return mLastReadOk; };
 
 
-        void update(const std::vector<uint16_t> newValues) { mLastValues = newValues; mCount = newValues.size(); }
+        void update(const std::vector<uint16_t>& newValues) { mLastValues = newValues; mCount = newValues.size(); }
+        // update pCount values starting at pOffset, used if only a part of values was sent
+        void updateRange(const std::vector<uint16_t>& newValues, int pOffset, int pCount) {
+            std::copy(newValues.begin() + pOffset, newValues.begin() + pOffset + pCount, mLastValues.begin() + pOffset);
+        }
+
+        bool hasDeadbands() const { return !mDeadbands.empty(); }
+        /**
+         * Returns true if all pCount values starting at pOffset
+         * differ from the last sent values not more than register deadband allows.
+         * */
+        bool isInsideDeadband(const std::vector<uint16_t>& newValues, int pOffset, int pCount) const;
+
+        /**
+         * Create poll for a part of this register range with the same
+         * poll settings. Only delivery ranges contained in the part are kept.
+         * */
+        std::shared_ptr<RegisterPoll> createPart(int pRegister, int pCount) const;
+
+        // coalesced read can be split only at delivery range boundaries
+        bool canBisect() const { return mDeliveryRanges.size() > 1; }
+        /**
+         * Split coalesced read in two reads at the middle delivery range
+         * boundary. Registers in gap between both parts are not read.
+         * */
+        std::vector<std::shared_ptr<RegisterPoll>> bisect() const;
 
         std::chrono::steady_clock::duration mRefresh;
 
@@ -75,13 +100,36 @@ class RegisterPoll : public RegisterCommand {
         int mReadErrors;
         std::chrono::steady_clock::time_point mFirstErrorTime;
 
+        // retries done after failed pipelined read, the rest of
+        // mMaxReadRetryCount is left for ModbusExecutor retry counter
+        short mPipelinedRetryCount = 0;
+
+        // values were never sent to MqttClient, mLastValues
+        // cannot be used to detect changes
+        bool mFirstPoll = true;
+
         PublishMode mPublishMode = PublishMode::ON_CHANGE;
+
+        // see MsgRegisterPoll::mDeliveryRanges
+        std::vector<ModbusAddressRange> mDeliveryRanges;
+
+        // deadband for every register in this poll or
+        // empty if all changes should be sent
+        std::vector<RegisterDeadband> mDeadbands;
+
+        // set by ModbusExecutor if slave rejected coalesced read
+        // with illegal data address exception
+        bool mSplitRequired = false;
     private:
         std::vector<uint16_t> mLastValues;
 };
 
 class RegisterWrite : public RegisterCommand {
     public:
+        // modbus protocol limits for a single write command
+        static constexpr int MAX_WRITE_REGISTERS = 123;
+        static constexpr int MAX_WRITE_BITS = 1968;
+
         RegisterWrite(const MsgRegisterValues& msg)
             : RegisterCommand(msg.mSlaveId, msg.mRegister, msg.mRegisterType, msg.mRegisters.getCount()),
               mCreationTime(msg.getCreationTime()),
@@ -98,12 +146,22 @@ class RegisterWrite : public RegisterCommand {
         virtual const std::vector<uint16_t>& getValues() const { return mValues.values(); }
         virtual bool executedOk() const { return mLastWriteOk; };
 
+        /**
+         * Merge values of a write queued after this one if both ranges
+         * overlap or are consecutive. pOther values take precedence.
+         * Returns false if merged write would not fit in a single
+         * modbus command.
+         * */
+        bool merge(const RegisterWrite& pOther);
+
         ModbusRegisters mValues;
 
         bool mLastWriteOk = false;
         std::chrono::steady_clock::time_point mCreationTime;
 
-        std::shared_ptr<MsgRegisterValues> mReturnMessage;
+        // sent back with written values for every
+        // command merged into this write
+        std::vector<std::shared_ptr<MsgRegisterValues>> mReturnMessages;
 };
 
 } //namespace
@@ -0,0 +1,54 @@
+#include <cassert>
+
+#include "string_pool.hpp"
+
+namespace modmqttd {
+
+StringPool&
+StringPool::networkNames() {
+    static StringPool pool;
+    return pool;
+}
+
+StringPool&
+StringPool::keyNames() {
+    static StringPool pool;
+    return pool;
+}
+
+int
+StringPool::intern(const std::string& pValue) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto it = mIds.find(pValue);
+    if (it != mIds.end())
+        return it->second;
+
+    int id = mStrings.size();
+    it = mIds.insert(std::make_pair(pValue, id)).first;
+    mStrings.push_back(&(it->first));
+    return id;
+}
+
+int
+StringPool::find(const std::string& pValue) const {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto it = mIds.find(pValue);
+    if (it == mIds.end())
+        return NOT_FOUND;
+    return it->second;
+}
+
+const std::string&
+StringPool::get(int pId) const {
+    std::unique_lock<std::mutex> lock(mMutex);
+    assert(pId >= 0 && pId < int(mStrings.size()));
+    return *mStrings[pId];
+}
+
+std::size_t
+StringPool::size() const {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mStrings.size();
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace modmqttd {
+
+/**
+ * Keeps a single copy of strings repeated in many MqttObjects
+ * like modbus network names and json key names.
+ *
+ * Interned string gets a small integer id that is cheaper
+ * to store and compare than the string itself.
+ * References returned by intern() and get() stay valid for the
+ * process lifetime.
+ * */
+class StringPool {
+    public:
+        static constexpr int NOT_FOUND = -1;
+
+        // pool of modbus network names
+        static StringPool& networkNames();
+        // pool of json key names for MqttObjectDataNode
+        static StringPool& keyNames();
+
+        int intern(const std::string& pValue);
+        // returns NOT_FOUND if pValue was never interned
+        int find(const std::string& pValue) const;
+        const std::string& get(int pId) const;
+        std::size_t size() const;
+    private:
+        mutable std::mutex mMutex;
+        // map nodes are never moved, mStrings point to their keys
+        std::unordered_map<std::string, int> mIds;
+        std::vector<const std::string*> mStrings;
+};
+
+}
@@ -39,6 +39,21 @@ struct YAML::convert<modmqttd::ModbusNetworkConfig::RtuRtsMode> {
     }
 };
 
+template<>
+struct YAML::convert<modmqttd::ModbusNetworkConfig::WriteOverflowPolicy> {
+    static bool decode(const YAML::Node& node, modmqttd::ModbusNetworkConfig::WriteOverflowPolicy& rhs) {
+        auto str = node.as<std::string>();
+        if (str == "drop_oldest") {
+            rhs = modmqttd::ModbusNetworkConfig::WriteOverflowPolicy::DROP_OLDEST;
+        } else if (str == "drop_newest") {
+            rhs = modmqttd::ModbusNetworkConfig::WriteOverflowPolicy::DROP_NEWEST;
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
 template<>
 struct YAML::convert<std::chrono::milliseconds> {
     static bool decode(const YAML::Node& node, std::chrono::milliseconds& value) {
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <bit>
+#include <cctype>
+#include <string>
+
+#include <sol/sol.hpp>
+#include "libmodmqttconv/convexception.hpp"
+#include "libmodmqttconv/converter.hpp"
+
+/**
+ * Lua state shared by all LuaConverter instances of the plugin.
+ *
+ * Every expression is compiled once into a function with its own
+ * global environment. Register values are passed to the function
+ * in a preallocated table. A prologue added to the expression copies
+ * registers used by the expression to R<n> locals, so there are
+ * no string keys and no global writes on the hot path.
+ *
+ * Other R<n> lookups, like _G["R" .. n], are resolved on demand by
+ * __index of the global table shared by all environments. rawget()
+ * bypasses __index, so rawget(_G, "R0") returns nil.
+ *
+ * mRegisters is a single table reused by every call(), a LuaState
+ * must not be used by many threads at once.
+ * */
+class LuaState {
+public:
+    static const int MAX_REGISTERS = 20;
+
+    LuaState() {
+        // open common libraries
+        mLua.open_libraries(
+            sol::lib::base,
+            sol::lib::math,
+            sol::lib::string,
+            sol::lib::table,
+            sol::lib::utf8
+        );
+
+        // add user-defined functions
+        mLua.set_function("int32",    int32);
+        mLua.set_function("int32be",  int32be);
+        mLua.set_function("uint32",   uint32);
+        mLua.set_function("uint32be", uint32be);
+        mLua.set_function("flt32",    flt32);
+        mLua.set_function("flt32be",  flt32be);
+        mLua.set_function("int16",    int16);
+        mLua.set_function("bit_positions", bit_positions);
+
+        mRegisters = mLua.create_table(MAX_REGISTERS, 0);
+        for (int i = 1; i <= MAX_REGISTERS; i++) {
+            mRegisters.raw_set(i, 0.0);
+        }
+
+        // copy of globals, so library functions are found
+        // without calling register lookup function
+        mGlobals = mLua.create_table();
+        for (const auto& entry: mLua.globals())
+            mGlobals.raw_set(entry.first, entry.second);
+
+        sol::protected_function lookup = mLua.load(
+            "local registers, count = ...; "
+            "local index = {}; "
+            "for i = 0, count - 1 do index['R' .. i] = i + 1 end; "
+            "return function(_, key) local n = index[key]; if n then return registers[n] end end"
+        );
+        sol::function registerLookup = lookup(mRegisters, MAX_REGISTERS);
+        sol::table meta = mLua.create_table();
+        meta["__index"] = registerLookup;
+        mGlobals[sol::metatable_key] = meta;
+    }
+
+    sol::protected_function compile(const std::string& pExpression) {
+        sol::load_result chunk = mLua.load(getPrologue(pExpression) + pExpression, pExpression);
+        if (!chunk.valid()) {
+            sol::error err = chunk;
+            throw ConvException(std::string("Lua compile error: ") + err.what());
+        }
+
+        sol::protected_function ret = chunk;
+        // globals set by expression are not visible in other expressions
+        sol::environment env(mLua, sol::create, mGlobals);
+        env.raw_set("_G", env);
+        sol::set_environment(env, ret);
+        return ret;
+    }
+
+    sol::protected_function_result call(const sol::protected_function& pFunction, const ModbusRegisters& pData) {
+        if (pData.getCount() > MAX_REGISTERS)
+            throw ConvException("Maximum " + std::to_string(MAX_REGISTERS) + " registers allowed");
+
+        for (int i = 0; i < pData.getCount(); i++) {
+            mRegisters.raw_set(i + 1, double(pData.getValue(i)));
+        }
+        // registers not passed to this call are 0 for every expression,
+        // mRegisters may still hold values set for another converter
+        for (int i = pData.getCount(); i < mBoundCount; i++) {
+            mRegisters.raw_set(i + 1, 0.0);
+        }
+        mBoundCount = pData.getCount();
+
+        return pFunction(mRegisters);
+    }
+
+private:
+    sol::state mLua;
+    sol::table mRegisters;
+    // number of mRegisters set by last call()
+    int mBoundCount = 0;
+    // globals with register lookup, used as __index of every environment
+    sol::table mGlobals;
+
+    /**
+     * local R0, R3 = __registers[1], __registers[4];
+     * for registers used in pExpression, in a single line, so
+     * line numbers in Lua errors match user expression
+     * */
+    static std::string getPrologue(const std::string& pExpression) {
+        std::string names, values;
+        for (int i = 0; i < MAX_REGISTERS; i++) {
+            std::string name("R" + std::to_string(i));
+            if (!containsName(pExpression, name))
+                continue;
+            if (!names.empty()) {
+                names += ",";
+                values += ",";
+            }
+            names += name;
+            values += "__registers[" + std::to_string(i + 1) + "]";
+        }
+        std::string ret("local __registers = ...; ");
+        if (!names.empty())
+            ret += "local " + names + " = " + values + "; ";
+        return ret;
+    }
+
+    // true if pName is used as a separate word
+    static bool containsName(const std::string& pExpression, const std::string& pName) {
+        auto isNameChar = [](char c) -> bool { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+        for (std::size_t pos = pExpression.find(pName); pos != std::string::npos; pos = pExpression.find(pName, pos + 1)) {
+            std::size_t end = pos + pName.length();
+            if ((pos == 0 || !isNameChar(pExpression[pos - 1])) && (end == pExpression.length() || !isNameChar(pExpression[end])))
+                return true;
+        }
+        return false;
+    }
+
+    static double int32(double high, double low) {
+        return ConverterTools::toNumber<int32_t>(high, low, true);
+    }
+
+    static double int32be(double high, double low) {
+        return ConverterTools::toNumber<int32_t>(high, low);
+    }
+
+    static double uint32(double high, double low) {
+        return ConverterTools::toNumber<uint32_t>(high, low, true);
+    }
+
+    static double uint32be(double high, double low) {
+        return ConverterTools::toNumber<uint32_t>(high, low);
+    }
+
+    static double flt32(double high, double low) {
+        return ConverterTools::toNumber<float>(high, low, true);
+    }
+
+    static double flt32be(double high, double low) {
+        return ConverterTools::toNumber<float>(high, low);
+    }
+
+    static double int16(double val) {
+        uint16_t tmp = uint16_t(val);
+        return static_cast<int16_t>(tmp);
+    }
+
+    /// Return a comma-separated list of bit positions set to 1 in the argument.
+    /// E.g. for bit_positions(6) returns "1,2"
+    /// E.g. for bit_positions(6, 1) returns "2,3"
+    static std::string bit_positions(uint64_t value, int lsb_base = 0) {
+        std::string result;
+        while (value != 0) {
+            unsigned bit = std::countr_zero(value);
+            if (!result.empty()) {
+                result += ",";
+            }
+            result += std::to_string(static_cast<int>(bit) + lsb_base);
+            value &= ~(uint64_t(1) << bit);
+        }
+        return result;
+    }
+};
@@ -4,7 +4,9 @@
 DataConverter*
 LuaConvPlugin::getConverter(const std::string& name) {
     if(name == "evaluate") {
-        return new LuaConverter();
+        if (mState == nullptr)
+            mState.reset(new LuaState());
+        return new LuaConverter(mState);
     }
     return nullptr;
 }
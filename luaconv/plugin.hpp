@@ -1,15 +1,25 @@
 #pragma once
 
+#include <memory>
+
 #include <boost/config.hpp> // for BOOST_SYMBOL_EXPORT
 
 #include "libmodmqttconv/converterplugin.hpp"
 
+class LuaState;
+
 class LuaConvPlugin : ConverterPlugin {
     public:
         virtual std::string getName() const { return "lua"; }
         virtual DataConverter* getConverter(const std::string& name);
         virtual ~LuaConvPlugin() {}
+    private:
+        // shared by all converters, created on first request
+        std::shared_ptr<LuaState> mState;
 };
 
 extern "C" BOOST_SYMBOL_EXPORT LuaConvPlugin converter_plugin;
 LuaConvPlugin converter_plugin;
+
+extern "C" BOOST_SYMBOL_EXPORT const int converter_api_version;
+const int converter_api_version = MODMQTT_CONVERTER_API_VERSION;
@@ -19,6 +19,32 @@ class FloatConverter : public DataConverter {
             return MqttValue::fromDouble(val, mPrecision);
         }
 
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const {
+            const int hb = mLowFirst ? 1 : 0;
+            const int lb = 1 - hb;
+            union {
+                uint32_t in_value;
+                float out_value;
+            } CastData;
+
+            for(std::size_t i = 0; i < slots.size(); i++) {
+                if (slots[i].mCount < 2)
+                    throw ConvException("Cannot read 32-bit float from single register");
+
+                const uint16_t* regs = registers.data() + slots[i].mOffset;
+                uint16_t high = regs[hb];
+                uint16_t low = regs[lb];
+                if (mSwapBytes) {
+                    high = ConverterTools::swapByteOrder(high);
+                    low = ConverterTools::swapByteOrder(low);
+                }
+                CastData.in_value = (uint32_t(high) << 16) | low;
+                out[i] = MqttValue::fromDouble(CastData.out_value, mPrecision);
+            }
+        }
+
+        virtual bool hasBatchConversion() const { return true; }
+
         virtual ModbusRegisters toModbus(const MqttValue& value, int registerCount) const {
             if (registerCount < 2)
                 throw ConvException("Cannot store float in single register");
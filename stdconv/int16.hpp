@@ -17,6 +17,14 @@ class Int16Converter : public DataConverter {
             return MqttValue::fromInt((int16_t)val);
         }
 
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const {
+            for(std::size_t i = 0; i < slots.size(); i++) {
+                out[i] = MqttValue::fromInt((int16_t)registers[slots[i].mOffset]);
+            }
+        }
+
+        virtual bool hasBatchConversion() const { return true; }
+
         virtual ModbusRegisters toModbus(const MqttValue& value, int registerCount) const {
             ModbusRegisters ret;
             int32_t val = value.getInt();
@@ -10,6 +10,20 @@ class Int32Converter : public DataConverter {
             return MqttValue::fromInt(val);
         }
 
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const {
+            const int high = mLowFirst ? 1 : 0;
+            const int low = 1 - high;
+            for(std::size_t i = 0; i < slots.size(); i++) {
+                const uint16_t* regs = registers.data() + slots[i].mOffset;
+                int32_t val = regs[0];
+                if (slots[i].mCount > 1)
+                    val = int32_t((uint32_t(regs[high]) << 16) | regs[low]);
+                out[i] = MqttValue::fromInt(val);
+            }
+        }
+
+        virtual bool hasBatchConversion() const { return true; }
+
         virtual ModbusRegisters toModbus(const MqttValue& value, int registerCount) const {
             return ConverterTools::int32ToRegisters(value.getInt(), mLowFirst, registerCount);
         }
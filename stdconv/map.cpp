@@ -248,6 +248,43 @@ void
 MapConverter::parseMap(const std::string& pStrMap) {
     MapParser p;
     p.parse(mMappings, pStrMap);
+    buildLookup();
+}
+
+void
+MapConverter::buildLookup() {
+    mMqttValues.clear();
+    mDenseIndex.clear();
+    mSortedIndex.clear();
+
+    if (mMappings.empty())
+        return;
+
+    uint16_t minKey = UINT16_MAX;
+    uint16_t maxKey = 0;
+    for (std::size_t i = 0; i < mMappings.size(); i++) {
+        const Mapping& mapping(mMappings[i]);
+        if (mapping.isInt())
+            mMqttValues.push_back(MqttValue::fromInt(mapping.getIntMqttValue()));
+        else
+            mMqttValues.push_back(MqttValue::fromString(mapping.getStrMqttValue()));
+
+        minKey = std::min(minKey, mapping.mRegisterValue);
+        maxKey = std::max(maxKey, mapping.mRegisterValue);
+        mSortedIndex.push_back(std::make_pair(mapping.mRegisterValue, uint32_t(i)));
+    }
+
+    // direct index if it is not much bigger than number of mappings
+    std::size_t range = std::size_t(maxKey) - minKey + 1;
+    if (range <= mMappings.size() * MAX_DENSE_GAP_RATIO) {
+        mDenseBase = minKey;
+        mDenseIndex.resize(range, 0);
+        for (const auto& entry: mSortedIndex)
+            mDenseIndex[entry.first - minKey] = entry.second + 1;
+        mSortedIndex.clear();
+    } else {
+        std::sort(mSortedIndex.begin(), mSortedIndex.end());
+    }
 }
 
 std::vector<MapConverter::Mapping>::const_iterator
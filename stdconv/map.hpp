@@ -14,15 +14,13 @@ class MapConverter : public DataConverter {
             if (data.getCount() != 1)
                 throw ConvException("Cannot map multiple registers");
 
-            std::vector<Mapping>::const_iterator it = mMappings.findRegValue(data.getValue(0));
-            if (it == mMappings.end()) {
+            const MqttValue* mapped = findMqttValue(data.getValue(0));
+            if (mapped == nullptr) {
                 return MqttValue::fromInt(data.getValue(0));
             }
 
-            if (it->isInt())
-                return MqttValue::fromInt(it->getIntMqttValue());
-            else
-                return MqttValue::fromString(it->getStrMqttValue());
+            // string buffer is shared, not copied
+            return *mapped;
         }
 
         virtual ModbusRegisters toModbus(const MqttValue& value, int registerCount) const {
@@ -123,6 +121,38 @@ class MapConverter : public DataConverter {
         // register value to mqtt value
         Map mMappings;
         void parseMap(const std::string& pStrMap);
+
+        /**
+         * Lookup tables built from mMappings after parsing.
+         * If register values are close to each other then
+         * mDenseIndex holds mMqttValues index + 1 for every
+         * register value from mDenseBase, 0 if value is not mapped.
+         * Otherwise mSortedIndex is searched with binary search.
+         * */
+        static const int MAX_DENSE_GAP_RATIO = 4;
+        std::vector<MqttValue> mMqttValues;
+        uint16_t mDenseBase = 0;
+        std::vector<uint32_t> mDenseIndex;
+        std::vector<std::pair<uint16_t, uint32_t>> mSortedIndex;
+        void buildLookup();
+
+        const MqttValue* findMqttValue(uint16_t pRegValue) const {
+            if (!mDenseIndex.empty()) {
+                if (pRegValue < mDenseBase)
+                    return nullptr;
+                std::size_t pos = pRegValue - mDenseBase;
+                if (pos >= mDenseIndex.size() || mDenseIndex[pos] == 0)
+                    return nullptr;
+                return &mMqttValues[mDenseIndex[pos] - 1];
+            }
+
+            std::vector<std::pair<uint16_t, uint32_t>>::const_iterator it = std::lower_bound(
+                mSortedIndex.begin(), mSortedIndex.end(), std::make_pair(pRegValue, uint32_t(0))
+            );
+            if (it == mSortedIndex.end() || it->first != pRegValue)
+                return nullptr;
+            return &mMqttValues[it->second];
+        }
 };
 
 class MapParser {
@@ -13,3 +13,6 @@ class StdConvPlugin : ConverterPlugin {
 
 extern "C" BOOST_SYMBOL_EXPORT StdConvPlugin converter_plugin;
 StdConvPlugin converter_plugin;
+
+extern "C" BOOST_SYMBOL_EXPORT const int converter_api_version;
+const int converter_api_version = MODMQTT_CONVERTER_API_VERSION;
@@ -14,6 +14,18 @@ class ScaleConverter : public DataConverter {
             return MqttValue::fromDouble(targetValue, precision);
         }
 
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const {
+            for(std::size_t i = 0; i < slots.size(); i++) {
+                double sourceValue = registers[slots[i].mOffset];
+                double targetValue = (targetScaleTo - targetScaleFrom)
+                    * (sourceValue - sourceScaleFrom)/(sourceScaleTo - sourceScaleFrom)
+                    + targetScaleFrom;
+                out[i] = MqttValue::fromDouble(targetValue, precision);
+            }
+        }
+
+        virtual bool hasBatchConversion() const { return true; }
+
         virtual void setArgs(const std::vector<std::string>& args) {
             sourceScaleFrom = ConverterTools::getDoubleArg(0, args);
             sourceScaleTo = ConverterTools::getDoubleArg(1, args);
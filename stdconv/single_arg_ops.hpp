@@ -41,6 +41,22 @@ class SingleArgMathConverter : public DataConverter {
         bool mLowFirst = false;
 
         virtual double doMath(double value) const = 0;
+
+        // toMqttBatch() for derived classes, pMath must do the same as doMath()
+        template <typename Math>
+        void convertBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out, Math pMath) const {
+            const int high = mLowFirst ? 1 : 0;
+            const int low = 1 - high;
+            for(std::size_t i = 0; i < slots.size(); i++) {
+                const uint16_t* regs = registers.data() + slots[i].mOffset;
+                double val;
+                if (slots[i].mCount == 1)
+                    val = regs[0];
+                else
+                    val = int32_t((uint32_t(regs[high]) << 16) | regs[low]);
+                out[i] = MqttValue::fromDouble(pMath(val), mPrecision);
+            }
+        }
 };
 
 
@@ -49,6 +65,13 @@ class DivideConverter : public SingleArgMathConverter {
         DivideConverter() : SingleArgMathConverter(MqttValue::NO_PRECISION) {}
         virtual ~DivideConverter() {}
 
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const {
+            const double divisor = mDoubleArg;
+            convertBatch(registers, slots, out, [divisor](double value) -> double { return value / divisor; });
+        }
+
+        virtual bool hasBatchConversion() const { return true; }
+
     protected:
         double doMath(double value) const {
             return value / mDoubleArg;
@@ -61,6 +84,13 @@ class MultiplyConverter : public SingleArgMathConverter {
         MultiplyConverter(): SingleArgMathConverter(0) {}
         virtual ~MultiplyConverter() {}
 
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValue> out) const {
+            const double multiplier = mDoubleArg;
+            convertBatch(registers, slots, out, [multiplier](double value) -> double { return value * multiplier; });
+        }
+
+        virtual bool hasBatchConversion() const { return true; }
+
     protected:
         double doMath(double value) const {
             return value * mDoubleArg;
@@ -0,0 +1,74 @@
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/converter_v2_adapter.hpp"
+
+class TestConverterV2 : public DataConverterV2 {
+    public:
+        virtual MqttValueV2 toMqtt(const ModbusRegisters& data) const {
+            if (data.getCount() == 1)
+                return MqttValueV2::fromInt(data.getValue(0));
+            return MqttValueV2::fromString(std::string("registers:") + std::to_string(data.getCount()));
+        }
+
+        virtual ModbusRegisters toModbus(const MqttValueV2& value, int registerCount) const {
+            return ModbusRegisters(value.getUInt16() + 1);
+        }
+
+        virtual void toMqttBatch(std::span<const uint16_t> registers, std::span<const BatchSlot> slots, std::span<MqttValueV2> out) const {
+            for(std::size_t i = 0; i < slots.size(); i++)
+                out[i] = MqttValueV2::fromDouble(registers[slots[i].mOffset] / 10.0, 1);
+        }
+
+        virtual bool hasBatchConversion() const { return true; }
+};
+
+TEST_CASE ("Converter API version 2 adapter") {
+
+    SECTION("should convert register values to current MqttValue") {
+        modmqttd::DataConverterV2Adapter conv(new TestConverterV2(), MODMQTT_CONVERTER_API_VERSION_V2);
+
+        REQUIRE(conv.toMqtt(ModbusRegisters(7)).getInt() == 7);
+        REQUIRE(conv.toMqtt(ModbusRegisters({1, 2, 3})).getString() == "registers:3");
+    }
+
+    SECTION("should convert current MqttValue to registers") {
+        modmqttd::DataConverterV2Adapter conv(new TestConverterV2(), MODMQTT_CONVERTER_API_VERSION_V2);
+
+        ModbusRegisters ret(conv.toModbus(MqttValue::fromString("41"), 1));
+        REQUIRE(ret.getValue(0) == 42);
+    }
+
+    SECTION("should copy long binary values") {
+        std::string data(100, 'x');
+        MqttValueV2 v2(MqttValueV2::fromString(data));
+
+        REQUIRE(modmqttd::DataConverterV2Adapter::fromV2(v2).getString() == data);
+        REQUIRE(modmqttd::DataConverterV2Adapter::toV2(MqttValue::fromString(data)).getString() == data);
+    }
+
+    SECTION("should use batch conversion of version 2 converter") {
+        modmqttd::DataConverterV2Adapter conv(new TestConverterV2(), MODMQTT_CONVERTER_API_VERSION_V2);
+        REQUIRE(conv.hasBatchConversion());
+
+        std::vector<uint16_t> registers({15, 0, 27});
+        std::vector<DataConverter::BatchSlot> slots({{0, 1}, {2, 1}});
+        std::vector<MqttValue> out(2);
+        conv.toMqttBatch(registers, slots, out);
+
+        REQUIRE(out[0].getString() == "1.5");
+        REQUIRE(out[1].getString() == "2.7");
+    }
+
+    SECTION("should not call batch methods missing in version 1 converter") {
+        modmqttd::DataConverterV2Adapter conv(new TestConverterV2(), MODMQTT_CONVERTER_API_VERSION_V1);
+        REQUIRE(!conv.hasBatchConversion());
+
+        std::vector<uint16_t> registers({15, 0, 27});
+        std::vector<DataConverter::BatchSlot> slots({{0, 1}, {2, 1}});
+        std::vector<MqttValue> out(2);
+        conv.toMqttBatch(registers, slots, out);
+
+        REQUIRE(out[0].getInt() == 15);
+        REQUIRE(out[1].getInt() == 27);
+    }
+}
@@ -181,5 +181,26 @@ TEST_CASE("ExprConv: 20 registers should be processed by exprtk") {
     REQUIRE(output.getString() == "210");
 }
 
+TEST_CASE("ExprConv: converters with the same expression should not share register values") {
+    std::string stdconv_path = "../exprconv/exprconv.so";
+    std::shared_ptr<ConverterPlugin> plugin = boost_dll_import<ConverterPlugin>(
+        stdconv_path,
+        "converter_plugin",
+        boost::dll::load_mode::append_decorations
+    );
+    std::shared_ptr<DataConverter> first(plugin->getConverter("evaluate"));
+    std::shared_ptr<DataConverter> second(plugin->getConverter("evaluate"));
+    std::shared_ptr<DataConverter> precise(plugin->getConverter("evaluate"));
+
+    first->setArgs({"R0 + R1"});
+    second->setArgs({"R0 + R1"});
+    precise->setArgs({"R0 + R1", "2"});
+
+    REQUIRE(first->toMqtt(ModbusRegisters({1, 2})).getString() == "3");
+    REQUIRE(second->toMqtt(ModbusRegisters({10, 20})).getString() == "30");
+    REQUIRE(precise->toMqtt(ModbusRegisters({1, 2})).getString() == "3.00");
+    // R1 from previous call is not used
+    REQUIRE(first->toMqtt(ModbusRegisters(5)).getString() == "5");
+}
 
 #endif
@@ -1,6 +1,7 @@
 #include <boost/dll/import.hpp>
 #include <catch2/catch_all.hpp>
 #include "libmodmqttconv/converterplugin.hpp"
+#include "libmodmqttconv/convexception.hpp"
 #include "libmodmqttsrv/config.hpp"
 
 TEST_CASE ("LuaConv: A number should be converted by Lua") {
@@ -287,3 +288,61 @@ TEST_CASE("LuaConv: 20 registers should be processed") {
 
     REQUIRE(output.getString() == "210");
 }
+
+TEST_CASE("LuaConv: converters should not share register values and globals") {
+    std::string stdconv_path = "../luaconv/luaconv.so";
+    std::shared_ptr<ConverterPlugin> plugin = boost_dll_import<ConverterPlugin>(
+        stdconv_path,
+        "converter_plugin",
+        boost::dll::load_mode::append_decorations
+    );
+    std::shared_ptr<DataConverter> first(plugin->getConverter("evaluate"));
+    std::shared_ptr<DataConverter> second(plugin->getConverter("evaluate"));
+
+    first->setArgs({"counter = (counter or 0) + 1; return R0 + R1 + counter"});
+    second->setArgs({"counter = (counter or 0) + 100; return R0 + R1 + counter"});
+
+    REQUIRE(first->toMqtt(ModbusRegisters({1, 2})).getString() == "4");
+    REQUIRE(second->toMqtt(ModbusRegisters({10, 20})).getString() == "130");
+    // R1 from previous call is not used
+    REQUIRE(first->toMqtt(ModbusRegisters(5)).getString() == "7");
+}
+
+TEST_CASE("LuaConv: registers should be available as globals") {
+    std::string stdconv_path = "../luaconv/luaconv.so";
+    std::shared_ptr<ConverterPlugin> plugin = boost_dll_import<ConverterPlugin>(
+        stdconv_path,
+        "converter_plugin",
+        boost::dll::load_mode::append_decorations
+    );
+    std::shared_ptr<DataConverter> conv(plugin->getConverter("evaluate"));
+
+    conv->setArgs({"local s = 0; for i = 0, 3 do s = s + _G['R' .. i] end; return s"});
+
+    REQUIRE(conv->toMqtt(ModbusRegisters({1, 2, 3, 4})).getString() == "10");
+    // register not passed to this call
+    conv->setArgs({"return _G['R' .. 3]"});
+    REQUIRE(conv->toMqtt(ModbusRegisters({1, 2})).getString() == "0");
+
+    SECTION("rawget should not return register value") {
+        conv->setArgs({"return rawget(_G, 'R0') == nil"});
+        REQUIRE(conv->toMqtt(ModbusRegisters({1})).getString() == "1");
+    }
+
+    SECTION("register variable used by expression should be assignable") {
+        conv->setArgs({"R1 = 5; return R1"});
+        REQUIRE(conv->toMqtt(ModbusRegisters({1, 2})).getString() == "5");
+    }
+}
+
+TEST_CASE("LuaConv: compile error should be reported") {
+    std::string stdconv_path = "../luaconv/luaconv.so";
+    std::shared_ptr<ConverterPlugin> plugin = boost_dll_import<ConverterPlugin>(
+        stdconv_path,
+        "converter_plugin",
+        boost::dll::load_mode::append_decorations
+    );
+    std::shared_ptr<DataConverter> conv(plugin->getConverter("evaluate"));
+
+    REQUIRE_THROWS_AS(conv->setArgs({"return R0 +"}), ConvException);
+}
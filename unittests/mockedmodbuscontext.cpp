@@ -72,6 +72,10 @@ MockedModbusContext::Slave::read(const modmqttd::RegisterPoll& regData, bool int
             errno = EIO;
             throw modmqttd::ModbusReadException(std::string("read fn ") + std::to_string(regData.mRegister) + " failed");
         }
+        if (hasIllegalAddress(regData.mRegister, regData.mRegisterType, regData.getCount())) {
+            errno = EMBXILADD;
+            throw modmqttd::ModbusReadException(std::string("register read fn ") + std::to_string(regData.mRegister) + " failed");
+        }
         if (hasError(regData.mRegister, regData.mRegisterType, regData.getCount())) {
             errno = EIO;
             throw modmqttd::ModbusReadException(std::string("register read fn ") + std::to_string(regData.mRegister) + " failed");
@@ -145,6 +149,23 @@ MockedModbusContext::Slave::setError(int regNum, modmqttd::RegisterType regType,
     };
 }
 
+void
+MockedModbusContext::Slave::setIllegalAddress(int regNum, modmqttd::RegisterType regType, bool pFlag) {
+    if (pFlag)
+        mIllegalAddresses.insert(std::make_pair(regType, regNum));
+    else
+        mIllegalAddresses.erase(std::make_pair(regType, regNum));
+}
+
+bool
+MockedModbusContext::Slave::hasIllegalAddress(int regNum, modmqttd::RegisterType regType, int regCount) const {
+    for (int i = regNum; i < regNum + regCount; i++) {
+        if (mIllegalAddresses.find(std::make_pair(regType, i)) != mIllegalAddresses.end())
+            return true;
+    }
+    return false;
+}
+
 std::vector<uint16_t>
 MockedModbusContext::Slave::readRegisters(std::map<int, MockedModbusContext::RegData>& table, int num, int count, bool internalOperation) {
     std::vector<uint16_t> ret;
@@ -234,6 +255,7 @@ MockedModbusContext::readModbusRegisters(int slaveId, const modmqttd::RegisterPo
 void
 MockedModbusContext::init(const modmqttd::ModbusNetworkConfig& config) {
     mNetworkName = config.mName;
+    mPipelineDepth = config.mPipelineDepth;
     std::string fname = std::string("_") + mNetworkName;
     if (config.mType == modmqttd::ModbusNetworkConfig::Type::RTU)
         fname = config.mDevice;
@@ -448,6 +470,14 @@ MockedModbusFactory::setModbusRegisterReadError(const char* network, int slaveId
     s.setError(regNum, regType, pFlag);
 }
 
+void
+MockedModbusFactory::setModbusRegisterIllegalAddress(const char* network, int slaveId, int regNum, modmqttd::RegisterType regType, bool pFlag) {
+    regNum--;
+    std::shared_ptr<MockedModbusContext> ctx = getOrCreateContext(network);
+    MockedModbusContext::Slave& s(ctx->getSlave(slaveId));
+    s.setIllegalAddress(regNum, regType, pFlag);
+}
+
 void
 MockedModbusFactory::setModbusRegisterWriteError(const char* network, int slaveId, int regNum, modmqttd::RegisterType regType, bool pFlag) {
     regNum--;
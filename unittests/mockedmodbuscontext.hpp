@@ -5,6 +5,7 @@
 #include <vector>
 #include <mutex>
 #include <tuple>
+#include <set>
 #include <condition_variable>
 #include <filesystem>
 #include <fstream>
@@ -38,6 +39,9 @@ class MockedModbusContext : public modmqttd::IModbusContext {
                 void clearError(int regNum, modmqttd::RegisterType regType)
                     { setError(regNum, regType, false); }
                 bool hasError(int regNum, modmqttd::RegisterType regType, int regCount) const;
+                // register is not supported by slave, read returns illegal data address exception
+                void setIllegalAddress(int regNum, modmqttd::RegisterType regType, bool flag = true);
+                bool hasIllegalAddress(int regNum, modmqttd::RegisterType regType, int regCount) const;
                 int getReadCount() const { return mReadCount; }
                 int getWriteCount() const { return mWriteCount; }
 
@@ -55,6 +59,7 @@ class MockedModbusContext : public modmqttd::IModbusContext {
                 std::vector<uint16_t> readRegisters(std::map<int, RegData>& table, int num, int count, bool internalOperation);
                 uint16_t readRegister(std::map<int, RegData>& table, int num, bool internalOperation);
                 bool mDisconnected = false;
+                std::set<std::pair<int, int>> mIllegalAddresses;
                 int mReadCount = 0;
                 int mWriteCount = 0;
                 std::shared_ptr<std::condition_variable> mIOCondition;
@@ -72,6 +77,7 @@ class MockedModbusContext : public modmqttd::IModbusContext {
         virtual std::vector<uint16_t> readModbusRegisters(int slaveId, const modmqttd::RegisterPoll& regData);
         virtual void writeModbusRegisters(int slaveId, const modmqttd::RegisterWrite& msg);
         virtual modmqttd::ModbusNetworkConfig::Type getNetworkType() const { return modmqttd::ModbusNetworkConfig::Type::TCPIP; };
+        virtual int getMaxPipelinedRequests() const { return mPipelineDepth; }
         virtual uint16_t waitForModbusValue(int slaveId, int regNum, modmqttd::RegisterType regType, uint16_t val, std::chrono::milliseconds timeout);
         virtual uint16_t getModbusRegisterValue(int slaveId, int regNum, modmqttd::RegisterType regtype);
         virtual void waitForInitialPoll(std::chrono::milliseconds timeout);
@@ -95,6 +101,7 @@ class MockedModbusContext : public modmqttd::IModbusContext {
         Slave& getSlave(int slaveId);
 
         bool mInternalOperation = false;
+        int mPipelineDepth = 1;
         std::string mNetworkName;
         std::string mDeviceName;
         std::fstream mDeviceFile;
@@ -135,6 +142,8 @@ class MockedModbusFactory : public modmqttd::IModbusFactory {
             setModbusRegisterReadError(network, slaveId, regNum, regtype, false);
         }
 
+        void setModbusRegisterIllegalAddress(const char* network, int slaveId, int regNum, modmqttd::RegisterType regtype, bool pFlag = true);
+
         void setModbusRegisterWriteError(const char* network, int slaveId, int regNum, modmqttd::RegisterType regtype, bool pFlag = true);
         void clearModbusRegisterWriteError(const char* network, int slaveId, int regNum, modmqttd::RegisterType regtype) {
             setModbusRegisterWriteError(network, slaveId, regNum, regtype, false);
@@ -1,5 +1,6 @@
 #include "mockedmqttimpl.hpp"
 #include "libmodmqttsrv/mqttclient.hpp"
+#include "libmodmqttsrv/mqtt_command_router.hpp"
 
 void
 MockedMqttImpl::init(modmqttd::MqttClient* owner, const char* clientId) {
@@ -34,7 +35,7 @@ MockedMqttImpl::subscribe(const char* topic) {
     mCondition.notify_all();
 }
 
-void
+bool
 MockedMqttImpl::publish(const char* topic, int len, const void* data, bool retain) {
     std::unique_lock<std::mutex> lck(mMutex);
 
@@ -49,13 +50,23 @@ MockedMqttImpl::publish(const char* topic, int len, const void* data, bool retai
     MqttValue v(data, len);
     v.publishCount = publishCount;
     mTopics[topic] = v;
-    std::set<std::string>::const_iterator sit = mSubscriptions.find(topic);
-    if (sit != mSubscriptions.end()) {
+    if (isSubscribed(topic)) {
         mOwner->onMessage(topic, data, len);
     }
     BOOST_LOG_SEV(log, modmqttd::Log::info) << "TEST: publish " << topic << ": <" << v.val << ">";
     mPublishedTopics.insert(std::make_pair(topic, mPublishedTopics.size() + 1));
     mCondition.notify_all();
+    // delivered synchronously, no onPublish() callback
+    return false;
+}
+
+bool
+MockedMqttImpl::isSubscribed(const std::string& topic) const {
+    for(const std::string& filter: mSubscriptions) {
+        if (modmqttd::MqttCommandRouter::topicMatches(filter, topic))
+            return true;
+    }
+    return false;
 }
 
 void
@@ -94,14 +105,14 @@ bool
 MockedMqttImpl::waitForSubscription(const char* topic, std::chrono::milliseconds timeout) {
     BOOST_LOG_SEV(log, modmqttd::Log::info) << "TEST: Waiting " << timeout.count() << "ms for subscription on: [" << topic << "]";
     std::unique_lock<std::mutex> lck(mMutex);
-    bool subscribed = mSubscriptions.find(topic) != mSubscriptions.end();
+    bool subscribed = isSubscribed(topic);
     if (!subscribed) {
         auto start = std::chrono::steady_clock::now();
         int dur;
         do {
             if (mCondition.wait_for(lck, timeout) == std::cv_status::timeout)
                 break;
-            subscribed = mSubscriptions.find(topic) != mSubscriptions.end();
+            subscribed = isSubscribed(topic);
             if (subscribed)
                 break;
             auto end = std::chrono::steady_clock::now();
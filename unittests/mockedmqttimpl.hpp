@@ -54,7 +54,7 @@ class MockedMqttImpl : public modmqttd::IMqttImpl {
         virtual void stop();
 
         virtual void subscribe(const char* topic);
-        virtual void publish(const char* topic, int len, const void* data, bool retain);
+        virtual bool publish(const char* topic, int len, const void* data, bool retain);
 
         virtual void on_disconnect(int rc);
         virtual void on_connect(int rc);
@@ -77,7 +77,10 @@ class MockedMqttImpl : public modmqttd::IMqttImpl {
         boost::log::sources::severity_logger<modmqttd::Log::severity> log;
 
         std::map<std::string, MqttValue> mTopics;
+        // topic filters, may contain wildcards
         std::set<std::string> mSubscriptions;
+        // must be called with mMutex locked
+        bool isSubscribed(const std::string& topic) const;
 
         //contains all topics published before waitForPublish/waitForFirstPublish
         //call. Map value contains mqtt publish count
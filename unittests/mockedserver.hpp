@@ -192,6 +192,10 @@ class MockedModMqttServerThread : public ModMqttServerThread {
         mModbusFactory->clearModbusRegisterReadError(network, slaveId, regNum, regtype);
     }
 
+    void setModbusRegisterIllegalAddress(const char* network, int slaveId, int regNum, modmqttd::RegisterType regtype) {
+        mModbusFactory->setModbusRegisterIllegalAddress(network, slaveId, regNum, regtype);
+    }
+
     MockedModbusContext& getMockedModbusContext(const std::string& networkName) const {
         return mModbusFactory->getMockedModbusContext(networkName);
     }
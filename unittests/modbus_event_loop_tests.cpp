@@ -0,0 +1,92 @@
+#include "catch2/catch_all.hpp"
+#include "mockedserver.hpp"
+#include "defaults.hpp"
+
+static const std::string config = R"(
+modmqttd:
+  modbus_worker_threads: 2
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+    - name: tcptest2
+      address: localhost
+      port: 502
+    - name: tcptest3
+      address: localhost
+      port: 503
+mqtt:
+  client_id: mqtt_test
+  refresh: 20ms
+  broker:
+    host: localhost
+  objects:
+    - topic: one
+      commands:
+        - name: set
+          register: tcptest.1.2
+          register_type: holding
+      state:
+        register: tcptest.1.2
+        register_type: holding
+    - topic: two
+      state:
+        register: tcptest2.1.2
+        register_type: holding
+    - topic: three
+      state:
+        register: tcptest3.1.2
+        register_type: holding
+)";
+
+TEST_CASE ("Networks sharing modbus worker threads should be polled") {
+    MockedModMqttServerThread server(config);
+    server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 1);
+    server.setModbusRegisterValue("tcptest2", 1, 2, modmqttd::RegisterType::HOLDING, 2);
+    server.setModbusRegisterValue("tcptest3", 1, 2, modmqttd::RegisterType::HOLDING, 3);
+    server.start();
+
+    server.waitForMqttValue("one/state", "1");
+    server.waitForMqttValue("two/state", "2");
+    server.waitForMqttValue("three/state", "3");
+
+    SECTION("and refreshed") {
+        server.setModbusRegisterValue("tcptest3", 1, 2, modmqttd::RegisterType::HOLDING, 30);
+        server.waitForMqttValue("three/state", "30");
+    }
+
+    SECTION("and accept commands") {
+        server.publish("one/set", "11");
+        server.waitForModbusValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 11);
+        server.waitForMqttValue("one/state", "11");
+    }
+
+    server.stop();
+    REQUIRE(server.mqttValue("two/availability") == "0");
+}
+
+TEST_CASE ("Negative modbus_worker_threads value should be rejected") {
+    static const std::string bad_config = R"(
+modmqttd:
+  modbus_worker_threads: -1
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+mqtt:
+  client_id: mqtt_test
+  broker:
+    host: localhost
+  objects:
+    - topic: one
+      state:
+        register: tcptest.1.2
+)";
+
+    MockedModMqttServerThread server(bad_config, false);
+    server.start();
+    server.stop();
+    REQUIRE(!server.initOk());
+}
@@ -375,3 +375,350 @@ TEST_CASE("ModbusExecutor") {
     }
 
 }
+
+TEST_CASE("ModbusExecutor pipelined reads") {
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> fromModbusQueue;
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> toModbusQueue;
+
+    MockedModbusFactory modbus_factory;
+    std::shared_ptr<modmqttd::IModbusContext> ctx(modbus_factory.getContext("test"));
+    static_cast<MockedModbusContext&>(*ctx).mPipelineDepth = 3;
+
+    modmqttd::ModbusExecutor executor(fromModbusQueue, toModbusQueue);
+    executor.init(ctx);
+
+    ModbusExecutorTestRegisters registers;
+
+    SECTION("should poll up to pipeline depth registers in single step") {
+        modbus_factory.setModbusRegisterValue("test",1,1,modmqttd::RegisterType::HOLDING, 5);
+        modbus_factory.setModbusRegisterValue("test",1,4,modmqttd::RegisterType::HOLDING, 8);
+
+        auto reg1 = registers.addPoll(1, 1);
+        registers.addPoll(1, 2);
+        auto reg3 = registers.addPoll(1, 3);
+        auto reg4 = registers.addPoll(1, 4);
+
+        executor.setupInitialPoll(registers);
+        executor.executeNext();
+        REQUIRE(reg1->getValues()[0] == 5);
+        REQUIRE(reg3->executedOk());
+        REQUIRE(!reg4->executedOk());
+        REQUIRE(!executor.allDone());
+
+        executor.executeNext();
+        REQUIRE(reg4->getValues()[0] == 8);
+        REQUIRE(executor.allDone());
+    }
+
+    SECTION("should not pipeline registers with delay") {
+        auto reg1 = registers.addPoll(1, 1);
+        auto reg2 = registers.addPollDelayed(1, 2, std::chrono::milliseconds(5));
+
+        executor.setupInitialPoll(registers);
+        executor.executeNext();
+        REQUIRE(reg1->executedOk() != reg2->executedOk());
+        REQUIRE(!executor.allDone());
+    }
+
+    SECTION("should retry failed pipelined register") {
+        modbus_factory.setModbusRegisterReadError("test", 1, 2, modmqttd::RegisterType::HOLDING);
+
+        registers.addPoll(1, 1);
+        auto reg2 = registers.addPoll(1, 2);
+        reg2->setMaxRetryCounts(1, 0, true);
+
+        executor.setupInitialPoll(registers);
+        executor.executeNext();
+        REQUIRE(!reg2->executedOk());
+        REQUIRE(!executor.allDone());
+
+        modbus_factory.clearModbusRegisterReadError("test", 1, 2, modmqttd::RegisterType::HOLDING);
+        executor.executeNext();
+        REQUIRE(reg2->executedOk());
+        REQUIRE(executor.allDone());
+    }
+
+    SECTION("should stop retrying pipelined register after read_retries") {
+        modbus_factory.setModbusRegisterReadError("test", 1, 2, modmqttd::RegisterType::HOLDING);
+
+        registers.addPoll(1, 1);
+        auto reg2 = registers.addPoll(1, 2);
+        reg2->setMaxRetryCounts(2, 0, true);
+
+        executor.setupInitialPoll(registers);
+        for(int i = 0; i < 10 && !executor.allDone(); i++)
+            executor.executeNext();
+
+        REQUIRE(executor.allDone());
+        REQUIRE(!reg2->executedOk());
+        // initial read and two retries
+        REQUIRE(reg2->mReadErrors == 3);
+        REQUIRE(reg2->mPipelinedRetryCount == 0);
+    }
+}
+
+static std::shared_ptr<modmqttd::RegisterWrite>
+createCommandWrite(int reg, uint16_t value) {
+    std::shared_ptr<modmqttd::MsgRegisterValues> msg(new modmqttd::MsgRegisterValues(
+        1, modmqttd::RegisterType::HOLDING, reg - 1, ModbusRegisters(value), reg
+    ));
+    std::shared_ptr<modmqttd::RegisterWrite> ret(new modmqttd::RegisterWrite(*msg));
+    ret->mReturnMessages.push_back(msg);
+    return ret;
+}
+
+TEST_CASE("ModbusExecutor write coalescing") {
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> fromModbusQueue;
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> toModbusQueue;
+
+    MockedModbusFactory modbus_factory;
+
+    modmqttd::ModbusExecutor executor(fromModbusQueue, toModbusQueue);
+    executor.init(modbus_factory.getContext("test"));
+    executor.setCoalesceWrites(true);
+
+    // the first one is executed immediately, rest is queued
+    executor.addWriteCommand(createCommandWrite(1, 10));
+    executor.addWriteCommand(createCommandWrite(2, 20));
+    executor.addWriteCommand(createCommandWrite(3, 30));
+    executor.addWriteCommand(createCommandWrite(2, 21));
+
+    executor.executeNext();
+    REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 1, modmqttd::RegisterType::HOLDING) == 10);
+    REQUIRE(!executor.allDone());
+
+    executor.executeNext();
+    REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 2, modmqttd::RegisterType::HOLDING) == 21);
+    REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 3, modmqttd::RegisterType::HOLDING) == 30);
+    REQUIRE(executor.allDone());
+
+    // state of every command is sent back
+    std::map<int, uint16_t> returned;
+    modmqttd::QueueItem item;
+    while(fromModbusQueue.try_dequeue(item)) {
+        std::unique_ptr<modmqttd::MsgRegisterValues> msg(item.getData<modmqttd::MsgRegisterValues>());
+        REQUIRE(msg->mRegisters.getCount() == 1);
+        returned[msg->getCommandId()] = msg->mRegisters.getValue(0);
+    }
+    REQUIRE(returned == std::map<int, uint16_t>({{1, 10}, {2, 21}, {3, 30}}));
+}
+
+TEST_CASE("ModbusExecutor register values batching") {
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> fromModbusQueue;
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> toModbusQueue;
+
+    MockedModbusFactory modbus_factory;
+
+    modmqttd::ModbusExecutor executor(fromModbusQueue, toModbusQueue);
+    executor.init(modbus_factory.getContext("test"));
+    executor.setMaxBatchDelay(std::chrono::milliseconds(1000));
+
+    ModbusExecutorTestRegisters registers;
+    registers.addPoll(1, 1);
+    registers.addPoll(1, 2);
+    registers.addPoll(2, 1);
+    executor.setupInitialPoll(registers);
+
+    SECTION("should send values polled in single round as one item") {
+        executor.executeNext();
+        executor.executeNext();
+        REQUIRE(fromModbusQueue.size_approx() == 0);
+
+        executor.executeNext();
+        REQUIRE(executor.allDone());
+        REQUIRE(fromModbusQueue.size_approx() == 1);
+
+        modmqttd::QueueItem item;
+        fromModbusQueue.try_dequeue(item);
+        REQUIRE(item.isSameAs(typeid(modmqttd::MsgRegisterValuesBatch)));
+        std::unique_ptr<modmqttd::MsgRegisterValuesBatch> batch(item.getData<modmqttd::MsgRegisterValuesBatch>());
+        REQUIRE(batch->mValues.size() == 3);
+    }
+
+    SECTION("should send collected values before write confirmation") {
+        executor.executeNext();
+        executor.addWriteCommand(createCommandWrite(5, 50));
+        executor.executeNext();
+
+        modmqttd::QueueItem item;
+        REQUIRE(fromModbusQueue.try_dequeue(item));
+        REQUIRE(item.isSameAs(typeid(modmqttd::MsgRegisterValuesBatch)));
+        REQUIRE(item.getData<modmqttd::MsgRegisterValuesBatch>()->mValues.size() == 1);
+        REQUIRE(fromModbusQueue.try_dequeue(item));
+        REQUIRE(item.isSameAs(typeid(modmqttd::MsgRegisterValues)));
+        REQUIRE(item.getData<modmqttd::MsgRegisterValues>()->getCommandId() == 5);
+    }
+}
+
+TEST_CASE("ModbusExecutor write queue limit") {
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> fromModbusQueue;
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> toModbusQueue;
+
+    MockedModbusFactory modbus_factory;
+
+    modmqttd::ModbusExecutor executor(fromModbusQueue, toModbusQueue);
+    executor.init(modbus_factory.getContext("test"));
+
+    SECTION("should replace queued write to the same register") {
+        executor.setMaxQueuedWrites(2, modmqttd::ModbusNetworkConfig::WriteOverflowPolicy::DROP_OLDEST);
+        executor.addWriteCommand(createCommandWrite(1, 10));
+        executor.addWriteCommand(createCommandWrite(2, 20));
+        executor.addWriteCommand(createCommandWrite(2, 21));
+
+        while(!executor.allDone())
+            executor.executeNext();
+
+        REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 2, modmqttd::RegisterType::HOLDING) == 21);
+        REQUIRE(executor.getReplacedWriteCount() == 1);
+        REQUIRE(executor.getDroppedWriteCount() == 0);
+
+        // both MQTT commands get the written value back
+        int responses = 0;
+        modmqttd::QueueItem item;
+        while(fromModbusQueue.try_dequeue(item)) {
+            std::unique_ptr<modmqttd::MsgRegisterValues> msg(item.getData<modmqttd::MsgRegisterValues>());
+            if (msg->getCommandId() == 2) {
+                REQUIRE(msg->mRegisters.getValue(0) == 21);
+                responses++;
+            }
+        }
+        REQUIRE(responses == 2);
+    }
+
+    SECTION("should drop the oldest queued write") {
+        executor.setMaxQueuedWrites(2, modmqttd::ModbusNetworkConfig::WriteOverflowPolicy::DROP_OLDEST);
+        executor.addWriteCommand(createCommandWrite(1, 10));
+        executor.addWriteCommand(createCommandWrite(2, 20));
+        executor.addWriteCommand(createCommandWrite(3, 30));
+
+        while(!executor.allDone())
+            executor.executeNext();
+
+        REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 1, modmqttd::RegisterType::HOLDING) == 10);
+        REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 2, modmqttd::RegisterType::HOLDING) == 0);
+        REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 3, modmqttd::RegisterType::HOLDING) == 30);
+        REQUIRE(executor.getDroppedWriteCount() == 1);
+    }
+
+    SECTION("should drop the newest write") {
+        executor.setMaxQueuedWrites(2, modmqttd::ModbusNetworkConfig::WriteOverflowPolicy::DROP_NEWEST);
+        executor.addWriteCommand(createCommandWrite(1, 10));
+        executor.addWriteCommand(createCommandWrite(2, 20));
+        executor.addWriteCommand(createCommandWrite(3, 30));
+
+        while(!executor.allDone())
+            executor.executeNext();
+
+        REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 2, modmqttd::RegisterType::HOLDING) == 20);
+        REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 3, modmqttd::RegisterType::HOLDING) == 0);
+        REQUIRE(executor.getDroppedWriteCount() == 1);
+    }
+
+    SECTION("should not count failed writes as queued") {
+        executor.setMaxQueuedWrites(1, modmqttd::ModbusNetworkConfig::WriteOverflowPolicy::DROP_NEWEST);
+        modbus_factory.setModbusRegisterWriteError("test", 1, 1, modmqttd::RegisterType::HOLDING);
+        std::shared_ptr<modmqttd::RegisterWrite> failed(createCommandWrite(1, 10));
+        failed->setMaxRetryCounts(0, 1, true);
+        executor.addWriteCommand(failed);
+        while(!executor.allDone())
+            executor.executeNext();
+
+        modbus_factory.clearModbusRegisterWriteError("test", 1, 1, modmqttd::RegisterType::HOLDING);
+        executor.addWriteCommand(createCommandWrite(2, 20));
+        executor.addWriteCommand(createCommandWrite(3, 30));
+        while(!executor.allDone())
+            executor.executeNext();
+
+        REQUIRE(modbus_factory.getModbusRegisterValue("test", 1, 2, modmqttd::RegisterType::HOLDING) == 20);
+        REQUIRE(executor.getDroppedWriteCount() == 1);
+    }
+}
+
+TEST_CASE("ModbusExecutor updates queue limit") {
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> fromModbusQueue;
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> toModbusQueue;
+
+    MockedModbusFactory modbus_factory;
+
+    modmqttd::ModbusExecutor executor(fromModbusQueue, toModbusQueue);
+    executor.init(modbus_factory.getContext("test"));
+    executor.setMaxQueuedUpdates(1);
+
+    ModbusExecutorTestRegisters registers;
+    registers.addPoll(1, 1);
+
+    modbus_factory.setModbusRegisterValue("test", 1, 1, modmqttd::RegisterType::HOLDING, 5);
+    executor.setupInitialPoll(registers);
+    executor.executeNext();
+    REQUIRE(fromModbusQueue.size_approx() == 1);
+
+    // queue is full, only the latest value should be kept
+    modbus_factory.setModbusRegisterValue("test", 1, 1, modmqttd::RegisterType::HOLDING, 6);
+    executor.addPollList(registers);
+    executor.executeNext();
+    modbus_factory.setModbusRegisterValue("test", 1, 1, modmqttd::RegisterType::HOLDING, 7);
+    executor.addPollList(registers);
+    executor.executeNext();
+    REQUIRE(fromModbusQueue.size_approx() == 1);
+    REQUIRE(executor.getCollapsedValueCount() == 1);
+
+    // write confirmation is held after older held values
+    executor.addWriteCommand(createCommandWrite(2, 20));
+    executor.executeNext();
+    REQUIRE(fromModbusQueue.size_approx() == 1);
+
+    modmqttd::QueueItem item;
+    REQUIRE(fromModbusQueue.try_dequeue(item));
+    REQUIRE(item.getData<modmqttd::MsgRegisterValues>()->mRegisters.getValue(0) == 5);
+
+    executor.addPollList(registers);
+    executor.executeNext();
+    REQUIRE(fromModbusQueue.try_dequeue(item));
+    std::unique_ptr<modmqttd::MsgRegisterValuesBatch> batch(item.getData<modmqttd::MsgRegisterValuesBatch>());
+    REQUIRE(batch->mValues.size() == 1);
+    REQUIRE(batch->mValues[0].mRegisters.getValue(0) == 7);
+
+    // confirmation is the last value published for register
+    REQUIRE(fromModbusQueue.try_dequeue(item));
+    std::unique_ptr<modmqttd::MsgRegisterValues> confirmation(item.getData<modmqttd::MsgRegisterValues>());
+    REQUIRE(confirmation->getCommandId() == 2);
+    REQUIRE(confirmation->mRegisters.getValue(0) == 20);
+    while (fromModbusQueue.try_dequeue(item))
+        REQUIRE(item.getData<modmqttd::MsgRegisterValues>()->mRegisters.getValue(0) == 20);
+}
+
+TEST_CASE("ModbusExecutor register deadband") {
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> fromModbusQueue;
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> toModbusQueue;
+
+    MockedModbusFactory modbus_factory;
+
+    modmqttd::ModbusExecutor executor(fromModbusQueue, toModbusQueue);
+    executor.init(modbus_factory.getContext("test"));
+
+    ModbusExecutorTestRegisters registers;
+    auto reg = registers.addPoll(1, 1);
+    reg->mDeadbands.push_back(modmqttd::RegisterDeadband(2));
+
+    modbus_factory.setModbusRegisterValue("test", 1, 1, modmqttd::RegisterType::HOLDING, 10);
+    executor.setupInitialPoll(registers);
+    executor.executeNext();
+
+    modmqttd::QueueItem item;
+    REQUIRE(fromModbusQueue.try_dequeue(item));
+    REQUIRE(item.getData<modmqttd::MsgRegisterValues>()->mRegisters.getValue(0) == 10);
+
+    // change from the last sent value is inside deadband
+    modbus_factory.setModbusRegisterValue("test", 1, 1, modmqttd::RegisterType::HOLDING, 12);
+    executor.addPollList(registers);
+    executor.executeNext();
+    REQUIRE(fromModbusQueue.size_approx() == 0);
+    REQUIRE(executor.getSuppressedUpdateCount() == 1);
+
+    modbus_factory.setModbusRegisterValue("test", 1, 1, modmqttd::RegisterType::HOLDING, 13);
+    executor.addPollList(registers);
+    executor.executeNext();
+    REQUIRE(fromModbusQueue.try_dequeue(item));
+    REQUIRE(item.getData<modmqttd::MsgRegisterValues>()->mRegisters.getValue(0) == 13);
+    REQUIRE(executor.getSuppressedUpdateCount() == 1);
+}
@@ -0,0 +1,278 @@
+#include <thread>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/modbus_context.hpp"
+#include "libmodmqttsrv/modbus_pipeline_context.hpp"
+#include "libmodmqttsrv/register_poll.hpp"
+
+/**
+ * Local stand-in for Modbus TCP gateway. Every request is answered
+ * after mLatency, requests are not serialized, so multiple requests
+ * can be in flight. Holding and input registers return their address
+ * unless written.
+ */
+class ModbusTcpStandInServer {
+    public:
+        ModbusTcpStandInServer(std::chrono::milliseconds latency) : mLatency(latency) {
+            mListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+            int flag = 1;
+            setsockopt(mListenSocket, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+            struct sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            bind(mListenSocket, (struct sockaddr*)&addr, sizeof(addr));
+            socklen_t len = sizeof(addr);
+            getsockname(mListenSocket, (struct sockaddr*)&addr, &len);
+            mPort = ntohs(addr.sin_port);
+            listen(mListenSocket, 1);
+            mThread = std::thread(&ModbusTcpStandInServer::run, this);
+        }
+
+        ~ModbusTcpStandInServer() {
+            mShouldRun = false;
+            mThread.join();
+            close(mListenSocket);
+        }
+
+        int getPort() const { return mPort; }
+        int getRequestCount() const { return mRequestCount; }
+        int getMaxInFlight() const { return mMaxInFlight; }
+
+        std::set<int> mIllegalAddresses;
+        std::map<int, uint16_t> mHolding;
+    private:
+        struct PendingResponse {
+            std::chrono::steady_clock::time_point mSendTime;
+            std::vector<uint8_t> mFrame;
+        };
+
+        std::chrono::milliseconds mLatency;
+        int mListenSocket;
+        int mPort;
+        std::atomic<bool> mShouldRun = true;
+        std::atomic<int> mRequestCount = 0;
+        std::atomic<int> mMaxInFlight = 0;
+        std::thread mThread;
+
+        std::vector<uint8_t> createResponse(const std::vector<uint8_t>& request) {
+            std::vector<uint8_t> pdu;
+            uint8_t function = request[7];
+            int address = (request[8] << 8) | request[9];
+            int count = (request[10] << 8) | request[11];
+
+            bool illegal = false;
+            int last = (function == 0x05 || function == 0x06) ? address : address + count - 1;
+            for(int i = address; i <= last; i++)
+                illegal = illegal || mIllegalAddresses.count(i) != 0;
+
+            if (illegal) {
+                pdu.push_back(function | 0x80);
+                pdu.push_back(MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+            } else if (function == 0x03 || function == 0x04) {
+                pdu.push_back(function);
+                pdu.push_back(count * 2);
+                for(int i = address; i < address + count; i++) {
+                    uint16_t value = mHolding.count(i) ? mHolding[i] : i;
+                    pdu.push_back(value >> 8);
+                    pdu.push_back(value & 0xFF);
+                }
+            } else if (function == 0x01 || function == 0x02) {
+                pdu.push_back(function);
+                pdu.push_back((count + 7) / 8);
+                pdu.resize(pdu.size() + (count + 7) / 8, 0);
+                for(int i = 0; i < count; i++)
+                    if ((address + i) % 2)
+                        pdu[2 + i / 8] |= 1 << (i % 8);
+            } else if (function == 0x06) {
+                mHolding[address] = count;
+                pdu.assign(request.begin() + 7, request.end());
+            } else if (function == 0x10) {
+                for(int i = 0; i < count; i++)
+                    mHolding[address + i] = (request[13 + i * 2] << 8) | request[14 + i * 2];
+                pdu.assign(request.begin() + 7, request.begin() + 12);
+            } else {
+                pdu.push_back(function | 0x80);
+                pdu.push_back(MODBUS_EXCEPTION_ILLEGAL_FUNCTION);
+            }
+
+            std::vector<uint8_t> frame(request.begin(), request.begin() + 7);
+            frame[4] = (pdu.size() + 1) >> 8;
+            frame[5] = (pdu.size() + 1) & 0xFF;
+            frame.insert(frame.end(), pdu.begin(), pdu.end());
+            return frame;
+        }
+
+        void serve(int client) {
+            std::vector<uint8_t> buffer;
+            std::deque<PendingResponse> pending;
+            while (mShouldRun) {
+                int timeout = 10;
+                if (!pending.empty()) {
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(pending.front().mSendTime - std::chrono::steady_clock::now());
+                    timeout = std::max(0, std::min(timeout, int(left.count())));
+                }
+                struct pollfd pfd = { client, POLLIN, 0 };
+                if (poll(&pfd, 1, timeout) == 1) {
+                    uint8_t data[512];
+                    ssize_t len = recv(client, data, sizeof(data), 0);
+                    if (len <= 0)
+                        return;
+                    buffer.insert(buffer.end(), data, data + len);
+                }
+
+                while (buffer.size() >= 7 && buffer.size() >= std::size_t(6 + ((buffer[4] << 8) | buffer[5]))) {
+                    std::size_t size = 6 + ((buffer[4] << 8) | buffer[5]);
+                    std::vector<uint8_t> request(buffer.begin(), buffer.begin() + size);
+                    buffer.erase(buffer.begin(), buffer.begin() + size);
+                    pending.push_back(PendingResponse{std::chrono::steady_clock::now() + mLatency, createResponse(request)});
+                    mRequestCount++;
+                    if (int(pending.size()) > mMaxInFlight)
+                        mMaxInFlight = pending.size();
+                }
+
+                while (!pending.empty() && pending.front().mSendTime <= std::chrono::steady_clock::now()) {
+                    send(client, pending.front().mFrame.data(), pending.front().mFrame.size(), MSG_NOSIGNAL);
+                    pending.pop_front();
+                }
+            }
+        }
+
+        void run() {
+            while (mShouldRun) {
+                struct pollfd pfd = { mListenSocket, POLLIN, 0 };
+                if (poll(&pfd, 1, 10) != 1)
+                    continue;
+                int client = accept(mListenSocket, nullptr, nullptr);
+                if (client == -1)
+                    continue;
+                serve(client);
+                close(client);
+            }
+        }
+};
+
+static modmqttd::ModbusNetworkConfig
+createStandInConfig(const ModbusTcpStandInServer& server, int depth) {
+    modmqttd::ModbusNetworkConfig config;
+    config.mName = "standin";
+    config.mType = modmqttd::ModbusNetworkConfig::TCPIP;
+    config.mAddress = "127.0.0.1";
+    config.mPort = server.getPort();
+    config.mPipelineDepth = depth;
+    return config;
+}
+
+static std::vector<std::shared_ptr<modmqttd::RegisterPoll>>
+createPollList(int first, int count, modmqttd::RegisterType type = modmqttd::RegisterType::HOLDING) {
+    std::vector<std::shared_ptr<modmqttd::RegisterPoll>> ret;
+    for(int i = first; i < first + count; i++) {
+        ret.push_back(std::shared_ptr<modmqttd::RegisterPoll>(new modmqttd::RegisterPoll(
+            1, i, type, 2, std::chrono::milliseconds(100), modmqttd::PublishMode::ON_CHANGE
+        )));
+    }
+    return ret;
+}
+
+TEST_CASE("ModbusPipelineContext should send requests without waiting for responses") {
+    ModbusTcpStandInServer server(std::chrono::milliseconds(20));
+
+    modmqttd::ModbusPipelineContext ctx;
+    ctx.init(createStandInConfig(server, 4));
+    ctx.connect();
+    REQUIRE(ctx.isConnected());
+
+    SECTION("Responses should be matched with requests") {
+        std::vector<std::shared_ptr<modmqttd::RegisterPoll>> regs(createPollList(10, 4));
+
+        std::vector<modmqttd::ModbusReadResult> results(ctx.readModbusRegisterList(1, regs));
+
+        REQUIRE(results.size() == 4);
+        for(int i = 0; i < 4; i++) {
+            REQUIRE(!results[i].mError);
+            REQUIRE(results[i].mValues == std::vector<uint16_t>({uint16_t(10 + i), uint16_t(11 + i)}));
+        }
+        REQUIRE(server.getMaxInFlight() == 4);
+    }
+
+    SECTION("Exception response should fail only a single read") {
+        server.mIllegalAddresses.insert(12);
+        std::vector<std::shared_ptr<modmqttd::RegisterPoll>> regs(createPollList(10, 4));
+
+        std::vector<modmqttd::ModbusReadResult> results(ctx.readModbusRegisterList(1, regs));
+
+        REQUIRE(!results[0].mError);
+        REQUIRE(results[1].mError);
+        REQUIRE(results[2].mError);
+        REQUIRE(!results[3].mError);
+        try {
+            std::rethrow_exception(results[1].mError);
+        } catch (const modmqttd::ModbusReadException& ex) {
+            REQUIRE(ex.isIllegalDataAddress());
+        }
+        REQUIRE(ctx.isConnected());
+    }
+
+    SECTION("Coils should be unpacked") {
+        std::vector<std::shared_ptr<modmqttd::RegisterPoll>> regs(createPollList(1, 1, modmqttd::RegisterType::COIL));
+
+        std::vector<uint16_t> values(ctx.readModbusRegisters(1, *regs[0]));
+
+        REQUIRE(values == std::vector<uint16_t>({1, 0}));
+    }
+
+    SECTION("Written register should be read back") {
+        modmqttd::RegisterWrite cmd(1, 5, modmqttd::RegisterType::HOLDING, ModbusRegisters(std::vector<uint16_t>({7, 8})));
+        ctx.writeModbusRegisters(1, cmd);
+
+        std::vector<std::shared_ptr<modmqttd::RegisterPoll>> regs(createPollList(5, 1));
+        REQUIRE(ctx.readModbusRegisters(1, *regs[0]) == std::vector<uint16_t>({7, 8}));
+    }
+
+    ctx.disconnect();
+}
+
+TEST_CASE("Pipelined and synchronous modbus tcp read throughput", "[.][benchmark]") {
+    const int regCount = 100;
+    ModbusTcpStandInServer server(std::chrono::milliseconds(10));
+    std::vector<std::shared_ptr<modmqttd::RegisterPoll>> regs(createPollList(1, regCount));
+
+    modmqttd::ModbusContext sync;
+    sync.init(createStandInConfig(server, 1));
+    sync.connect();
+    REQUIRE(sync.isConnected());
+
+    auto start = std::chrono::steady_clock::now();
+    for(const auto& reg: regs)
+        sync.readModbusRegisters(1, *reg);
+    auto syncTime = std::chrono::steady_clock::now() - start;
+    sync.disconnect();
+
+    modmqttd::ModbusPipelineContext pipelined;
+    pipelined.init(createStandInConfig(server, 8));
+    pipelined.connect();
+    REQUIRE(pipelined.isConnected());
+
+    start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < regs.size(); i += pipelined.getMaxPipelinedRequests()) {
+        std::size_t last = std::min(regs.size(), i + pipelined.getMaxPipelinedRequests());
+        pipelined.readModbusRegisterList(1, std::vector<std::shared_ptr<modmqttd::RegisterPoll>>(regs.begin() + i, regs.begin() + last));
+    }
+    auto pipelinedTime = std::chrono::steady_clock::now() - start;
+    pipelined.disconnect();
+
+    WARN("synchronous: " << regCount * 1000 / std::chrono::duration_cast<std::chrono::milliseconds>(syncTime).count() << " reads/s, "
+        << "pipelined (8): " << regCount * 1000 / std::chrono::duration_cast<std::chrono::milliseconds>(pipelinedTime).count() << " reads/s");
+    REQUIRE(pipelinedTime < syncTime);
+}
@@ -127,4 +127,210 @@ TEST_CASE("MsgRegisterPollSpecification merge tests") {
         REQUIRE(specs.mRegisters[1].isSameAs(createPoll(4,8)));
     }
 
+    SECTION("Merge should keep publish mode that sends values after every poll") {
+        modmqttd::MsgRegisterPoll aggregate(createPoll(1,3));
+        aggregate.mPublishMode = modmqttd::PublishMode::AGGREGATE;
+        specs.mRegisters.push_back(aggregate);
+
+        specs.merge(createPoll(3,3));
+
+        REQUIRE(specs.mRegisters.size() == 1);
+        REQUIRE(specs.mRegisters.front().mPublishMode == modmqttd::PublishMode::AGGREGATE);
+
+        modmqttd::MsgRegisterPoll every_poll(createPoll(2,2));
+        every_poll.mPublishMode = modmqttd::PublishMode::EVERY_POLL;
+        specs.merge(every_poll);
+
+        REQUIRE(specs.mRegisters.front().mPublishMode == modmqttd::PublishMode::AGGREGATE);
+    }
+
+    SECTION("Merge should set publish mode of added poll with every poll mode") {
+        specs.mRegisters.push_back(createPoll(1,3));
+
+        modmqttd::MsgRegisterPoll aggregate(createPoll(3,3));
+        aggregate.mPublishMode = modmqttd::PublishMode::AGGREGATE;
+        specs.merge(aggregate);
+
+        REQUIRE(specs.mRegisters.front().mPublishMode == modmqttd::PublishMode::AGGREGATE);
+    }
+}
+
+
+TEST_CASE("MsgRegisterPollSpecification coalesce tests") {
+    modmqttd::MsgRegisterPollSpecification specs("test");
+    specs.mMaxGap = 2;
+
+    SECTION("Coalesce should join ranges separated by max_gap registers") {
+
+        specs.mRegisters.push_back(createPoll(1,2));
+        specs.mRegisters.push_back(createPoll(5,5));
+        specs.mRegisters.push_back(createPoll(9,10));
+
+        REQUIRE(specs.coalesce() == 1);
+
+        REQUIRE(specs.mRegisters.size() == 2);
+        REQUIRE(specs.mRegisters[0].isSameAs(createPoll(1,5)));
+        REQUIRE(specs.mRegisters[0].mDeliveryRanges.size() == 2);
+        REQUIRE(specs.mRegisters[0].mDeliveryRanges[0].isSameAs(createPoll(1,2)));
+        REQUIRE(specs.mRegisters[0].mDeliveryRanges[1].isSameAs(createPoll(5,5)));
+        REQUIRE(specs.mRegisters[1].isSameAs(createPoll(9,10)));
+        REQUIRE(specs.mRegisters[1].mDeliveryRanges.empty());
+    }
+
+    SECTION("Coalesce should not join ranges with different refresh time") {
+
+        specs.mRegisters.push_back(createPoll(1,2,10));
+        specs.mRegisters.push_back(createPoll(4,5,20));
+
+        REQUIRE(specs.coalesce() == 0);
+        REQUIRE(specs.mRegisters.size() == 2);
+    }
+
+    SECTION("Coalesce should use slave max_gap") {
+
+        specs.mSlaveMaxGap[1] = 0;
+
+        specs.mRegisters.push_back(createPoll(1,2));
+        specs.mRegisters.push_back(createPoll(4,5));
+
+        REQUIRE(specs.coalesce() == 0);
+        REQUIRE(specs.mRegisters.size() == 2);
+    }
+
+    SECTION("Coalesce should not extend reads with modbus only poll groups") {
+
+        modmqttd::MsgRegisterPoll modbus_only(1, 3, modmqttd::RegisterType::INPUT, 1);
+
+        specs.mRegisters.push_back(createPoll(1,1));
+        specs.mRegisters.push_back(modbus_only);
+
+        REQUIRE(specs.coalesce() == 0);
+        REQUIRE(specs.mRegisters.size() == 2);
+    }
+}
+
+
+TEST_CASE("MsgRegisterPollSpecification split tests") {
+    modmqttd::MsgRegisterPollSpecification specs("test");
+
+    SECTION("Split should divide ranges at modbus protocol limit") {
+
+        specs.mRegisters.push_back(createPoll(1,300));
+
+        specs.split();
+
+        REQUIRE(specs.mRegisters.size() == 3);
+        REQUIRE(specs.mRegisters[0].isSameAs(createPoll(1,125)));
+        REQUIRE(specs.mRegisters[1].isSameAs(createPoll(126,250)));
+        REQUIRE(specs.mRegisters[2].isSameAs(createPoll(251,300)));
+        REQUIRE(specs.mRegisters[2].mRefreshMsec == std::chrono::milliseconds(1));
+    }
+
+    SECTION("Split should use bit limit for coils") {
+
+        specs.mRegisters.push_back(modmqttd::MsgRegisterPoll(1, 1, modmqttd::RegisterType::COIL, 2000));
+
+        specs.split();
+
+        REQUIRE(specs.mRegisters.size() == 1);
+    }
+
+    SECTION("Split should use slave max_read_registers") {
+
+        specs.mSlaveMaxReadRegisters[1] = 10;
+        specs.mRegisters.push_back(createPoll(1,15));
+
+        specs.split();
+
+        REQUIRE(specs.mRegisters.size() == 2);
+        REQUIRE(specs.mRegisters[0].isSameAs(createPoll(1,10)));
+        REQUIRE(specs.mRegisters[1].isSameAs(createPoll(11,15)));
+    }
+
+    SECTION("Split should not cut registers converted to a single value") {
+
+        specs.mRegisters.push_back(createPoll(1,300));
+        specs.addValueRange(modmqttd::ModbusSlaveAddressRange(1, 125, modmqttd::RegisterType::INPUT, 2));
+
+        specs.split();
+
+        REQUIRE(specs.mRegisters.size() == 3);
+        REQUIRE(specs.mRegisters[0].isSameAs(createPoll(1,124)));
+        REQUIRE(specs.mRegisters[1].isSameAs(createPoll(125,249)));
+        REQUIRE(specs.mRegisters[2].isSameAs(createPoll(250,300)));
+    }
+
+    SECTION("Split should reject value longer than slave max_read_registers") {
+
+        specs.mSlaveMaxReadRegisters[1] = 2;
+        specs.mRegisters.push_back(createPoll(1,5));
+        specs.addValueRange(modmqttd::ModbusSlaveAddressRange(1, 2, modmqttd::RegisterType::INPUT, 3));
+
+        REQUIRE_THROWS_AS(specs.split(), modmqttd::ModMqttException);
+    }
+
+    SECTION("Coalesce should not create reads over slave max_read_registers") {
+
+        specs.mMaxGap = 5;
+        specs.mSlaveMaxReadRegisters[1] = 10;
+        specs.mRegisters.push_back(createPoll(1,4));
+        specs.mRegisters.push_back(createPoll(6,10));
+        specs.mRegisters.push_back(createPoll(12,12));
+
+        REQUIRE(specs.coalesce() == 1);
+
+        REQUIRE(specs.mRegisters.size() == 2);
+        REQUIRE(specs.mRegisters[0].isSameAs(createPoll(1,10)));
+        REQUIRE(specs.mRegisters[1].isSameAs(createPoll(12,12)));
+    }
+}
+
+TEST_CASE("MsgRegisterPollSpecification deadband tests") {
+    modmqttd::MsgRegisterPollSpecification specs("test");
+
+    SECTION("should use the smaller deadband") {
+        specs.addDeadband(1, modmqttd::RegisterType::INPUT, 1, 2, modmqttd::RegisterDeadband(5));
+        specs.addDeadband(1, modmqttd::RegisterType::INPUT, 2, 1, modmqttd::RegisterDeadband(3));
+
+        REQUIRE(specs.findDeadband(1, modmqttd::RegisterType::INPUT, 1)->mValue == 5);
+        REQUIRE(specs.findDeadband(1, modmqttd::RegisterType::INPUT, 2)->mValue == 3);
+        REQUIRE(specs.findDeadband(1, modmqttd::RegisterType::INPUT, 3) == nullptr);
+    }
+
+    SECTION("should not filter register declared without deadband") {
+        specs.addDeadband(1, modmqttd::RegisterType::INPUT, 1, 1, modmqttd::RegisterDeadband(5));
+        specs.addDeadband(1, modmqttd::RegisterType::INPUT, 1, 1, modmqttd::RegisterDeadband());
+
+        REQUIRE(specs.findDeadband(1, modmqttd::RegisterType::INPUT, 1) == nullptr);
+    }
+
+    SECTION("should not filter register with different deadband types") {
+        specs.addDeadband(1, modmqttd::RegisterType::INPUT, 1, 1, modmqttd::RegisterDeadband(5));
+        specs.addDeadband(1, modmqttd::RegisterType::INPUT, 1, 1, modmqttd::RegisterDeadband(1, modmqttd::RegisterDeadband::Type::PERCENT));
+
+        REQUIRE(specs.findDeadband(1, modmqttd::RegisterType::INPUT, 1) == nullptr);
+    }
+
+    SECTION("should not filter register with different signedness") {
+        modmqttd::RegisterDeadband sdb(5);
+        sdb.mSigned = true;
+        specs.addDeadband(1, modmqttd::RegisterType::INPUT, 1, 1, modmqttd::RegisterDeadband(5));
+        specs.addDeadband(1, modmqttd::RegisterType::INPUT, 1, 1, sdb);
+
+        REQUIRE(specs.findDeadband(1, modmqttd::RegisterType::INPUT, 1) == nullptr);
+    }
+
+    SECTION("should compare signed values") {
+        modmqttd::RegisterDeadband db(2);
+        REQUIRE(!db.isInside(0, 0xFFFF));
+        db.mSigned = true;
+        REQUIRE(db.isInside(0, 0xFFFF));
+        REQUIRE(!db.isInside(0xFFFF, 2));
+
+        modmqttd::RegisterDeadband pdb(10, modmqttd::RegisterDeadband::Type::PERCENT);
+        pdb.mSigned = true;
+        // -100 -> -95
+        REQUIRE(pdb.isInside(uint16_t(-100), uint16_t(-95)));
+        REQUIRE(!pdb.isInside(uint16_t(-100), uint16_t(-89)));
+    }
 }
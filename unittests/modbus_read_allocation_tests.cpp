@@ -0,0 +1,117 @@
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+#include <boost/log/core.hpp>
+
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/queue_item.hpp"
+#include "libmodmqttsrv/modbus_executor.hpp"
+#include "libmodmqttsrv/register_poll.hpp"
+
+#include "modbus_utils.hpp"
+#include "../readerwriterqueue/readerwriterqueue.h"
+
+// counts operator new calls made by the current thread
+// while gCountAllocations is set
+static thread_local bool gCountAllocations = false;
+static std::atomic<int> gAllocationCount(0);
+
+void*
+operator new(std::size_t size) {
+    if (gCountAllocations)
+        gAllocationCount++;
+    void* ret = std::malloc(size == 0 ? 1 : size);
+    if (ret == nullptr)
+        throw std::bad_alloc();
+    return ret;
+}
+
+void
+operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+/**
+ * Modbus context that returns the same value for every register
+ * without allocating memory
+ */
+class ConstantModbusContext : public modmqttd::IModbusContext {
+    public:
+        virtual void init(const modmqttd::ModbusNetworkConfig& config) {}
+        virtual void connect() {}
+        virtual bool isConnected() const { return true; }
+        virtual void disconnect() {}
+        virtual std::vector<uint16_t> readModbusRegisters(int slaveId, const modmqttd::RegisterPoll& regData) {
+            return std::vector<uint16_t>(regData.getCount(), mValue);
+        }
+        virtual void readModbusRegistersInto(int slaveId, const modmqttd::RegisterPoll& regData, std::vector<uint16_t>& pValues) {
+            pValues.assign(regData.getCount(), mValue);
+        }
+        virtual void writeModbusRegisters(int slaveId, const modmqttd::RegisterWrite& msg) {}
+        virtual modmqttd::ModbusNetworkConfig::Type getNetworkType() const { return modmqttd::ModbusNetworkConfig::TCPIP; }
+
+        uint16_t mValue = 7;
+};
+
+static int
+pollAll(modmqttd::ModbusExecutor& executor, const ModbusExecutorTestRegisters& registers) {
+    executor.addPollList(registers);
+
+    boost::log::core::get()->set_logging_enabled(false);
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    while(!executor.allDone())
+        executor.executeNext();
+    gCountAllocations = false;
+    boost::log::core::get()->set_logging_enabled(true);
+
+    return gAllocationCount;
+}
+
+TEST_CASE("Unchanged register poll should not allocate memory", "[.][benchmark]") {
+    const int pollCount = 10000;
+
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> fromModbusQueue;
+    moodycamel::BlockingReaderWriterQueue<modmqttd::QueueItem> toModbusQueue;
+
+    std::shared_ptr<ConstantModbusContext> modbus(new ConstantModbusContext());
+    modmqttd::ModbusExecutor executor(fromModbusQueue, toModbusQueue);
+    executor.init(modbus);
+
+    ModbusExecutorTestRegisters registers;
+    for(int i = 1; i <= pollCount; i++)
+        registers.addPoll(1, i);
+
+    // the first poll publishes all values
+    pollAll(executor, registers);
+    modmqttd::QueueItem item;
+    int published = 0;
+    while(fromModbusQueue.try_dequeue(item)) {
+        item.getData<modmqttd::MsgRegisterValues>();
+        published++;
+    }
+    REQUIRE(published == pollCount);
+
+    SECTION("when values are not changed") {
+        int allocations = pollAll(executor, registers);
+
+        REQUIRE(fromModbusQueue.size_approx() == 0);
+        WARN(allocations << " allocation(s) for " << pollCount << " unchanged polls");
+        REQUIRE(allocations == 0);
+    }
+
+    SECTION("when values are changed") {
+        modbus->mValue = 8;
+        int allocations = pollAll(executor, registers);
+
+        REQUIRE(fromModbusQueue.size_approx() == pollCount);
+        REQUIRE(allocations > 0);
+    }
+}
@@ -65,5 +65,69 @@ TEST_CASE("ModbusRequestQueues") {
 
     }
 
+    SECTION("should not merge writes if coalescing is disabled") {
+        REQUIRE(queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 1, 10)));
+        REQUIRE(queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 1, 20)));
+
+        REQUIRE(queue.mWriteQueue.size() == 2);
+    }
+
+    SECTION("should replace queued value for the same register") {
+        REQUIRE(queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 1, 10), true));
+        REQUIRE(!queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 1, 20), true));
+
+        REQUIRE(queue.mWriteQueue.size() == 1);
+        REQUIRE(queue.mWriteQueue.front()->getValues() == std::vector<uint16_t>({20}));
+    }
+
+    SECTION("should merge writes to consecutive registers") {
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 2, 20), true);
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 1, 10), true);
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 3, 30), true);
+
+        REQUIRE(queue.mWriteQueue.size() == 1);
+        const modmqttd::RegisterWrite& cmd(*queue.mWriteQueue.front());
+        REQUIRE(cmd.mRegister == 0);
+        REQUIRE(cmd.getCount() == 3);
+        REQUIRE(cmd.getValues() == std::vector<uint16_t>({10, 20, 30}));
+    }
+
+    SECTION("should not move merged write before later writes") {
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 1, 10), true);
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 5, 1), true);
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 2, 20), true);
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 1, 11), true);
+
+        REQUIRE(queue.mWriteQueue.size() == 3);
+        REQUIRE(queue.mWriteQueue[0]->getValues() == std::vector<uint16_t>({10}));
+        REQUIRE(queue.mWriteQueue[1]->getValues() == std::vector<uint16_t>({1}));
+        REQUIRE(queue.mWriteQueue[2]->getValues() == std::vector<uint16_t>({11, 20}));
+    }
+
+    SECTION("should not merge writes with a gap") {
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 1, 10), true);
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, 3, 30), true);
+
+        REQUIRE(queue.mWriteQueue.size() == 2);
+    }
+
+    SECTION("should not merge writes above protocol limit") {
+        const int maxCount = modmqttd::RegisterWrite::MAX_WRITE_REGISTERS;
+        std::shared_ptr<modmqttd::RegisterWrite> single(ModbusExecutorTestRegisters::createWrite(1, maxCount + 1, 5));
+        std::shared_ptr<modmqttd::RegisterWrite> big(new modmqttd::RegisterWrite(
+            1, 0, modmqttd::RegisterType::HOLDING,
+            ModbusRegisters(std::vector<uint16_t>(maxCount, 1))
+        ));
+
+        queue.addWriteCommand(single, true);
+        queue.addWriteCommand(big, true);
+        REQUIRE(queue.mWriteQueue.size() == 2);
+
+        // last write touching this register is too big to merge,
+        // value cannot be moved before it
+        queue.addWriteCommand(ModbusExecutorTestRegisters::createWrite(1, maxCount + 1, 6), true);
+        REQUIRE(queue.mWriteQueue.size() == 3);
+        REQUIRE(single->getValues() == std::vector<uint16_t>({5}));
+    }
 
 }
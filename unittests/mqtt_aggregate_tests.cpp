@@ -0,0 +1,135 @@
+#include "catch2/catch_all.hpp"
+#include "mockedserver.hpp"
+#include "defaults.hpp"
+#include "yaml_utils.hpp"
+#include "jsonutils.hpp"
+
+TEST_CASE ("aggregate publish mode") {
+
+TestConfig config(R"(
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+mqtt:
+  client_id: mqtt_test
+  refresh: 10ms
+  broker:
+    host: localhost
+  objects:
+    - topic: test_sensor
+      publish_mode: aggregate
+      aggregate_window: 100ms
+      state:
+        register: tcptest.1.2
+)");
+
+    SECTION("should publish aggregated values once per window") {
+        MockedModMqttServerThread server(config.toString());
+        server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 5);
+        server.start();
+        server.waitForPublish("test_sensor/availability");
+        REQUIRE(server.mqttValue("test_sensor/availability") == "1");
+
+        server.waitForPublish("test_sensor/state");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        server.stop();
+
+        server.requirePublishCount("test_sensor/state", 1);
+        rapidjson::Document doc;
+        doc.Parse(server.mqttValue("test_sensor/state").c_str());
+        REQUIRE(doc["min"].GetInt() == 5);
+        REQUIRE(doc["max"].GetInt() == 5);
+        REQUIRE(doc["last"].GetInt() == 5);
+        REQUIRE(doc["count"].GetInt() > 1);
+    }
+}
+
+TEST_CASE ("aggregate publish mode should sample object in many poll groups once per poll") {
+    static const std::string config = R"(
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+      slaves:
+        - address: 1
+          poll_groups:
+            - register: 1
+              count: 10
+            - register: 20
+              count: 5
+mqtt:
+  client_id: mqtt_test
+  refresh: 10ms
+  broker:
+    host: localhost
+  objects:
+    - topic: test_sensor
+      publish_mode: aggregate
+      aggregate_window: 100ms
+      state:
+        - name: first
+          register: tcptest.1.2
+        - name: second
+          register: tcptest.1.20
+)";
+
+    MockedModMqttServerThread server(config);
+    server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 5);
+    server.setModbusRegisterValue("tcptest", 1, 20, modmqttd::RegisterType::HOLDING, 7);
+    server.start();
+    server.waitForPublish("test_sensor/state");
+    server.stop();
+
+    rapidjson::Document doc;
+    doc.Parse(server.mqttValue("test_sensor/state").c_str());
+    REQUIRE(doc["first"]["last"].GetInt() == 5);
+    REQUIRE(doc["second"]["last"].GetInt() == 7);
+
+    // every poll reads both groups
+    int polls = server.mModbusFactory->getMockedModbusContext("tcptest").getReadCount(1) / 2;
+    REQUIRE(doc["first"]["count"].GetInt() > 1);
+    REQUIRE(doc["first"]["count"].GetInt() <= polls);
+    REQUIRE(doc["second"]["count"].GetInt() == doc["first"]["count"].GetInt());
+}
+
+TEST_CASE ("aggregate publish mode should sample register shared with on_change object") {
+    static const std::string config = R"(
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+mqtt:
+  client_id: mqtt_test
+  refresh: 10ms
+  broker:
+    host: localhost
+  objects:
+    - topic: test_sensor
+      publish_mode: aggregate
+      aggregate_window: 100ms
+      state:
+        register: tcptest.1.2
+      availability:
+        register: tcptest.1.3
+        available_value: 1
+    - topic: test_switch
+      state:
+        register: tcptest.1.3
+)";
+
+    MockedModMqttServerThread server(config);
+    server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 5);
+    server.setModbusRegisterValue("tcptest", 1, 3, modmqttd::RegisterType::HOLDING, 1);
+    server.start();
+    server.waitForPublish("test_sensor/state");
+    server.stop();
+
+    rapidjson::Document doc;
+    doc.Parse(server.mqttValue("test_sensor/state").c_str());
+    REQUIRE(doc["count"].GetInt() > 1);
+    server.requirePublishCount("test_switch/state", 1);
+}
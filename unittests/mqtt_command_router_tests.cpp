@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/mqtt_command_router.hpp"
+
+using namespace modmqttd;
+
+static MqttObjectCommand
+command(int pId, const std::string& pTopic, const std::string& pNetwork = "tcptest") {
+    return MqttObjectCommand(pId, pTopic, MqttObjectCommand::PayloadType::STRING, pNetwork, 1, RegisterType::HOLDING, pId);
+}
+
+static bool
+contains(const std::vector<std::string>& pFilters, const std::string& pFilter) {
+    return std::find(pFilters.begin(), pFilters.end(), pFilter) != pFilters.end();
+}
+
+TEST_CASE("MqttCommandRouter") {
+    MqttCommandRouter router;
+    std::vector<std::shared_ptr<ModbusClient>> clients;
+
+    SECTION("should find command by topic") {
+        router.addCommand(command(1, "room1/light/set"), clients);
+        router.addCommand(command(2, "room2/light/set"), clients);
+
+        const MqttCommandRouter::Route* route = router.find("room2/light/set");
+        REQUIRE(route != nullptr);
+        REQUIRE(route->mCommand.getCommandId() == 2);
+        // no modbus clients defined
+        REQUIRE(route->mClient == nullptr);
+
+        REQUIRE(router.find("room3/light/set") == nullptr);
+    }
+
+    SECTION("should create single wildcard filter for commands with the same last level") {
+        router.addCommand(command(1, "room1/light/set"), clients);
+        router.addCommand(command(2, "room2/light/set"), clients);
+        router.addCommand(command(3, "room3/light/set"), clients);
+
+        std::vector<std::string> filters(router.createSubscriptions({"room1/light/state", "room1/light/availability"}));
+        REQUIRE(filters.size() == 1);
+        REQUIRE(filters[0] == "+/light/set");
+    }
+
+    SECTION("should not use wildcard for single command") {
+        router.addCommand(command(1, "room1/light/set"), clients);
+        router.addCommand(command(2, "room1/fan/speed"), clients);
+
+        std::vector<std::string> filters(router.createSubscriptions({}));
+        REQUIRE(filters.size() == 2);
+        REQUIRE(contains(filters, "room1/light/set"));
+        REQUIRE(contains(filters, "room1/fan/speed"));
+    }
+
+    SECTION("should group commands by topic depth") {
+        router.addCommand(command(1, "room1/set"), clients);
+        router.addCommand(command(2, "room2/set"), clients);
+        router.addCommand(command(3, "house/room1/set"), clients);
+        router.addCommand(command(4, "house/room2/set"), clients);
+
+        std::vector<std::string> filters(router.createSubscriptions({}));
+        REQUIRE(filters.size() == 2);
+        REQUIRE(contains(filters, "+/set"));
+        REQUIRE(contains(filters, "house/+/set"));
+    }
+
+    SECTION("should subscribe exact topics if wildcard matches published topic") {
+        router.addCommand(command(1, "room1/set"), clients);
+        router.addCommand(command(2, "room2/set"), clients);
+
+        std::vector<std::string> filters(router.createSubscriptions({"status/set"}));
+        REQUIRE(filters.size() == 2);
+        REQUIRE(contains(filters, "room1/set"));
+        REQUIRE(contains(filters, "room2/set"));
+    }
+}
+
+TEST_CASE("Mqtt topic filter matching") {
+    REQUIRE(MqttCommandRouter::topicMatches("a/b/c", "a/b/c"));
+    REQUIRE(!MqttCommandRouter::topicMatches("a/b/c", "a/b/d"));
+    REQUIRE(MqttCommandRouter::topicMatches("+/b/c", "a/b/c"));
+    REQUIRE(!MqttCommandRouter::topicMatches("+/b/c", "a/b/c/d"));
+    REQUIRE(!MqttCommandRouter::topicMatches("+/b/c", "b/c"));
+    REQUIRE(MqttCommandRouter::topicMatches("a/#", "a/b/c"));
+    REQUIRE(MqttCommandRouter::topicMatches("a/#", "a"));
+    REQUIRE(!MqttCommandRouter::topicMatches("a/#", "b/c"));
+}
@@ -0,0 +1,96 @@
+#include "catch2/catch_all.hpp"
+#include "mockedserver.hpp"
+#include "defaults.hpp"
+#include "yaml_utils.hpp"
+
+TEST_CASE ("deadband") {
+
+TestConfig config(R"(
+modmqttd:
+  converter_search_path:
+    - build/stdconv
+  converter_plugins:
+    - stdconv.so
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+mqtt:
+  client_id: mqtt_test
+  refresh: 10ms
+  broker:
+    host: localhost
+  objects:
+    - topic: test_sensor
+      state:
+        register: tcptest.1.2
+        converter: std.int16()
+        deadband: 2
+)");
+
+    SECTION("should compare signed register values") {
+        MockedModMqttServerThread server(config.toString());
+        server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 0xFFFF);
+        server.start();
+        server.waitForMqttValue("test_sensor/state", "-1");
+
+        // -1 -> 0 is inside deadband
+        server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        server.requirePublishCount("test_sensor/state", 1);
+
+        server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 2);
+        server.waitForMqttValue("test_sensor/state", "2");
+        server.stop();
+    }
+
+    SECTION("should be rejected for value stored in many registers") {
+        config.mYAML["mqtt"]["objects"][0]["state"]["converter"] = "std.int32()";
+        config.mYAML["mqtt"]["objects"][0]["state"]["count"] = 2;
+        MockedModMqttServerThread server(config.toString(), false);
+        server.start();
+        server.stop();
+        REQUIRE(!server.initOk());
+    }
+
+    SECTION("should be rejected for converter that changes register value order") {
+        config.mYAML["mqtt"]["objects"][0]["state"]["converter"] = "std.int8()";
+        MockedModMqttServerThread server(config.toString(), false);
+        server.start();
+        server.stop();
+        REQUIRE(!server.initOk());
+    }
+}
+
+TEST_CASE ("deadband should be rejected for register in list converted to a single value") {
+    static const std::string bad_config = R"(
+modmqttd:
+  converter_search_path:
+    - build/stdconv
+  converter_plugins:
+    - stdconv.so
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+mqtt:
+  client_id: mqtt_test
+  broker:
+    host: localhost
+  objects:
+    - topic: test_sensor
+      state:
+        converter: std.float32()
+        registers:
+          - register: tcptest.1.2
+            deadband: 1
+          - register: tcptest.1.3
+)";
+
+    MockedModMqttServerThread server(bad_config, false);
+    server.start();
+    server.stop();
+    REQUIRE(!server.initOk());
+}
@@ -0,0 +1,56 @@
+#include "catch2/catch_all.hpp"
+#include "mockedserver.hpp"
+#include "defaults.hpp"
+#include "yaml_utils.hpp"
+
+TEST_CASE ("min_publish_interval") {
+
+TestConfig config(R"(
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+mqtt:
+  client_id: mqtt_test
+  refresh: 10ms
+  broker:
+    host: localhost
+  objects:
+    - topic: test_sensor
+      min_publish_interval: 200ms
+      state:
+        register: tcptest.1.2
+)");
+
+    SECTION("should publish only the latest state after interval expires") {
+        MockedModMqttServerThread server(config.toString());
+        server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 1);
+        server.start();
+        server.waitForMqttValue("test_sensor/state", "1");
+
+        server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 3);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        // still waiting for interval to expire
+        server.requirePublishCount("test_sensor/state", 1);
+
+        server.waitForMqttValue("test_sensor/state", "3");
+        server.stop();
+        server.requirePublishCount("test_sensor/state", 2);
+    }
+
+    SECTION("should publish availability change immediately") {
+        config.mYAML["mqtt"]["objects"][0]["availability"]["register"] = "tcptest.1.3";
+        MockedModMqttServerThread server(config.toString());
+        server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::HOLDING, 1);
+        server.setModbusRegisterValue("tcptest", 1, 3, modmqttd::RegisterType::HOLDING, 1);
+        server.start();
+        server.waitForMqttValue("test_sensor/availability", "1");
+
+        server.setModbusRegisterValue("tcptest", 1, 3, modmqttd::RegisterType::HOLDING, 0);
+        server.waitForMqttValue("test_sensor/availability", "0", std::chrono::milliseconds(100));
+        server.stop();
+    }
+}
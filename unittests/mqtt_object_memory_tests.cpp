@@ -0,0 +1,57 @@
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/mqttobject.hpp"
+#include "libmodmqttsrv/mqttpayload.hpp"
+
+using namespace modmqttd;
+
+TEST_CASE("MqttObjectRegisterIdent should not store network name") {
+    // network name is interned in StringPool
+    REQUIRE(sizeof(MqttObjectRegisterIdent) <= 3 * sizeof(int) + sizeof(RegisterType));
+    REQUIRE(MqttObjectRegisterIdent("tcptest", 1, RegisterType::INPUT, 1).mNetworkId
+        == MqttObjectRegisterIdent("tcptest", 2, RegisterType::INPUT, 2).mNetworkId);
+}
+
+// mallinfo2() is available only in glibc
+#ifdef __GLIBC__
+#include <malloc.h>
+
+// bytes allocated from the main arena
+static long
+getHeapUsage() {
+    return mallinfo2().uordblks;
+}
+
+// the same layout as objects created from configuration
+// with a named register list in state section
+static std::vector<std::shared_ptr<MqttObject>>
+createObjects(int pObjectCount, int pRegistersPerObject) {
+    std::vector<std::shared_ptr<MqttObject>> ret;
+    for(int i = 0; i < pObjectCount; i++) {
+        MqttObject obj("building/floor_" + std::to_string(i / 100) + "/device_" + std::to_string(i));
+        for(int r = 0; r < pRegistersPerObject; r++) {
+            MqttObjectDataNode node;
+            node.setName("measurement_" + std::to_string(r));
+            node.setScalarNode(MqttObjectRegisterIdent("tcptest", 1 + i / 100, RegisterType::INPUT, (i % 100) * pRegistersPerObject + r));
+            obj.mState.addDataNode(node);
+        }
+        ret.push_back(std::shared_ptr<MqttObject>(new MqttObject(obj)));
+        ret.back()->setLastPublishedPayload(MqttPayload::generate(*ret.back()));
+    }
+    return ret;
+}
+
+TEST_CASE("Memory used by MqttObjects of large configuration", "[.][benchmark]") {
+    const int objectCount = 10000;
+    const int registersPerObject = 10;
+
+    long before = getHeapUsage();
+    std::vector<std::shared_ptr<MqttObject>> objects(createObjects(objectCount, registersPerObject));
+    long after = getHeapUsage();
+
+    REQUIRE(objects.back()->mState.getNodes().size() == registersPerObject);
+    WARN(objectCount * registersPerObject << " registers in " << objectCount << " objects: "
+        << (after - before) / 1024 << " kB, MqttObjectDataNode size " << sizeof(MqttObjectDataNode));
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include <chrono>
+
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/mqttpayload.hpp"
+#include "jsonutils.hpp"
+
+using namespace modmqttd;
+
+static MqttObject
+createObject(int pCount) {
+    MqttObject ret("test");
+    for(int i = 0; i < pCount; i++) {
+        MqttObjectDataNode node;
+        node.setName("r" + std::to_string(i));
+        node.setScalarNode(MqttObjectRegisterIdent("tcptest", 1, RegisterType::HOLDING, i));
+        ret.mState.addDataNode(node);
+    }
+    return ret;
+}
+
+static void
+setValues(MqttObject& pObj, int pCount, uint16_t pValue) {
+    std::vector<uint16_t> values(pCount, pValue);
+    pObj.updateRegisterValues(
+        StringPool::networkNames().find("tcptest"),
+        MsgRegisterValues(1, RegisterType::HOLDING, 0, values)
+    );
+}
+
+TEST_CASE("MqttPayload for changed nodes") {
+    MqttObject obj(createObject(3));
+    setValues(obj, 3, 1);
+    REQUIRE_JSON(MqttPayload::generate(obj), R"({"r0":1,"r1":1,"r2":1})");
+
+    SECTION("should output changed value") {
+        std::vector<uint16_t> values({1, 5, 1});
+        obj.updateRegisterValues(
+            StringPool::networkNames().find("tcptest"),
+            MsgRegisterValues(1, RegisterType::HOLDING, 0, values)
+        );
+        REQUIRE(obj.mState.getNodes()[0].hasJsonCache());
+        REQUIRE(!obj.mState.getNodes()[1].hasJsonCache());
+        REQUIRE_JSON(MqttPayload::generate(obj), R"({"r0":1,"r1":5,"r2":1})");
+        REQUIRE(obj.mState.getNodes()[1].hasJsonCache());
+    }
+
+    SECTION("should output the same payload when values are not changed") {
+        REQUIRE_JSON(MqttPayload::generate(obj), R"({"r0":1,"r1":1,"r2":1})");
+    }
+}
+
+TEST_CASE("MqttObject state change flag") {
+    MqttObject obj(createObject(2));
+    REQUIRE(obj.isStateChanged());
+
+    setValues(obj, 2, 1);
+    obj.setLastPublishedPayload(MqttPayload::generate(obj));
+    REQUIRE(!obj.isStateChanged());
+
+    SECTION("should not be set if values are the same") {
+        setValues(obj, 2, 1);
+        REQUIRE(!obj.isStateChanged());
+    }
+
+    SECTION("should be set if value is changed") {
+        setValues(obj, 2, 2);
+        REQUIRE(obj.isStateChanged());
+    }
+}
+
+TEST_CASE("MqttPayload generation with a single changed value", "[.][benchmark]") {
+    const int nodeCount = 40;
+    const int rounds = 10000;
+
+    MqttObject obj(createObject(nodeCount));
+    setValues(obj, nodeCount, 1);
+    MqttPayload::generate(obj);
+
+    int networkId = StringPool::networkNames().find("tcptest");
+    std::vector<uint16_t> value(1);
+    std::size_t totalSize = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < rounds; i++) {
+        value[0] = i;
+        obj.updateRegisterValues(networkId, MsgRegisterValues(1, RegisterType::HOLDING, i % nodeCount, value));
+        totalSize += MqttPayload::generate(obj).size();
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(totalSize > 0);
+    WARN(rounds << " payloads of " << nodeCount << " values with one changed value: " << duration.count() << "us");
+}
+
+TEST_CASE("MqttPayload for aggregated values") {
+    MqttObject obj(createObject(2));
+
+    setValues(obj, 2, 4);
+    obj.aggregateState();
+    setValues(obj, 2, 1);
+    obj.aggregateState();
+    REQUIRE(obj.hasAggregatedValues());
+
+    REQUIRE_JSON(MqttPayload::generateAggregate(obj),
+        R"({"r0":{"min":1,"max":4,"avg":2.5,"last":1,"count":2},"r1":{"min":1,"max":4,"avg":2.5,"last":1,"count":2}})");
+
+    SECTION("should start with empty window after publish") {
+        obj.startNextAggregateWindow();
+        REQUIRE(!obj.hasAggregatedValues());
+
+        setValues(obj, 2, 7);
+        obj.aggregateState();
+        REQUIRE_JSON(MqttPayload::generateAggregate(obj),
+            R"({"r0":{"min":7,"max":7,"avg":7,"last":7,"count":1},"r1":{"min":7,"max":7,"avg":7,"last":7,"count":1}})");
+    }
+}
@@ -296,3 +296,325 @@ TEST_CASE ("Old style poll groups should work as usual") {
     server.stop();
 }
 
+
+static const std::string max_gap_config = R"(
+modmqttd:
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+      max_gap: 3
+      slaves:
+        - address: 2
+          max_gap: 0
+mqtt:
+  client_id: mqtt_test
+  refresh: 1s
+  broker:
+    host: localhost
+  objects:
+    - topic: first_state
+      state:
+        register: tcptest.1.1
+    - topic: second_state
+      state:
+        register: tcptest.1.5
+    - topic: third_state
+      state:
+        register: tcptest.2.1
+    - topic: fourth_state
+      state:
+        register: tcptest.2.3
+)";
+
+TEST_CASE ("Poll groups separated by max_gap registers should be read with single command") {
+    MockedModMqttServerThread server(max_gap_config);
+    server.setModbusRegisterValue("tcptest", 1, 1, modmqttd::RegisterType::HOLDING, 1);
+    server.setModbusRegisterValue("tcptest", 1, 3, modmqttd::RegisterType::HOLDING, 3);
+    server.setModbusRegisterValue("tcptest", 1, 5, modmqttd::RegisterType::HOLDING, 5);
+    server.setModbusRegisterValue("tcptest", 2, 1, modmqttd::RegisterType::HOLDING, 21);
+    server.setModbusRegisterValue("tcptest", 2, 3, modmqttd::RegisterType::HOLDING, 23);
+
+    server.start();
+
+    server.waitForPublish("first_state/state");
+    REQUIRE(server.mqttValue("first_state/state") == "1");
+    server.waitForPublish("second_state/state");
+    REQUIRE(server.mqttValue("second_state/state") == "5");
+    server.waitForPublish("third_state/state");
+    server.waitForPublish("fourth_state/state");
+
+    REQUIRE(server.mModbusFactory->getMockedModbusContext("tcptest").getReadCount(1) == 1);
+    REQUIRE(server.mModbusFactory->getMockedModbusContext("tcptest").getReadCount(2) == 2);
+
+    // register in gap is not delivered to mqtt objects
+    server.setModbusRegisterValue("tcptest", 1, 3, modmqttd::RegisterType::HOLDING, 30);
+    server.setModbusRegisterValue("tcptest", 1, 5, modmqttd::RegisterType::HOLDING, 50);
+    server.waitForPublish("second_state/state", defaultWaitTime(std::chrono::milliseconds(1500)));
+    REQUIRE(server.mqttValue("second_state/state") == "50");
+
+    server.stop();
+
+    server.requirePublishCount("first_state/state", 1);
+}
+
+static const std::string split_config = R"(
+modmqttd:
+  converter_search_path:
+    - build/stdconv
+  converter_plugins:
+    - stdconv.so
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+      slaves:
+        - address: 1
+          poll_groups:
+            - register: 1
+              count: 400
+        - address: 2
+          max_read_registers: 3
+          poll_groups:
+            - register: 1
+              count: 4
+mqtt:
+  client_id: mqtt_test
+  refresh: 1s
+  broker:
+    host: localhost
+  objects:
+    - topic: first_state
+      state:
+        register: tcptest.1.1
+    - topic: second_state
+      state:
+        register: tcptest.1.150
+    - topic: third_state
+      state:
+        register: tcptest.2.1
+    - topic: fourth_state
+      state:
+        converter: std.int32()
+        register: tcptest.2.3
+        count: 2
+)";
+
+TEST_CASE ("Poll groups over read limit should be split") {
+    MockedModMqttServerThread server(split_config);
+    server.setModbusRegisterValue("tcptest", 1, 1, modmqttd::RegisterType::HOLDING, 1);
+    server.setModbusRegisterValue("tcptest", 1, 150, modmqttd::RegisterType::HOLDING, 150);
+    server.setModbusRegisterValue("tcptest", 2, 1, modmqttd::RegisterType::HOLDING, 1);
+    server.setModbusRegisterValue("tcptest", 2, 3, modmqttd::RegisterType::HOLDING, 0);
+    server.setModbusRegisterValue("tcptest", 2, 4, modmqttd::RegisterType::HOLDING, 2);
+
+    server.start();
+
+    server.waitForPublish("first_state/state");
+    REQUIRE(server.mqttValue("first_state/state") == "1");
+    server.waitForPublish("second_state/state");
+    REQUIRE(server.mqttValue("second_state/state") == "150");
+    server.waitForPublish("third_state/state");
+    REQUIRE(server.mqttValue("third_state/state") == "1");
+    server.waitForPublish("fourth_state/state");
+    REQUIRE(server.mqttValue("fourth_state/state") == "2");
+
+    // registers 251-400 are not used and not polled
+    REQUIRE(server.mModbusFactory->getMockedModbusContext("tcptest").getReadCount(1) == 2);
+    // int32 value in registers 3-4 is not split between reads 1-3 and 4
+    REQUIRE(server.mModbusFactory->getMockedModbusContext("tcptest").getReadCount(2) == 2);
+
+    server.stop();
+}
+
+TEST_CASE ("Value longer than max_read_registers should be rejected") {
+    static const std::string bad_config = R"(
+modmqttd:
+  converter_search_path:
+    - build/stdconv
+  converter_plugins:
+    - stdconv.so
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+      slaves:
+        - address: 1
+          max_read_registers: 1
+mqtt:
+  client_id: mqtt_test
+  broker:
+    host: localhost
+  objects:
+    - topic: one
+      state:
+        converter: std.int32()
+        register: tcptest.1.1
+        count: 2
+)";
+
+    MockedModMqttServerThread server(bad_config, false);
+    server.start();
+    server.stop();
+    REQUIRE(!server.initOk());
+}
+
+static const std::string illegal_address_config = R"(
+modmqttd:
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+      max_gap: 3
+      register_layout_file: )" + (std::filesystem::temp_directory_path() / "modmqttd_poll_groups_layout").string() + R"(
+mqtt:
+  client_id: mqtt_test
+  refresh: 1s
+  broker:
+    host: localhost
+  objects:
+    - topic: first_state
+      state:
+        register: tcptest.1.1
+    - topic: second_state
+      state:
+        register: tcptest.1.5
+)";
+
+TEST_CASE ("Poll group rejected with illegal data address should be split") {
+    std::string layoutPath((std::filesystem::temp_directory_path() / "modmqttd_poll_groups_layout").string());
+    std::remove(layoutPath.c_str());
+
+    MockedModMqttServerThread server(illegal_address_config);
+    server.setModbusRegisterValue("tcptest", 1, 1, modmqttd::RegisterType::HOLDING, 1);
+    server.setModbusRegisterValue("tcptest", 1, 5, modmqttd::RegisterType::HOLDING, 5);
+    server.setModbusRegisterIllegalAddress("tcptest", 1, 3, modmqttd::RegisterType::HOLDING);
+
+    server.start();
+
+    server.waitForPublish("first_state/state");
+    REQUIRE(server.mqttValue("first_state/state") == "1");
+    server.waitForPublish("second_state/state");
+    REQUIRE(server.mqttValue("second_state/state") == "5");
+
+    server.stop();
+
+    // rejected read and two reads after split
+    REQUIRE(server.mModbusFactory->getMockedModbusContext("tcptest").getReadCount(1) == 3);
+
+    std::ifstream in(layoutPath);
+    std::string line;
+    std::getline(in, line);
+    REQUIRE(line == "1 3 0 5 0:1 4:1");
+    in.close();
+
+    // learned layout is used on the next start
+    MockedModMqttServerThread server2(illegal_address_config);
+    server2.setModbusRegisterValue("tcptest", 1, 1, modmqttd::RegisterType::HOLDING, 1);
+    server2.setModbusRegisterValue("tcptest", 1, 5, modmqttd::RegisterType::HOLDING, 5);
+    server2.setModbusRegisterIllegalAddress("tcptest", 1, 3, modmqttd::RegisterType::HOLDING);
+
+    server2.start();
+    server2.waitForPublish("first_state/state");
+    server2.waitForPublish("second_state/state");
+    server2.stop();
+
+    REQUIRE(server2.mModbusFactory->getMockedModbusContext("tcptest").getReadCount(1) == 2);
+
+    std::remove(layoutPath.c_str());
+}
+
+TEST_CASE ("Poll group split should publish values equal to zero") {
+    std::string layoutPath((std::filesystem::temp_directory_path() / "modmqttd_poll_groups_layout").string());
+    std::remove(layoutPath.c_str());
+
+    MockedModMqttServerThread server(illegal_address_config);
+    server.setModbusRegisterValue("tcptest", 1, 1, modmqttd::RegisterType::HOLDING, 0);
+    server.setModbusRegisterValue("tcptest", 1, 5, modmqttd::RegisterType::HOLDING, 5);
+    server.setModbusRegisterIllegalAddress("tcptest", 1, 3, modmqttd::RegisterType::HOLDING);
+
+    server.start();
+
+    // parts created after split have no values sent yet,
+    // so zero is published even if it is equal to initial buffer value
+    server.waitForPublish("first_state/state");
+    REQUIRE(server.mqttValue("first_state/state") == "0");
+    server.waitForPublish("first_state/availability");
+    REQUIRE(server.mqttValue("first_state/availability") == "1");
+    server.waitForPublish("second_state/state");
+    REQUIRE(server.mqttValue("second_state/state") == "5");
+
+    server.stop();
+
+    std::remove(layoutPath.c_str());
+}
+
+static const std::string config3 = R"(
+modmqttd:
+  converter_search_path:
+    - build/stdconv
+  converter_plugins:
+    - stdconv.so
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+      slaves:
+        - address: 1
+          poll_groups:
+            - register: 1
+              register_type: input
+              count: 4
+mqtt:
+  client_id: mqtt_test
+  refresh: 10ms
+  broker:
+    host: localhost
+  objects:
+    - topic: first_state
+      state:
+        converter: std.divide(10,1)
+        register: tcptest.1.1
+        register_type: input
+    - topic: second_state
+      state:
+        converter: std.divide(10,1)
+        register: tcptest.1.2
+        register_type: input
+    - topic: int32_state
+      state:
+        converter: std.int32()
+        register: tcptest.1.3
+        register_type: input
+        count: 2
+)";
+
+
+TEST_CASE ("Values with the same converter in poll group should be converted in batch") {
+    MockedModMqttServerThread server(config3);
+    server.setModbusRegisterValue("tcptest", 1, 1, modmqttd::RegisterType::INPUT, 11);
+    server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::INPUT, 22);
+    server.setModbusRegisterValue("tcptest", 1, 3, modmqttd::RegisterType::INPUT, 1);
+    server.setModbusRegisterValue("tcptest", 1, 4, modmqttd::RegisterType::INPUT, 2);
+
+    server.start();
+
+    server.waitForMqttValue("first_state/state", "1.1");
+    server.waitForMqttValue("second_state/state", "2.2");
+    server.waitForMqttValue("int32_state/state", "65538");
+
+    server.setModbusRegisterValue("tcptest", 1, 2, modmqttd::RegisterType::INPUT, 33);
+    server.setModbusRegisterValue("tcptest", 1, 4, modmqttd::RegisterType::INPUT, 3);
+
+    server.waitForMqttValue("second_state/state", "3.3");
+    server.waitForMqttValue("int32_state/state", "65539");
+
+    server.stop();
+
+    server.requirePublishCount("first_state/state", 1);
+}
@@ -0,0 +1,160 @@
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/mqtt_publish_queue.hpp"
+
+using namespace modmqttd;
+
+class AckingMqttImpl : public IMqttImpl {
+    public:
+        struct Message {
+            std::string mTopic;
+            std::string mPayload;
+            bool mRetain;
+        };
+
+        virtual void init(MqttClient* owner, const char* clientId) {}
+        virtual void connect(const MqttBrokerConfig& config) {}
+        virtual void reconnect() {}
+        virtual void disconnect() {}
+        virtual void stop() {}
+        virtual void subscribe(const char* topic) {}
+        virtual bool publish(const char* topic, int len, const void* data, bool retain) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mPublished.push_back(Message{topic, std::string(static_cast<const char*>(data), len), retain});
+            return mAck;
+        }
+        virtual void on_disconnect(int rc) {}
+        virtual void on_connect(int rc) {}
+        virtual void on_log(int level, const char* message) {}
+
+        bool mAck = true;
+        std::vector<Message> mPublished;
+        std::mutex mMutex;
+};
+
+// publish() of mSlowPayload signals mSending and returns after a delay
+class SlowMqttImpl : public AckingMqttImpl {
+    public:
+        virtual bool publish(const char* topic, int len, const void* data, bool retain) {
+            if (std::string(static_cast<const char*>(data), len) == mSlowPayload) {
+                mSending.set_value();
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            return AckingMqttImpl::publish(topic, len, data, retain);
+        }
+
+        std::string mSlowPayload;
+        std::promise<void> mSending;
+};
+
+static void
+publish(MqttPublishQueue& pQueue, const std::string& pTopic, const std::string& pPayload, MqttPublishQueue::Priority pPriority = MqttPublishQueue::STATE) {
+    pQueue.publish(pTopic, pPayload.length(), pPayload.c_str(), true, pPriority);
+}
+
+TEST_CASE("MqttPublishQueue") {
+    std::shared_ptr<AckingMqttImpl> impl(new AckingMqttImpl());
+    MqttPublishQueue queue;
+    queue.setMqttImplementation(impl);
+
+    SECTION("should publish directly without in-flight limit") {
+        publish(queue, "test/state", "1");
+        publish(queue, "test/state", "2");
+
+        REQUIRE(impl->mPublished.size() == 2);
+        REQUIRE(queue.getPendingCount() == 0);
+    }
+
+    SECTION("with in-flight limit") {
+        queue.setMaxInFlight(1);
+        publish(queue, "test/state", "1");
+        REQUIRE(impl->mPublished.size() == 1);
+        REQUIRE(queue.getInFlightCount() == 1);
+
+        SECTION("should keep the latest payload for a topic") {
+            publish(queue, "test/state", "2");
+            publish(queue, "test/state", "3");
+            REQUIRE(queue.getPendingCount() == 1);
+            REQUIRE(queue.getReplacedCount() == 1);
+
+            queue.onPublished();
+            REQUIRE(impl->mPublished.size() == 2);
+            REQUIRE(impl->mPublished[1].mPayload == "3");
+            REQUIRE(queue.getPendingCount() == 0);
+        }
+
+        SECTION("should send availability before state") {
+            publish(queue, "test1/state", "2");
+            publish(queue, "test1/availability", "1", MqttPublishQueue::AVAILABILITY);
+            publish(queue, "test2/state", "3");
+
+            queue.onPublished();
+            queue.onPublished();
+            queue.onPublished();
+
+            REQUIRE(impl->mPublished.size() == 4);
+            REQUIRE(impl->mPublished[1].mTopic == "test1/availability");
+            REQUIRE(impl->mPublished[2].mTopic == "test1/state");
+            REQUIRE(impl->mPublished[3].mTopic == "test2/state");
+        }
+
+        SECTION("should not count messages that are not acknowledged") {
+            impl->mAck = false;
+            publish(queue, "test/state", "2");
+            publish(queue, "test/state", "3");
+
+            queue.onPublished();
+            REQUIRE(impl->mPublished.size() == 2);
+            REQUIRE(queue.getInFlightCount() == 0);
+
+            publish(queue, "test/state", "4");
+            REQUIRE(impl->mPublished.size() == 3);
+        }
+
+        SECTION("should drop pending messages after clear") {
+            publish(queue, "test/state", "2");
+            queue.clear();
+            REQUIRE(queue.getPendingCount() == 0);
+            REQUIRE(queue.getInFlightCount() == 0);
+
+            publish(queue, "test/state", "3");
+            REQUIRE(impl->mPublished.size() == 2);
+            REQUIRE(impl->mPublished[1].mPayload == "3");
+        }
+    }
+}
+
+TEST_CASE("MqttPublishQueue should not reorder payloads sent from different threads") {
+    std::shared_ptr<SlowMqttImpl> impl(new SlowMqttImpl());
+    MqttPublishQueue queue;
+    queue.setMqttImplementation(impl);
+    queue.setMaxInFlight(2);
+
+    publish(queue, "test1/state", "1");
+    publish(queue, "test2/state", "1");
+    publish(queue, "test1/state", "2");
+    REQUIRE(queue.getPendingCount() == 1);
+
+    // mqtt library thread confirms the first message
+    // and starts sending the pending one
+    impl->mSlowPayload = "2";
+    std::future<void> sending(impl->mSending.get_future());
+    std::thread mqttThread([&queue]() { queue.onPublished(); });
+    sending.wait();
+
+    // main thread publishes a newer payload while
+    // the pending one is being sent
+    queue.onPublished();
+    publish(queue, "test1/state", "3");
+    mqttThread.join();
+
+    REQUIRE(impl->mPublished.size() == 4);
+    REQUIRE(impl->mPublished[2].mPayload == "2");
+    REQUIRE(impl->mPublished[3].mPayload == "3");
+}
@@ -0,0 +1,60 @@
+#include "catch2/catch_all.hpp"
+#include "mockedserver.hpp"
+#include "defaults.hpp"
+#include "yaml_utils.hpp"
+
+TEST_CASE ("republish_rate") {
+
+TestConfig config(R"(
+modbus:
+  networks:
+    - name: tcptest
+      address: localhost
+      port: 501
+mqtt:
+  client_id: mqtt_test
+  refresh: 10ms
+  broker:
+    host: localhost
+    republish_rate: 10
+  objects:
+    - topic: sensor1
+      state:
+        register: tcptest.1.1
+    - topic: sensor2
+      state:
+        register: tcptest.1.2
+    - topic: sensor3
+      state:
+        register: tcptest.1.3
+    - topic: sensor4
+      state:
+        register: tcptest.1.4
+    - topic: sensor5
+      state:
+        register: tcptest.1.5
+)");
+
+    SECTION("should spread republish of all objects after broker restart") {
+        MockedModMqttServerThread server(config.toString());
+        for(int i = 1; i <= 5; i++)
+            server.setModbusRegisterValue("tcptest", 1, i, modmqttd::RegisterType::HOLDING, i);
+        server.start();
+        server.waitForMqttValue("sensor5/state", "5");
+
+        auto start = std::chrono::steady_clock::now();
+        server.mMqtt->resetBroker();
+
+        server.waitForMqttValue("sensor1/state", "1");
+        server.waitForMqttValue("sensor2/state", "2");
+        server.waitForMqttValue("sensor3/state", "3");
+        server.waitForMqttValue("sensor4/state", "4");
+        server.waitForMqttValue("sensor5/state", "5");
+
+        // 10 objects per second, last object is published after 400ms
+        auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        REQUIRE(dur.count() >= 350);
+
+        server.stop();
+    }
+}
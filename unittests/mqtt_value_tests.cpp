@@ -60,3 +60,47 @@ TEST_CASE("MqttValue::fromString should parse") {
         REQUIRE(8 == intval);
     }
 }
+
+TEST_CASE("MqttValue should store binary data") {
+    SECTION("inline if it fits in internal buffer") {
+        std::string data("short");
+        MqttValue val(MqttValue::fromBinary(data.c_str(), data.length()));
+
+        REQUIRE(val.getBinarySize() == data.length());
+        REQUIRE(val.getString() == data);
+        REQUIRE(val.getBinaryPtr() != MqttValue(val).getBinaryPtr());
+    }
+
+    SECTION("in buffer shared between copies if it is too big") {
+        std::string data(MqttValue::MAX_INLINE_SIZE + 1, 'x');
+        MqttValue val(MqttValue::fromBinary(data.c_str(), data.length()));
+        MqttValue copy(val);
+
+        REQUIRE(copy.getString() == data);
+        REQUIRE(val.getBinaryPtr() == copy.getBinaryPtr());
+    }
+
+    SECTION("with embedded null bytes") {
+        const char data[] = {'a', 0, 'b'};
+        MqttValue val(MqttValue::fromBinary(data, sizeof(data)));
+
+        REQUIRE(val.getString() == std::string(data, sizeof(data)));
+    }
+
+    SECTION("with size set by setBinary") {
+        MqttValue val(MqttValue::fromInt(1));
+        std::string data(MqttValue::MAX_INLINE_SIZE * 2, 'y');
+        val.setBinary(data.c_str(), data.length());
+        REQUIRE(val.getString() == data);
+
+        val.setString("abc");
+        REQUIRE(val.getBinarySize() == 3);
+        REQUIRE(val.getString() == "abc");
+    }
+}
+
+TEST_CASE("MqttValue should format integers") {
+    REQUIRE(MqttValue::fromInt(-123).getString() == "-123");
+    REQUIRE(MqttValue::fromInt64(INT64_MIN).getString() == "-9223372036854775808");
+    REQUIRE(MqttValue::fromDouble(-5.0).getString() == "-5");
+}
@@ -0,0 +1,38 @@
+#include <poll.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/queue_signal.hpp"
+
+static bool
+isSignalled(const modmqttd::QueueSignal& signal) {
+    struct pollfd pfd = {};
+    pfd.fd = signal.getFd();
+    pfd.events = POLLIN;
+    return poll(&pfd, 1, 0) == 1;
+}
+
+TEST_CASE("QueueSignal") {
+    modmqttd::QueueSignal signal;
+    REQUIRE(!isSignalled(signal));
+
+    SECTION("should be readable after notify") {
+        signal.notify();
+        REQUIRE(isSignalled(signal));
+    }
+
+    SECTION("should coalesce notifications until cleared") {
+        signal.notify();
+        signal.notify();
+        signal.notify();
+        signal.clear();
+        REQUIRE(!isSignalled(signal));
+    }
+
+    SECTION("should be readable again after clear") {
+        signal.notify();
+        signal.clear();
+        signal.notify();
+        REQUIRE(isSignalled(signal));
+    }
+}
@@ -49,7 +49,7 @@ mqtt:
 TEST_CASE ("Start and stop real server that cannot connect to anything") {
     ModMqttServerThread server(config);
     server.start();
-    // we need to sleep to let mqtt server to start waiting on gHasMessagesCondition
+    // we need to sleep to let mqtt server to start waiting on main loop signal
     // in mqtt initial connection loop
     // otherwise stop signal is missed and test will last for 5 seconds
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
@@ -0,0 +1,151 @@
+#include <chrono>
+
+#include <boost/log/core.hpp>
+
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/register_dispatch_index.hpp"
+
+using namespace modmqttd;
+
+static std::shared_ptr<MqttObject>
+createObject(const std::string& pTopic, const std::string& pNetwork, int pSlaveId, RegisterType pType, int pFirstRegister, int pCount) {
+    std::shared_ptr<MqttObject> ret(new MqttObject(pTopic));
+    for(int i = 0; i < pCount; i++) {
+        MqttObjectDataNode node;
+        node.setScalarNode(MqttObjectRegisterIdent(pNetwork, pSlaveId, pType, pFirstRegister + i));
+        ret->mState.addDataNode(node);
+    }
+    return ret;
+}
+
+static std::vector<uint16_t>
+createValues(int pCount, uint16_t pFirst) {
+    std::vector<uint16_t> ret;
+    for(int i = 0; i < pCount; i++)
+        ret.push_back(pFirst + i);
+    return ret;
+}
+
+static void
+dispatch(const RegisterDispatchIndex& pIndex, const std::string& pNetwork, const MsgRegisterValues& pValues) {
+    const RegisterDispatchIndex::Group* group = pIndex.findGroup(StringPool::networkNames().find(pNetwork), pValues);
+    REQUIRE(group != nullptr);
+    std::vector<char> changed(group->mObjects->size(), false);
+    for(std::size_t i = group->mFirstSlot; i < group->mFirstSlot + group->mSlotCount; i++) {
+        const RegisterDispatchIndex::Slot& slot(pIndex.getSlot(i));
+        if (slot.mNode->setScalarValue(pValues.mRegisters.getValue(slot.mOffset)))
+            changed[slot.mObjectIndex] = true;
+    }
+    for(std::size_t i = 0; i < changed.size(); i++)
+        (*group->mObjects)[i]->valuesUpdated(changed[i]);
+}
+
+TEST_CASE("RegisterDispatchIndex") {
+    // object with registers from two poll groups
+    std::shared_ptr<MqttObject> obj1(createObject("obj1", "tcptest", 1, RegisterType::HOLDING, 1, 4));
+    // the same register numbers on other network and register type
+    std::shared_ptr<MqttObject> obj2(createObject("obj2", "rtutest", 1, RegisterType::HOLDING, 1, 2));
+    std::shared_ptr<MqttObject> obj3(createObject("obj3", "tcptest", 1, RegisterType::INPUT, 1, 2));
+
+    RegisterDispatchIndex::ObjectMap objects;
+    objects[MqttObjectRegisterIdent("tcptest", 1, RegisterType::HOLDING, 1)].push_back(obj1);
+    objects[MqttObjectRegisterIdent("tcptest", 1, RegisterType::HOLDING, 3)].push_back(obj1);
+    objects[MqttObjectRegisterIdent("rtutest", 1, RegisterType::HOLDING, 1)].push_back(obj2);
+    objects[MqttObjectRegisterIdent("tcptest", 1, RegisterType::INPUT, 1)].push_back(obj3);
+
+    RegisterDispatchIndex index;
+    index.build(objects);
+
+    REQUIRE(index.getSlotCount() == 8);
+
+    SECTION("should map poll group to its scalar nodes only") {
+        const RegisterDispatchIndex::Group* group = index.findGroup(
+            StringPool::networkNames().find("tcptest"), ModbusSlaveAddressRange(1, 1, RegisterType::HOLDING, 2)
+        );
+        REQUIRE(group != nullptr);
+        REQUIRE(group->mSlotCount == 2);
+        REQUIRE(index.getSlot(group->mFirstSlot).mOffset == 0);
+        REQUIRE(index.getSlot(group->mFirstSlot + 1).mOffset == 1);
+
+        group = index.findGroup(
+            StringPool::networkNames().find("tcptest"), ModbusSlaveAddressRange(1, 3, RegisterType::HOLDING, 2)
+        );
+        REQUIRE(group != nullptr);
+        REQUIRE(group->mSlotCount == 2);
+        REQUIRE(index.getSlot(group->mFirstSlot).mNode->getRegisterIdent().mRegisterNumber == 3);
+        REQUIRE(index.getSlot(group->mFirstSlot).mOffset == 0);
+    }
+
+    SECTION("should not find group for unknown register") {
+        REQUIRE(index.findGroup(
+            StringPool::networkNames().find("tcptest"), ModbusSlaveAddressRange(1, 2, RegisterType::HOLDING, 2)
+        ) == nullptr);
+        REQUIRE(index.findGroup(
+            StringPool::networkNames().find("tcptest"), ModbusSlaveAddressRange(2, 1, RegisterType::HOLDING, 2)
+        ) == nullptr);
+    }
+
+    SECTION("should update nodes of a single network") {
+        dispatch(index, "tcptest", MsgRegisterValues(1, RegisterType::HOLDING, 1, createValues(2, 10)));
+        dispatch(index, "tcptest", MsgRegisterValues(1, RegisterType::HOLDING, 3, createValues(2, 12)));
+
+        REQUIRE(obj1->getAvailableFlag() == AvailableFlag::True);
+        REQUIRE(obj1->mState.getNodes()[3].getRawValue() == 13);
+        REQUIRE(obj2->getAvailableFlag() == AvailableFlag::NotSet);
+        REQUIRE(obj3->getAvailableFlag() == AvailableFlag::NotSet);
+    }
+}
+
+TEST_CASE("RegisterDispatchIndex update of 50k scalar nodes", "[.][benchmark]") {
+    const int objectCount = 1000;
+    const int registersPerObject = 50;
+    const int rounds = 20;
+
+    RegisterDispatchIndex::ObjectMap objects;
+    std::vector<std::shared_ptr<MqttObject>> objectList;
+    for(int i = 0; i < objectCount; i++) {
+        int first = i * registersPerObject;
+        std::shared_ptr<MqttObject> obj(createObject("obj" + std::to_string(i), "tcptest", 1, RegisterType::HOLDING, first, registersPerObject));
+        objects[MqttObjectRegisterIdent("tcptest", 1, RegisterType::HOLDING, first)].push_back(obj);
+        objectList.push_back(obj);
+    }
+
+    RegisterDispatchIndex index;
+    index.build(objects);
+    REQUIRE(index.getSlotCount() == objectCount * registersPerObject);
+
+    std::vector<MsgRegisterValues> messages;
+    for(int i = 0; i < objectCount; i++)
+        messages.push_back(MsgRegisterValues(1, RegisterType::HOLDING, i * registersPerObject, createValues(registersPerObject, i)));
+
+    boost::log::core::get()->set_logging_enabled(false);
+
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < rounds; r++) {
+        for(const MsgRegisterValues& msg: messages) {
+            MqttObjectRegisterIdent ident("tcptest", msg);
+            auto it = objects.find(ident);
+            for(std::shared_ptr<MqttObject>& obj: it->second)
+                obj->updateRegisterValues(ident.mNetworkId, msg);
+        }
+    }
+    auto treeTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for(int r = 0; r < rounds; r++) {
+        for(const MsgRegisterValues& msg: messages)
+            dispatch(index, "tcptest", msg);
+    }
+    auto indexTime = std::chrono::steady_clock::now() - start;
+
+    boost::log::core::get()->set_logging_enabled(true);
+
+    for(const std::shared_ptr<MqttObject>& obj: objectList)
+        REQUIRE(obj->getAvailableFlag() == AvailableFlag::True);
+    REQUIRE(objectList.back()->mState.getNodes().back().getRawValue() == objectCount - 1 + registersPerObject - 1);
+
+    WARN(objectCount * registersPerObject << " scalar nodes, " << rounds << " rounds: tree walk "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(treeTime).count() << "ms, index "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(indexTime).count() << "ms");
+}
@@ -0,0 +1,139 @@
+#include <filesystem>
+#include <fstream>
+
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/register_layout.hpp"
+
+std::shared_ptr<modmqttd::RegisterPoll>
+createCoalescedPoll(const std::vector<std::pair<int,int>>& ranges) {
+    int first = ranges.front().first;
+    int last = ranges.back().first + ranges.back().second - 1;
+    std::shared_ptr<modmqttd::RegisterPoll> ret(new modmqttd::RegisterPoll(
+        1, first, modmqttd::RegisterType::HOLDING, last - first + 1,
+        std::chrono::milliseconds(100), modmqttd::PublishMode::ON_CHANGE
+    ));
+    for(const auto& range: ranges)
+        ret->mDeliveryRanges.push_back(modmqttd::ModbusAddressRange(range.first, modmqttd::RegisterType::HOLDING, range.second));
+    return ret;
+}
+
+TEST_CASE("RegisterPoll bisect tests") {
+
+    SECTION("Bisect should split at middle delivery range boundary") {
+        std::shared_ptr<modmqttd::RegisterPoll> reg(createCoalescedPoll({{1,2},{5,1},{8,2},{12,1}}));
+        reg->mReadErrors = 2;
+
+        std::vector<std::shared_ptr<modmqttd::RegisterPoll>> parts(reg->bisect());
+
+        REQUIRE(parts.size() == 2);
+        REQUIRE(parts[0]->mRegister == 1);
+        REQUIRE(parts[0]->getCount() == 5);
+        REQUIRE(parts[0]->mDeliveryRanges.size() == 2);
+        REQUIRE(parts[0]->mRefresh == std::chrono::milliseconds(100));
+        REQUIRE(parts[0]->mReadErrors == 2);
+        REQUIRE(parts[1]->mRegister == 8);
+        REQUIRE(parts[1]->getCount() == 5);
+        REQUIRE(parts[1]->mDeliveryRanges.size() == 2);
+    }
+
+    SECTION("Part equal to single delivery range should not have delivery ranges") {
+        std::shared_ptr<modmqttd::RegisterPoll> reg(createCoalescedPoll({{1,2},{5,1}}));
+
+        std::vector<std::shared_ptr<modmqttd::RegisterPoll>> parts(reg->bisect());
+
+        REQUIRE(parts.size() == 2);
+        REQUIRE(parts[0]->getCount() == 2);
+        REQUIRE(parts[0]->mDeliveryRanges.empty());
+        REQUIRE(!parts[0]->canBisect());
+        REQUIRE(parts[1]->mRegister == 5);
+        REQUIRE(parts[1]->mDeliveryRanges.empty());
+    }
+
+    SECTION("Poll without delivery ranges should not be bisected") {
+        modmqttd::RegisterPoll reg(1, 1, modmqttd::RegisterType::HOLDING, 10, std::chrono::milliseconds(100), modmqttd::PublishMode::ON_CHANGE);
+
+        REQUIRE(reg.bisect().empty());
+    }
+}
+
+TEST_CASE("RegisterLayout tests") {
+    std::string path((std::filesystem::temp_directory_path() / "modmqttd_register_layout_test").string());
+    std::remove(path.c_str());
+
+    std::shared_ptr<modmqttd::RegisterPoll> reg(createCoalescedPoll({{1,2},{5,1},{8,2},{12,1}}));
+
+    SECTION("Layout of bisected parts should be saved and applied to configured poll group") {
+        modmqttd::RegisterLayout layout;
+        layout.load(path);
+        REQUIRE(layout.empty());
+
+        std::vector<std::shared_ptr<modmqttd::RegisterPoll>> parts(reg->bisect());
+        layout.update(*reg, parts);
+        std::vector<std::shared_ptr<modmqttd::RegisterPoll>> second(parts[1]->bisect());
+        layout.update(*parts[1], second);
+        layout.save();
+
+        modmqttd::RegisterLayout loaded;
+        loaded.load(path);
+
+        std::map<int, std::vector<std::shared_ptr<modmqttd::RegisterPoll>>> registerMap;
+        registerMap[1].push_back(createCoalescedPoll({{1,2},{5,1},{8,2},{12,1}}));
+        registerMap[1].push_back(createCoalescedPoll({{20,1},{22,1}}));
+
+        REQUIRE(loaded.apply(registerMap) == 1);
+        REQUIRE(registerMap[1].size() == 4);
+        REQUIRE(registerMap[1][0]->mRegister == 1);
+        REQUIRE(registerMap[1][0]->getCount() == 5);
+        REQUIRE(registerMap[1][0]->mDeliveryRanges.size() == 2);
+        REQUIRE(registerMap[1][1]->mRegister == 8);
+        REQUIRE(registerMap[1][1]->getCount() == 2);
+        REQUIRE(registerMap[1][1]->mDeliveryRanges.empty());
+        REQUIRE(registerMap[1][2]->mRegister == 12);
+        REQUIRE(registerMap[1][2]->getCount() == 1);
+        REQUIRE(registerMap[1][3]->mRegister == 20);
+    }
+
+    SECTION("Layout should not be applied to changed poll group") {
+        std::ofstream out(path);
+        out << "1 3 1 12 1:5 8:5" << std::endl;
+        out << "1 3 20 garbage" << std::endl;
+        out.close();
+
+        modmqttd::RegisterLayout layout;
+        layout.load(path);
+
+        std::map<int, std::vector<std::shared_ptr<modmqttd::RegisterPoll>>> registerMap;
+        registerMap[1].push_back(createCoalescedPoll({{1,2},{5,1},{8,2}}));
+
+        REQUIRE(layout.apply(registerMap) == 0);
+        REQUIRE(registerMap[1].size() == 1);
+    }
+
+    SECTION("Stale layout should not be applied to poll group with changed delivery ranges") {
+        std::ofstream out(path);
+        // part starts in the middle of delivery range 5:3
+        out << "1 3 1 12 1:5 6:7" << std::endl;
+        // delivery range 28:2 is split across parts
+        out << "1 3 20 12 20:9 29:3" << std::endl;
+        // delivery range 40:1 is not read
+        out << "1 3 40 12 41:2 45:7" << std::endl;
+        out.close();
+
+        modmqttd::RegisterLayout layout;
+        layout.load(path);
+
+        std::map<int, std::vector<std::shared_ptr<modmqttd::RegisterPoll>>> registerMap;
+        registerMap[1].push_back(createCoalescedPoll({{1,2},{5,3},{12,1}}));
+        registerMap[1].push_back(createCoalescedPoll({{20,2},{28,2},{31,1}}));
+        registerMap[1].push_back(createCoalescedPoll({{40,1},{41,2},{45,7}}));
+
+        REQUIRE(layout.apply(registerMap) == 0);
+        REQUIRE(registerMap[1].size() == 3);
+        REQUIRE(registerMap[1][0]->getCount() == 12);
+        REQUIRE(registerMap[1][1]->getCount() == 12);
+        REQUIRE(registerMap[1][2]->getCount() == 12);
+    }
+
+    std::remove(path.c_str());
+}
@@ -55,3 +55,68 @@ TEST_CASE("Modbus scheduler") {
     }
 
 }
+
+TEST_CASE("Modbus scheduler with multiple registers") {
+    std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+
+    RegisterSpec source;
+    std::shared_ptr<modmqttd::RegisterPoll> reg1(new modmqttd::RegisterPoll(1, 1, modmqttd::RegisterType::HOLDING, 1, std::chrono::milliseconds(1000), modmqttd::PublishMode::ON_CHANGE));
+    std::shared_ptr<modmqttd::RegisterPoll> reg2(new modmqttd::RegisterPoll(1, 2, modmqttd::RegisterType::HOLDING, 1, std::chrono::milliseconds(500), modmqttd::PublishMode::ON_CHANGE));
+    std::shared_ptr<modmqttd::RegisterPoll> reg3(new modmqttd::RegisterPoll(2, 1, modmqttd::RegisterType::HOLDING, 1, std::chrono::milliseconds(300), modmqttd::PublishMode::ON_CHANGE));
+    source[1].push_back(reg1);
+    source[1].push_back(reg2);
+    source[2].push_back(reg3);
+
+    reg1->mLastRead = now - std::chrono::milliseconds(2000);
+    reg2->mLastRead = now - std::chrono::milliseconds(2000);
+    reg3->mLastRead = now - std::chrono::milliseconds(100);
+
+    std::chrono::nanoseconds duration = std::chrono::seconds(1000);
+
+    modmqttd::ModbusScheduler scheduler;
+    scheduler.setPollSpecification(source);
+
+    SECTION ("should return only due registers in configuration order") {
+        RegisterSpec poll = scheduler.getRegistersToPoll(duration, now);
+
+        REQUIRE(poll.size() == 1);
+        REQUIRE(poll[1].size() == 2);
+        CHECK(poll[1][0] == reg1);
+        CHECK(poll[1][1] == reg2);
+        CHECK(duration == std::chrono::milliseconds(200));
+    }
+
+    SECTION ("should schedule next poll from last read time after registers are polled") {
+        scheduler.getRegistersToPoll(duration, now);
+
+        reg3->mLastRead = now + std::chrono::milliseconds(200);
+        RegisterSpec poll = scheduler.getRegistersToPoll(duration, now + std::chrono::milliseconds(200));
+        REQUIRE(poll.size() == 0);
+
+        reg1->mLastRead = now + std::chrono::milliseconds(250);
+        reg2->mLastRead = now + std::chrono::milliseconds(250);
+        reg3->mLastRead = now + std::chrono::milliseconds(250);
+        poll = scheduler.getRegistersToPoll(duration, now + std::chrono::milliseconds(300));
+
+        REQUIRE(poll.size() == 0);
+        CHECK(duration == std::chrono::milliseconds(250));
+
+        poll = scheduler.getRegistersToPoll(duration, now + std::chrono::milliseconds(550));
+        REQUIRE(poll.size() == 1);
+        REQUIRE(poll[2].size() == 1);
+        CHECK(poll[2][0] == reg3);
+        CHECK(duration == std::chrono::milliseconds(200));
+    }
+
+    SECTION ("should return not polled register again after refresh period") {
+        scheduler.getRegistersToPoll(duration, now);
+
+        RegisterSpec poll = scheduler.getRegistersToPoll(duration, now + std::chrono::milliseconds(100));
+        REQUIRE(poll.size() == 0);
+        CHECK(duration == std::chrono::milliseconds(100));
+
+        poll = scheduler.getRegistersToPoll(duration, now + std::chrono::milliseconds(500));
+        REQUIRE(poll[1].size() == 1);
+        CHECK(poll[1][0] == reg2);
+    }
+}
@@ -0,0 +1,89 @@
+#include <libmodmqttsrv/config.hpp>
+#include "catch2/catch_all.hpp"
+#include <boost/dll/import.hpp>
+
+#include "libmodmqttconv/converterplugin.hpp"
+
+// toMqttBatch() must return the same values as toMqtt()
+static void
+requireSameAsToMqtt(const DataConverter& pConv, const std::vector<uint16_t>& pRegisters, const std::vector<DataConverter::BatchSlot>& pSlots) {
+    std::vector<MqttValue> out(pSlots.size());
+    pConv.toMqttBatch(pRegisters, pSlots, out);
+
+    for(std::size_t i = 0; i < pSlots.size(); i++) {
+        std::vector<uint16_t> regs(pRegisters.begin() + pSlots[i].mOffset, pRegisters.begin() + pSlots[i].mOffset + pSlots[i].mCount);
+        MqttValue expected = pConv.toMqtt(ModbusRegisters(regs));
+        REQUIRE(out[i].getString() == expected.getString());
+    }
+}
+
+TEST_CASE("stdconv batch conversion") {
+    std::string stdconv_path = "../stdconv/stdconv.so";
+
+    std::shared_ptr<ConverterPlugin> plugin = boost_dll_import<ConverterPlugin>(
+        stdconv_path,
+        "converter_plugin",
+        boost::dll::load_mode::append_decorations
+    );
+
+    const std::vector<uint16_t> registers({0xfffe, 0x0001, 0xc2f6, 0xe979, 0x1234, 0x8000, 0x0064});
+    const std::vector<DataConverter::BatchSlot> singleSlots({{0, 1}, {1, 1}, {4, 1}, {5, 1}, {6, 1}});
+    const std::vector<DataConverter::BatchSlot> doubleSlots({{0, 2}, {2, 2}, {4, 2}, {5, 2}});
+
+    SECTION("int16") {
+        std::shared_ptr<DataConverter> conv(plugin->getConverter("int16"));
+        REQUIRE(conv->hasBatchConversion());
+        requireSameAsToMqtt(*conv, registers, singleSlots);
+    }
+
+    SECTION("int32") {
+        std::shared_ptr<DataConverter> conv(plugin->getConverter("int32"));
+        REQUIRE(conv->hasBatchConversion());
+        requireSameAsToMqtt(*conv, registers, doubleSlots);
+        requireSameAsToMqtt(*conv, registers, singleSlots);
+        conv->setArgs({"low_first"});
+        requireSameAsToMqtt(*conv, registers, doubleSlots);
+    }
+
+    SECTION("float32") {
+        std::shared_ptr<DataConverter> conv(plugin->getConverter("float32"));
+        REQUIRE(conv->hasBatchConversion());
+        requireSameAsToMqtt(*conv, registers, doubleSlots);
+        conv->setArgs({"3", "low_first", "swap_bytes"});
+        requireSameAsToMqtt(*conv, registers, doubleSlots);
+
+        std::vector<MqttValue> out(1);
+        REQUIRE_THROWS_AS(conv->toMqttBatch(registers, std::vector<DataConverter::BatchSlot>({{0, 1}}), out), ConvException);
+    }
+
+    SECTION("scale") {
+        std::shared_ptr<DataConverter> conv(plugin->getConverter("scale"));
+        conv->setArgs({"0", "65535", "-10", "10", "2"});
+        REQUIRE(conv->hasBatchConversion());
+        requireSameAsToMqtt(*conv, registers, singleSlots);
+    }
+
+    SECTION("divide") {
+        std::shared_ptr<DataConverter> conv(plugin->getConverter("divide"));
+        conv->setArgs({"10", "1"});
+        REQUIRE(conv->hasBatchConversion());
+        requireSameAsToMqtt(*conv, registers, singleSlots);
+        requireSameAsToMqtt(*conv, registers, doubleSlots);
+        conv->setArgs({"10", "1", "low_first"});
+        requireSameAsToMqtt(*conv, registers, doubleSlots);
+    }
+
+    SECTION("multiply") {
+        std::shared_ptr<DataConverter> conv(plugin->getConverter("multiply"));
+        conv->setArgs({"0.5", "1"});
+        REQUIRE(conv->hasBatchConversion());
+        requireSameAsToMqtt(*conv, registers, singleSlots);
+        requireSameAsToMqtt(*conv, registers, doubleSlots);
+    }
+
+    SECTION("converter without batch support should call toMqtt for every slot") {
+        std::shared_ptr<DataConverter> conv(plugin->getConverter("uint32"));
+        REQUIRE(!conv->hasBatchConversion());
+        requireSameAsToMqtt(*conv, registers, doubleSlots);
+    }
+}
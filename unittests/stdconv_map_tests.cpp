@@ -118,6 +118,42 @@ TEST_CASE ("An instance of map converter") {
         }
     }
 
+    SECTION("with sparse register values") {
+        std::vector<std::string> args = {
+            "{1:\"one\",1000:\"thousand\",65535:\"max\"}"
+        };
+        conv->setArgs(args);
+
+        SECTION("should convert mapped register values") {
+            REQUIRE(conv->toMqtt(ModbusRegisters(1)).getString() == "one");
+            REQUIRE(conv->toMqtt(ModbusRegisters(1000)).getString() == "thousand");
+            REQUIRE(conv->toMqtt(ModbusRegisters(65535)).getString() == "max");
+        }
+
+        SECTION("should pass unmapped modbus value") {
+            REQUIRE(conv->toMqtt(ModbusRegisters(0)).getString() == "0");
+            REQUIRE(conv->toMqtt(ModbusRegisters(999)).getString() == "999");
+        }
+    }
+
+    SECTION("with dense register values") {
+        std::vector<std::string> args = {
+            "{10:\"a\",11:\"b\",13:\"d\"}"
+        };
+        conv->setArgs(args);
+
+        SECTION("should convert mapped register values") {
+            REQUIRE(conv->toMqtt(ModbusRegisters(10)).getString() == "a");
+            REQUIRE(conv->toMqtt(ModbusRegisters(13)).getString() == "d");
+        }
+
+        SECTION("should pass unmapped modbus values outside and inside of mapped range") {
+            REQUIRE(conv->toMqtt(ModbusRegisters(9)).getString() == "9");
+            REQUIRE(conv->toMqtt(ModbusRegisters(12)).getString() == "12");
+            REQUIRE(conv->toMqtt(ModbusRegisters(14)).getString() == "14");
+        }
+    }
+
     SECTION("with register in hex format") {
         std::vector<std::string> args = {
             "{0x11:17}"
@@ -0,0 +1,28 @@
+#include "catch2/catch_all.hpp"
+
+#include "libmodmqttsrv/string_pool.hpp"
+
+TEST_CASE("StringPool") {
+    modmqttd::StringPool pool;
+
+    SECTION("should return the same id for equal strings") {
+        int id = pool.intern("tcptest");
+        REQUIRE(pool.intern(std::string("tcp") + "test") == id);
+        REQUIRE(pool.intern("rtutest") != id);
+        REQUIRE(pool.size() == 2);
+    }
+
+    SECTION("should keep references valid after adding more strings") {
+        const std::string& first(pool.get(pool.intern("first")));
+        for(int i = 0; i < 1000; i++)
+            pool.intern("network_" + std::to_string(i));
+        REQUIRE(&first == &pool.get(pool.find("first")));
+        REQUIRE(first == "first");
+    }
+
+    SECTION("should not find strings that were not interned") {
+        pool.intern("tcptest");
+        REQUIRE(pool.find("unknown") == modmqttd::StringPool::NOT_FOUND);
+        REQUIRE(pool.size() == 1);
+    }
+}